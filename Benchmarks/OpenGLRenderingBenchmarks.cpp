@@ -0,0 +1,690 @@
+// Benchmarks the plugin's hot paths on a headless context, e.g. on Mesa llvmpipe in CI.
+// Every scenario runs a few times and reports its median, one JSON object per line so runs can be diffed across commits.
+//
+//   OpenGLRenderingBenchmarks [--filter <substring>] [--output <file>] [--repeats <count>]
+
+#include "OpenGLBuffers.h"
+#include "OpenGLCallTracer.h"
+#include "OpenGLCulling.h"
+#include "OpenGLMeshOptimizer.h"
+#include "OpenGLRenderingPlugin.h"
+#include "OpenGLShader.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace Tbx;
+using namespace Tbx::Plugins::OpenGLRendering;
+
+namespace
+{
+    struct Options
+    {
+        std::string Filter = {};
+        std::string OutputPath = {};
+        uint32 Repeats = 5;
+    };
+
+    struct Result
+    {
+        std::string Name = {};
+        double Value = 0.0;
+        const char* Unit = "";
+    };
+
+    const char* VertexSource = R"(#version 450 core
+        layout(location = 0) in vec3 aPosition;
+        layout(location = 1) in vec4 aColor;
+        uniform mat4 uModel;
+        uniform vec4 uTint;
+        out vec4 vColor;
+        void main()
+        {
+            vColor = aColor * uTint;
+            gl_Position = uModel * vec4(aPosition, 1.0);
+        })";
+
+    // Same as VertexSource, with the uniforms in a per draw block
+    const char* BlockVertexSource = R"(#version 450 core
+        layout(location = 0) in vec3 aPosition;
+        layout(location = 1) in vec4 aColor;
+        layout(std140, binding = 1) uniform Draw
+        {
+            mat4 uModel;
+            vec4 uTint;
+        };
+        out vec4 vColor;
+        void main()
+        {
+            vColor = aColor * uTint;
+            gl_Position = uModel * vec4(aPosition, 1.0);
+        })";
+
+    // Same as VertexSource, with the uniforms in the render queue's draw storage block, see MeshInstance
+    const char* DrawStorageVertexSource = R"(#version 450 core
+        #extension GL_ARB_shader_draw_parameters : require
+        layout(location = 0) in vec3 aPosition;
+        layout(location = 1) in vec4 aColor;
+        struct MeshInstance { mat4 Transform; vec4 Color; };
+        layout(std430, binding = 0) readonly buffer Draws { MeshInstance draws[]; };
+        out vec4 vColor;
+        void main()
+        {
+            MeshInstance instance = draws[gl_BaseInstanceARB + gl_InstanceID];
+            vColor = aColor * instance.Color;
+            gl_Position = instance.Transform * vec4(aPosition, 1.0);
+        })";
+
+    // Same as DrawStorageVertexSource, with the instance the GPU culler drew, see OpenGLGpuCuller
+    const char* GpuCulledVertexSource = R"(#version 450 core
+        #extension GL_ARB_shader_draw_parameters : require
+        layout(location = 0) in vec3 aPosition;
+        layout(location = 1) in vec4 aColor;
+        struct GpuInstance { mat4 Transform; vec4 Color; vec4 Sphere; uvec4 Draw; };
+        layout(std430, binding = 0) readonly buffer Instances { GpuInstance instances[]; };
+        out vec4 vColor;
+        void main()
+        {
+            GpuInstance instance = instances[gl_BaseInstanceARB];
+            vColor = aColor * instance.Color;
+            gl_Position = instance.Transform * vec4(aPosition, 1.0);
+        })";
+
+    const char* FragmentSource = R"(#version 450 core
+        in vec4 vColor;
+        out vec4 oColor;
+        void main()
+        {
+            oColor = vColor;
+        })";
+
+    // Seconds taken by work, including the GPU finishing it
+    double Time(const std::function<void()>& work)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        work();
+        glFinish();
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    double Median(std::vector<double> samples)
+    {
+        std::sort(samples.begin(), samples.end());
+        return samples[samples.size() / 2];
+    }
+
+    Mesh CreateQuad()
+    {
+        Mesh mesh = {};
+        const float corners[4][2] = { { -0.5f, -0.5f }, { 0.5f, -0.5f }, { 0.5f, 0.5f }, { -0.5f, 0.5f } };
+        for (const auto& corner : corners)
+        {
+            mesh.Vertices.Vertices.insert(mesh.Vertices.Vertices.end(), { corner[0], corner[1], 0.0f, 1.0f, 1.0f, 1.0f, 1.0f });
+        }
+
+        VertexBufferElement position = {};
+        position.Type = Vector3();
+        position.Count = 3;
+        position.Offset = 0;
+        VertexBufferElement color = {};
+        color.Type = RgbaColor();
+        color.Count = 4;
+        color.Offset = 3 * sizeof(float);
+        mesh.Vertices.Layout.Elements = { position, color };
+        mesh.Vertices.Layout.Stride = 7 * sizeof(float);
+        mesh.Indices = { 0, 1, 2, 0, 2, 3 };
+        return mesh;
+    }
+
+    Mat4x4 CreateIdentity()
+    {
+        Mat4x4 matrix = {};
+        for (uint32 i = 0; i < 4; i++)
+        {
+            matrix.Values[i * 4 + i] = 1.0f;
+        }
+        return matrix;
+    }
+
+    // A different variant changes the source, so drivers can't answer from their own shader caches
+    Ref<ShaderProgramResource> CreateProgram(OpenGLRenderingPlugin& plugin, uint32 variant = 0, const char* vertexSource = VertexSource)
+    {
+        const auto suffix = "\n// Variant " + std::to_string(variant) + "\n";
+        return plugin.CreateShaderProgram(
+        {
+            plugin.CompileShader({ vertexSource + suffix, ShaderType::Vertex }),
+            plugin.CompileShader({ FragmentSource + suffix, ShaderType::Fragment })
+        });
+    }
+
+    class BenchmarkRunner
+    {
+    public:
+        BenchmarkRunner(OpenGLRenderingPlugin& plugin, const Options& options)
+            : _plugin(plugin)
+            , _options(options)
+        {
+        }
+
+        // Runs a scenario, work returns how many units it processed in the time it took
+        void Run(const std::string& name, const char* unit, const std::function<double(double& seconds)>& work)
+        {
+            if (!_options.Filter.empty() && name.find(_options.Filter) == std::string::npos)
+            {
+                return;
+            }
+
+            // Once untimed to warm up caches and the driver
+            double seconds = 0.0;
+            work(seconds);
+
+            std::vector<double> rates = {};
+            for (uint32 repeat = 0; repeat < _options.Repeats; repeat++)
+            {
+                const auto units = work(seconds);
+                rates.push_back(units / std::max(seconds, 1e-9));
+            }
+
+            _results.push_back({ name, Median(rates), unit });
+            std::fprintf(stderr, "%-32s %14.2f %s\n", name.c_str(), _results.back().Value, unit);
+        }
+
+        // Counts something exact, like the GL calls of a frame, so it's reported as is after one warm up run.
+        // Exact ratios, like the vertex transforms per triangle, print with decimals.
+        void Count(const std::string& name, const char* unit, const std::function<double()>& work, int decimals = 0)
+        {
+            if (!_options.Filter.empty() && name.find(_options.Filter) == std::string::npos)
+            {
+                return;
+            }
+
+            work();
+            _results.push_back({ name, work(), unit });
+            std::fprintf(stderr, "%-32s %14.*f %s\n", name.c_str(), decimals, _results.back().Value, unit);
+        }
+
+        const std::vector<Result>& GetResults() const { return _results; }
+        OpenGLRenderingPlugin& GetPlugin() { return _plugin; }
+
+    private:
+        OpenGLRenderingPlugin& _plugin;
+        const Options& _options;
+        std::vector<Result> _results = {};
+    };
+
+    /// Scenarios ///////////////////////////////////////////////////////////////
+
+    void BenchmarkDraws(BenchmarkRunner& runner)
+    {
+        auto& plugin = runner.GetPlugin();
+        auto program = CreateProgram(plugin);
+        auto* glProgram = static_cast<OpenGLShaderProgram*>(program.get());
+        const auto model = glProgram->GetUniformHandle("uModel");
+        const auto tint = glProgram->GetUniformHandle("uTint");
+        const auto identity = CreateIdentity();
+        auto quad = plugin.UploadMesh(CreateQuad());
+
+        constexpr uint32 drawCount = 20000;
+        runner.Run("draw_calls", "draws/s", [&](double& seconds)
+        {
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            seconds = Time([&]()
+            {
+                program->Activate();
+                glProgram->Upload(model, identity);
+                glProgram->Upload(tint, RgbaColor{ 1, 1, 1, 1 });
+                for (uint32 i = 0; i < drawCount; i++)
+                {
+                    quad->Activate();
+                    quad->Draw();
+                    quad->Release();
+                }
+                program->Release();
+            });
+            plugin.EndDraw();
+            return (double)drawCount;
+        });
+
+        // Counted on a steady state frame with a few draws, so it only changes when the plugin issues different calls
+        runner.Count("frame_gl_calls", "calls", [&]()
+        {
+            auto& tracer = OpenGLCallTracer::Get();
+            tracer.Install(GLTracerMode::Passthrough);
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            program->Activate();
+            glProgram->Upload(model, identity);
+            glProgram->Upload(tint, RgbaColor{ 1, 1, 1, 1 });
+            for (uint32 i = 0; i < 100; i++)
+            {
+                quad->Activate();
+                quad->Draw();
+                quad->Release();
+            }
+            program->Release();
+            plugin.EndDraw();
+            const auto calls = tracer.GetLastFrameCallCount();
+            tracer.Uninstall();
+            return (double)calls;
+        });
+
+        constexpr uint32 uploadCount = 100000;
+        runner.Run("uniform_uploads_by_handle", "uploads/s", [&](double& seconds)
+        {
+            program->Activate();
+            seconds = Time([&]()
+            {
+                for (uint32 i = 0; i < uploadCount; i++)
+                {
+                    glProgram->Upload(model, identity);
+                }
+            });
+            return (double)uploadCount;
+        });
+
+        runner.Run("uniform_uploads_by_name", "uploads/s", [&](double& seconds)
+        {
+            const ShaderUniform uniform = { "uModel", identity };
+            program->Activate();
+            seconds = Time([&]()
+            {
+                for (uint32 i = 0; i < uploadCount; i++)
+                {
+                    program->Upload(uniform);
+                }
+            });
+            return (double)uploadCount;
+        });
+
+        // Per draw uniforms, uploaded to the program one by one or packed into a block in the uniform ring
+        constexpr uint32 uniformDrawCount = 20000;
+        runner.Run("draw_uniforms_by_handle", "draws/s", [&](double& seconds)
+        {
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            seconds = Time([&]()
+            {
+                program->Activate();
+                quad->Activate();
+                for (uint32 i = 0; i < uniformDrawCount; i++)
+                {
+                    glProgram->Upload(model, identity);
+                    glProgram->Upload(tint, RgbaColor{ 1, 1, 1, 1 });
+                    quad->Draw();
+                }
+                quad->Release();
+                program->Release();
+            });
+            plugin.EndDraw();
+            return (double)uniformDrawCount;
+        });
+
+        auto blockProgram = CreateProgram(plugin, 0, BlockVertexSource);
+        runner.Run("draw_uniforms_block", "draws/s", [&](double& seconds)
+        {
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            seconds = Time([&]()
+            {
+                blockProgram->Activate();
+                quad->Activate();
+                for (uint32 i = 0; i < uniformDrawCount; i++)
+                {
+                    plugin.SetDrawUniforms({ identity, RgbaColor{ 1, 1, 1, 1 } });
+                    quad->Draw();
+                }
+                quad->Release();
+                blockProgram->Release();
+            });
+            plugin.EndDraw();
+            return (double)uniformDrawCount;
+        });
+    }
+
+    void BenchmarkRenderQueue(BenchmarkRunner& runner)
+    {
+        auto& plugin = runner.GetPlugin();
+        std::vector<Ref<ShaderProgramResource>> programs = {};
+        std::vector<Ref<MeshResource>> meshes = {};
+        for (uint32 i = 0; i < 4; i++)
+        {
+            programs.push_back(CreateProgram(plugin, i, DrawStorageVertexSource));
+            meshes.push_back(plugin.UploadMesh(CreateQuad()));
+        }
+
+        // Submitted in the worst order for state changes, every submission switches program and mesh
+        constexpr uint32 submissionCount = 20000;
+        const auto identity = CreateIdentity();
+        const auto submitFrame = [&]()
+        {
+            for (uint32 i = 0; i < submissionCount; i++)
+            {
+                RenderSubmission submission = {};
+                submission.Program = static_cast<OpenGLShaderProgram*>(programs[i % programs.size()].get());
+                submission.Mesh = meshes[(i / programs.size()) % meshes.size()].get();
+                submission.Instance = { identity, RgbaColor{ 1, 1, 1, 1 } };
+                submission.Depth = (float)(i % 97);
+                plugin.Submit(submission);
+            }
+        };
+
+        runner.Run("render_queue_submissions", "submissions/s", [&](double& seconds)
+        {
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            seconds = Time([&]()
+            {
+                submitFrame();
+                plugin.FlushRenderQueue();
+            });
+            plugin.EndDraw();
+            return (double)submissionCount;
+        });
+
+        runner.Count("render_queue_draws", "draws", [&]()
+        {
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            submitFrame();
+            plugin.FlushRenderQueue();
+            const auto draws = plugin.GetRenderQueueStats().Draws;
+            plugin.EndDraw();
+            return (double)draws;
+        });
+    }
+
+    void BenchmarkCulling(BenchmarkRunner& runner)
+    {
+        // A grid of quads ten times wider and taller than the clip volume, so only a few percent of them
+        // land inside the frustum like in a loaded open world
+        constexpr uint32 sphereCount = 100000;
+        const auto quad = CreateQuad();
+        const auto bounds = ComputeMeshBounds(quad.Vertices);
+        std::vector<Mat4x4> transforms(sphereCount, CreateIdentity());
+        for (uint32 i = 0; i < sphereCount; i++)
+        {
+            transforms[i].Values[12] = (float)(i % 100) * 0.2f - 10.0f;
+            transforms[i].Values[13] = (float)(i / 100 % 100) * 0.2f - 10.0f;
+            transforms[i].Values[14] = (float)(i / 10000) * 0.2f - 1.0f;
+        }
+
+        const auto frustum = OpenGLFrustum::FromViewProjection(CreateIdentity());
+        BoundingSpheres spheres = {};
+        std::vector<uint8_t> visible(sphereCount);
+        runner.Run("frustum_cull", "instances/s", [&](double& seconds)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            spheres.Clear();
+            for (const auto& transform : transforms)
+            {
+                spheres.Add(bounds, transform);
+            }
+            CullSpheres(frustum, spheres, visible.data());
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return (double)sphereCount;
+        });
+        runner.Count("frustum_cull_visible", "instances", [&]()
+        {
+            return (double)std::count(visible.begin(), visible.end(), (uint8_t)1);
+        });
+
+        // The same grid culled and drawn on the GPU, instances stay uploaded so a frame only dispatches and draws
+        auto& plugin = runner.GetPlugin();
+        plugin.SetMeshArenasEnabled(true);
+        auto arenaQuad = plugin.UploadMesh(quad);
+        plugin.SetMeshArenasEnabled(false);
+        auto program = CreateProgram(plugin, 0, GpuCulledVertexSource);
+        auto& culler = plugin.GetGpuCuller();
+        std::vector<uint32> handles = {};
+        for (const auto& transform : transforms)
+        {
+            handles.push_back(culler.AddInstance(arenaQuad, { transform, RgbaColor{ 1, 1, 1, 1 } }));
+        }
+        runner.Run("gpu_cull", "instances/s", [&](double& seconds)
+        {
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            seconds = Time([&]()
+            {
+                culler.Draw(*static_cast<OpenGLShaderProgram*>(program.get()), CreateIdentity());
+            });
+            plugin.EndDraw();
+            return (double)sphereCount;
+        });
+        runner.Count("gpu_cull_visible", "instances", [&]()
+        {
+            // Every quad drawn is two triangles
+            GLuint query = 0;
+            GLuint primitives = 0;
+            glCreateQueries(GL_PRIMITIVES_GENERATED, 1, &query);
+            plugin.BeginDraw({ 0, 0, 0, 1 }, { { 0, 0 }, { 64, 64 } });
+            glBeginQuery(GL_PRIMITIVES_GENERATED, query);
+            culler.Draw(*static_cast<OpenGLShaderProgram*>(program.get()), CreateIdentity());
+            glEndQuery(GL_PRIMITIVES_GENERATED);
+            plugin.EndDraw();
+            glGetQueryObjectuiv(query, GL_QUERY_RESULT, &primitives);
+            glDeleteQueries(1, &query);
+            return (double)(primitives / 2);
+        });
+        for (const auto handle : handles)
+        {
+            culler.RemoveInstance(handle);
+        }
+
+        Mesh grid = {};
+        grid.Vertices.Layout = quad.Vertices.Layout;
+        for (uint32 i = 0; i < 256; i++)
+        {
+            grid.Vertices.Vertices.insert(grid.Vertices.Vertices.end(), quad.Vertices.Vertices.begin(), quad.Vertices.Vertices.end());
+        }
+        const auto vertexCount = (uint32)(grid.Vertices.Vertices.size() * sizeof(float) / grid.Vertices.Layout.Stride);
+        runner.Run("mesh_bounds", "vertices/s", [&](double& seconds)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            for (uint32 i = 0; i < 100; i++)
+            {
+                ComputeMeshBounds(grid.Vertices);
+            }
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return (double)vertexCount * 100;
+        });
+    }
+
+    void BenchmarkMeshOptimization(BenchmarkRunner& runner)
+    {
+        // A grid with its quads shuffled, like the worst of the imported meshes
+        constexpr uint32 gridSize = 128;
+        Mesh grid = {};
+        grid.Vertices.Layout = CreateQuad().Vertices.Layout;
+        for (uint32 y = 0; y <= gridSize; y++)
+        {
+            for (uint32 x = 0; x <= gridSize; x++)
+            {
+                grid.Vertices.Vertices.insert(grid.Vertices.Vertices.end(), { (float)x, (float)y, 0.0f, 1.0f, 1.0f, 1.0f, 1.0f });
+            }
+        }
+        std::vector<uint32> quads(gridSize * gridSize);
+        for (uint32 i = 0; i < (uint32)quads.size(); i++)
+        {
+            // Multiplying by an odd constant permutes the quads without needing a random generator
+            quads[i] = (uint32)(((uint64_t)i * 40503u) % quads.size());
+        }
+        for (const auto quad : quads)
+        {
+            const auto corner = quad / gridSize * (gridSize + 1) + quad % gridSize;
+            grid.Indices.insert(grid.Indices.end(), { corner, corner + 1, corner + gridSize + 2, corner, corner + gridSize + 2, corner + gridSize + 1 });
+        }
+
+        const auto triangleCount = (double)(grid.Indices.size() / 3);
+        runner.Run("mesh_optimize", "triangles/s", [&](double& seconds)
+        {
+            auto mesh = grid;
+            const auto start = std::chrono::steady_clock::now();
+            OptimizeMesh(mesh, true);
+            seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            return triangleCount;
+        });
+        // Optimized here rather than in the timed run, so the ratios are right when only they're filtered in
+        const auto optimize = [&]()
+        {
+            auto mesh = grid;
+            return OptimizeMesh(mesh, true);
+        };
+        runner.Count("mesh_acmr_before", "transforms/triangle", [&]() { return (double)optimize().GetAcmrBefore(); }, 2);
+        runner.Count("mesh_acmr_after", "transforms/triangle", [&]() { return (double)optimize().GetAcmrAfter(); }, 2);
+    }
+
+    void BenchmarkBufferUploads(BenchmarkRunner& runner)
+    {
+        auto& plugin = runner.GetPlugin();
+        const auto quad = CreateQuad();
+        for (const uint32 sizeInKb : { 4u, 64u, 1024u, 16384u })
+        {
+            VertexBuffer buffer = quad.Vertices;
+            buffer.Vertices.assign(sizeInKb * 1024 / sizeof(float), 0.5f);
+            const auto name = "vertex_upload_" + std::to_string(sizeInKb) + "kb";
+
+            // Enough uploads per sample that small sizes aren't just timer noise
+            const auto uploadCount = std::max(16384u / sizeInKb, 4u);
+            runner.Run(name, "MB/s", [&](double& seconds)
+            {
+                OpenGLVertexBuffer vertexBuffer(plugin.GetStateCache());
+                seconds = Time([&]()
+                {
+                    for (uint32 i = 0; i < uploadCount; i++)
+                    {
+                        vertexBuffer.Upload(buffer);
+                    }
+                });
+                return (double)uploadCount * sizeInKb / 1024.0;
+            });
+        }
+    }
+
+    void BenchmarkTextureUploads(BenchmarkRunner& runner)
+    {
+        auto& plugin = runner.GetPlugin();
+        for (const uint32 size : { 256u, 1024u, 2048u })
+        {
+            Texture texture = {};
+            texture.Resolution = { size, size };
+            texture.Format = TextureFormat::RGBA;
+            texture.Pixels.assign((size_t)size * size * 4, 127);
+            const auto name = "texture_upload_" + std::to_string(size);
+
+            runner.Run(name, "MB/s", [&](double& seconds)
+            {
+                seconds = Time([&]()
+                {
+                    auto resource = plugin.UploadTexture(texture);
+                    plugin.FlushTextureUploads();
+                });
+                plugin.FlushPendingDeletes();
+                return (double)texture.Pixels.size() / (1024.0 * 1024.0);
+            });
+        }
+    }
+
+    void BenchmarkProgramCreation(BenchmarkRunner& runner)
+    {
+        auto& plugin = runner.GetPlugin();
+
+        // Uncached on purpose, every sample compiles and links new source
+        plugin.SetProgramCacheDirectory({});
+        const auto seed = (uint32)std::chrono::steady_clock::now().time_since_epoch().count();
+        uint32 variant = 0;
+        runner.Run("program_create", "programs/s", [&](double& seconds)
+        {
+            seconds = Time([&]()
+            {
+                auto program = CreateProgram(plugin, seed + ++variant);
+            });
+            plugin.FlushPendingDeletes();
+            return 1.0;
+        });
+    }
+
+    /// Output //////////////////////////////////////////////////////////////////
+
+    void WriteResults(std::FILE* file, const std::vector<Result>& results)
+    {
+        const auto* renderer = (const char*)glGetString(GL_RENDERER);
+        const auto* version = (const char*)glGetString(GL_VERSION);
+        for (const auto& result : results)
+        {
+            std::fprintf(file, "{\"benchmark\":\"%s\",\"value\":%.3f,\"unit\":\"%s\",\"renderer\":\"%s\",\"version\":\"%s\"}\n",
+                result.Name.c_str(), result.Value, result.Unit, renderer ? renderer : "", version ? version : "");
+        }
+    }
+
+    bool ParseOptions(int argc, char** argv, Options& options)
+    {
+        for (int i = 1; i < argc; i++)
+        {
+            const bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--filter") == 0 && hasValue)
+            {
+                options.Filter = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--output") == 0 && hasValue)
+            {
+                options.OutputPath = argv[++i];
+            }
+            else if (std::strcmp(argv[i], "--repeats") == 0 && hasValue)
+            {
+                options.Repeats = std::max(std::atoi(argv[++i]), 1);
+            }
+            else
+            {
+                std::fprintf(stderr, "Usage: %s [--filter <substring>] [--output <file>] [--repeats <count>]\n", argv[0]);
+                return false;
+            }
+        }
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options = {};
+    if (!ParseOptions(argc, argv, options))
+    {
+        return 2;
+    }
+
+    std::vector<Result> results = {};
+    {
+        OpenGLRenderingPlugin plugin(nullptr);
+        if (!plugin.InitializeHeadless())
+        {
+            std::fprintf(stderr, "Failed to create a headless OpenGL 4.5 context\n");
+            return 1;
+        }
+
+        // Draw into a render target, a surfaceless context has no default framebuffer
+        auto target = plugin.CreateRenderTarget(64, 64);
+        plugin.SetRenderTarget(target);
+
+        BenchmarkRunner runner(plugin, options);
+        BenchmarkDraws(runner);
+        BenchmarkRenderQueue(runner);
+        BenchmarkCulling(runner);
+        BenchmarkMeshOptimization(runner);
+        BenchmarkBufferUploads(runner);
+        BenchmarkTextureUploads(runner);
+        BenchmarkProgramCreation(runner);
+
+        auto* file = options.OutputPath.empty() ? stdout : std::fopen(options.OutputPath.c_str(), "w");
+        if (!file)
+        {
+            std::fprintf(stderr, "Failed to open %s\n", options.OutputPath.c_str());
+            return 1;
+        }
+        WriteResults(file, runner.GetResults());
+        if (file != stdout)
+        {
+            std::fclose(file);
+        }
+    }
+    return 0;
+}
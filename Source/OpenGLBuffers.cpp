@@ -1,7 +1,11 @@
 #include "OpenGLBuffers.h"
 #include <Tbx/Debug/Tracers.h>
 #include <glad/glad.h>
+#include <algorithm>
+#include <bit>
+#include <cmath>
 #include <cstdint>
+#include <cstring>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
@@ -37,90 +41,252 @@ namespace Tbx::Plugins::OpenGLRendering
 
     }
 
-    /// Vertex Buffer ///////////////////////////////////////////////////////////
+    static uint16_t FloatToHalf(float value)
+    {
+        const auto bits = std::bit_cast<uint32_t>(value);
+        const auto sign = (uint16_t)((bits >> 16) & 0x8000);
+        const auto exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+        const auto mantissa = bits & 0x7FFFFF;
+
+        if (((bits >> 23) & 0xFF) == 0xFF) // Inf and NaN
+        {
+            return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+        }
+        if (exponent >= 0x1F) // Too big, clamp to infinity
+        {
+            return sign | 0x7C00;
+        }
+        if (exponent <= 0) // Too small for a normal half, flush to a subnormal or zero
+        {
+            if (exponent < -10) return sign;
+            const auto subnormal = (mantissa | 0x800000) >> (1 - exponent);
+            return sign | (uint16_t)((subnormal + 0x1000) >> 13);
+        }
+
+        // Round to nearest even, a carry out of the mantissa correctly bumps the exponent
+        auto half = (uint32_t)((exponent << 10) | (mantissa >> 13));
+        const auto remainder = mantissa & 0x1FFF;
+        if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1)))
+        {
+            half++;
+        }
+        return sign | (uint16_t)half;
+    }
 
-    OpenGLVertexBuffer::OpenGLVertexBuffer()
+    static uint32_t PackSnorm1010102(float x, float y, float z)
     {
-        glCreateBuffers(1, &_vertBufferGLId);
+        const auto pack = [](float value, int shift)
+        {
+            const auto scaled = (int32_t)std::round(std::clamp(value, -1.0f, 1.0f) * 511.0f);
+            return ((uint32_t)scaled & 0x3FF) << shift;
+        };
+        return pack(x, 0) | pack(y, 10) | pack(z, 20);
     }
 
-    OpenGLVertexBuffer::~OpenGLVertexBuffer()
+    static uint8_t PackUnorm8(float value)
     {
-        Unbind();
-        glDeleteBuffers(1, &_vertBufferGLId);
+        return (uint8_t)std::round(std::clamp(value, 0.0f, 1.0f) * 255.0f);
     }
 
-    void OpenGLVertexBuffer::Upload(const VertexBuffer& buffer)
+    // Re-encodes the vertices into a compact layout, returning the attribute formats to read it with
+    static VertexFormat PackVertices(const VertexBuffer& buffer, uint32 normalElements, std::vector<uint8_t>& packed, uint32& packedStride)
     {
-        const auto& verticesVec = buffer.Vertices;
-        _count = (uint32)verticesVec.size();
-        glBufferData(GL_ARRAY_BUFFER, _count * sizeof(float), verticesVec.data(), GL_STATIC_DRAW);
+        enum class Packing { Copy, Rgba8, Snorm1010102, Half2 };
 
-        uint32 index = 0;
         const auto& layout = buffer.Layout;
-        const auto& stride = layout.Stride;
-        for (const auto& element : layout.Elements)
+        const auto vertexCount = (uint32)(buffer.Vertices.size() * sizeof(float) / layout.Stride);
+
+        // Decide how each element is stored
+        VertexFormat attributes = {};
+        std::vector<Packing> packings = {};
+        packedStride = 0;
+        for (uint32 elementIndex = 0; elementIndex < (uint32)layout.Elements.size(); elementIndex++)
         {
-            const auto& type = VertexTypeToGlType(element.Type);
-            const auto& size = element.Count;
-            const auto& offset = element.Offset;
-            const bool normalized = element.Normalized;
-            AddAttribute(index, size, type, stride, offset, normalized);
-            index++;
+            const auto& element = layout.Elements[elementIndex];
+            const bool isNormal = elementIndex < 32 && (normalElements >> elementIndex) & 1;
+            TBX_ASSERT(!isNormal || (std::holds_alternative<Vector3>(element.Type) && element.Count == 3), "GL Rendering: Only Vector3 elements can be packed as normals!");
+
+            VertexAttributeFormat attribute = { VertexTypeToGlType(element.Type), element.Count, packedStride, element.Normalized };
+            auto packing = Packing::Copy;
+            if (std::holds_alternative<RgbaColor>(element.Type) && element.Count == 4)
+            {
+                attribute = { GL_UNSIGNED_BYTE, 4, packedStride, true };
+                packing = Packing::Rgba8;
+            }
+            else if (isNormal && std::holds_alternative<Vector3>(element.Type) && element.Count == 3)
+            {
+                attribute = { GL_INT_2_10_10_10_REV, 4, packedStride, true };
+                packing = Packing::Snorm1010102;
+            }
+            else if (std::holds_alternative<Vector2>(element.Type) && element.Count == 2)
+            {
+                attribute = { GL_HALF_FLOAT, 2, packedStride, false };
+                packing = Packing::Half2;
+            }
+
+            packedStride += packing == Packing::Copy ? element.Count * 4 : 4;
+            attributes.push_back(attribute);
+            packings.push_back(packing);
         }
+
+        // Re-encode every vertex
+        packed.assign((size_t)vertexCount * packedStride, 0);
+        const auto* source = reinterpret_cast<const uint8_t*>(buffer.Vertices.data());
+        for (uint32 vertex = 0; vertex < vertexCount; vertex++)
+        {
+            const auto* sourceVertex = source + vertex * layout.Stride;
+            auto* packedVertex = packed.data() + vertex * packedStride;
+            for (size_t i = 0; i < attributes.size(); i++)
+            {
+                const auto& element = layout.Elements[i];
+                const auto* from = sourceVertex + element.Offset;
+                auto* to = packedVertex + attributes[i].Offset;
+
+                float v[4] = {};
+                std::memcpy(v, from, std::min<uint32>(element.Count, 4) * sizeof(float));
+                switch (packings[i])
+                {
+                    case Packing::Rgba8:
+                    {
+                        const uint8_t rgba[4] = { PackUnorm8(v[0]), PackUnorm8(v[1]), PackUnorm8(v[2]), PackUnorm8(v[3]) };
+                        std::memcpy(to, rgba, sizeof(rgba));
+                        break;
+                    }
+                    case Packing::Snorm1010102:
+                    {
+                        const auto normal = PackSnorm1010102(v[0], v[1], v[2]);
+                        std::memcpy(to, &normal, sizeof(normal));
+                        break;
+                    }
+                    case Packing::Half2:
+                    {
+                        const uint16_t halfs[2] = { FloatToHalf(v[0]), FloatToHalf(v[1]) };
+                        std::memcpy(to, halfs, sizeof(halfs));
+                        break;
+                    }
+                    default:
+                    {
+                        std::memcpy(to, from, element.Count * 4);
+                        break;
+                    }
+                }
+            }
+        }
+
+        return attributes;
+    }
+
+    /// Vertex Buffer ///////////////////////////////////////////////////////////
+
+    OpenGLVertexBuffer::OpenGLVertexBuffer(OpenGLStateCache& state)
+        : _state(state)
+    {
+        _vertBufferGLId = _state.GetNamePool().AcquireBuffer();
+    }
+
+    OpenGLVertexBuffer::~OpenGLVertexBuffer()
+    {
+        _state.GetMemoryTracker().Untrack(GpuMemoryType::VertexBuffer, _vertBufferGLId);
+        _state.OnBufferDeleted(_vertBufferGLId);
+        _state.GetNamePool().ReleaseBuffer(_vertBufferGLId);
     }
 
-    void OpenGLVertexBuffer::AddAttribute(uint index, uint32 size, uint32 type, uint32 stride, uint32 offset, bool normalized) const
+    void OpenGLVertexBuffer::Upload(const VertexBuffer& buffer, const VertexPacking& packing)
     {
-        // Need to do this casting nonsense to get rid of a warning...
-        glEnableVertexAttribArray(index);
-        const void* attributeOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(offset));
-        if (type == GL_INT && !normalized)
+        const auto& verticesVec = buffer.Vertices;
+        _count = (uint32)verticesVec.size();
+        if (packing.IsEnabled && buffer.Layout.Stride > 0)
         {
-            glVertexAttribIPointer(index, size, type, stride, attributeOffset);
+            std::vector<uint8_t> packedVertices = {};
+            _format = PackVertices(buffer, packing.NormalElements, packedVertices, _stride);
+            glNamedBufferData(_vertBufferGLId, packedVertices.size(), packedVertices.data(), GL_STATIC_DRAW);
+            _state.CountUpload(packedVertices.size());
+            _state.GetMemoryTracker().Track(GpuMemoryType::VertexBuffer, _vertBufferGLId, packedVertices.size());
+            return;
         }
-        else
+
+        _stride = buffer.Layout.Stride;
+        _format = GetLayoutFormat(buffer.Layout);
+        glNamedBufferData(_vertBufferGLId, _count * sizeof(float), verticesVec.data(), GL_STATIC_DRAW);
+        _state.CountUpload(_count * sizeof(float));
+        _state.GetMemoryTracker().Track(GpuMemoryType::VertexBuffer, _vertBufferGLId, _count * sizeof(float));
+    }
+
+    VertexFormat OpenGLVertexBuffer::GetLayoutFormat(const VertexLayout& layout)
+    {
+        VertexFormat format = {};
+        format.reserve(layout.Elements.size());
+        for (const auto& element : layout.Elements)
         {
-            glVertexAttribPointer(index, size, type, normalized ? GL_TRUE : GL_FALSE, stride, attributeOffset);
+            format.push_back({ VertexTypeToGlType(element.Type), element.Count, element.Offset, element.Normalized });
         }
+        return format;
     }
 
-    void OpenGLVertexBuffer::Bind() const
+    void OpenGLVertexBuffer::Allocate(uint32 sizeInBytes)
     {
-        glBindBuffer(GL_ARRAY_BUFFER, _vertBufferGLId);
+        _count = 0;
+        glNamedBufferData(_vertBufferGLId, sizeInBytes, nullptr, GL_STATIC_DRAW);
+        _state.GetMemoryTracker().Track(GpuMemoryType::VertexBuffer, _vertBufferGLId, sizeInBytes);
     }
 
-    void OpenGLVertexBuffer::Unbind() const
+    void OpenGLVertexBuffer::UploadRange(uint32 offsetInBytes, const void* data, uint32 sizeInBytes) const
     {
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
+        glNamedBufferSubData(_vertBufferGLId, offsetInBytes, sizeInBytes, data);
+        _state.CountUpload(sizeInBytes);
     }
 
     /// Index Buffer ////////////////////////////////////////////////////////////
 
-    OpenGLIndexBuffer::OpenGLIndexBuffer()
+    OpenGLIndexBuffer::OpenGLIndexBuffer(OpenGLStateCache& state)
+        : _state(state)
     {
-        glCreateBuffers(1, &_indexBuffGLId);
+        _indexBuffGLId = _state.GetNamePool().AcquireBuffer();
     }
 
     OpenGLIndexBuffer::~OpenGLIndexBuffer()
     {
-        Unbind();
-        glDeleteBuffers(1, &_indexBuffGLId);
+        _state.GetMemoryTracker().Untrack(GpuMemoryType::IndexBuffer, _indexBuffGLId);
+        _state.OnBufferDeleted(_indexBuffGLId);
+        _state.GetNamePool().ReleaseBuffer(_indexBuffGLId);
     }
 
     void OpenGLIndexBuffer::Upload(const IndexBuffer& buffer)
     {
         _count = (uint32)buffer.size();
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, _count * sizeof(uint32), buffer.data(), GL_STATIC_DRAW);
+
+        // Halve the index data when every index fits in 16 bits
+        const bool fitsInShorts = std::all_of(buffer.begin(), buffer.end(), [](uint32 index) { return index <= 0xFFFF; });
+        if (fitsInShorts)
+        {
+            const std::vector<uint16_t> shortIndices(buffer.begin(), buffer.end());
+            _indexType = GL_UNSIGNED_SHORT;
+            _indexSize = sizeof(uint16_t);
+            glNamedBufferData(_indexBuffGLId, _count * _indexSize, shortIndices.data(), GL_STATIC_DRAW);
+            _state.CountUpload(_count * _indexSize);
+            _state.GetMemoryTracker().Track(GpuMemoryType::IndexBuffer, _indexBuffGLId, _count * _indexSize);
+            return;
+        }
+
+        _indexType = GL_UNSIGNED_INT;
+        _indexSize = sizeof(uint32);
+        glNamedBufferData(_indexBuffGLId, _count * _indexSize, buffer.data(), GL_STATIC_DRAW);
+        _state.CountUpload(_count * _indexSize);
+        _state.GetMemoryTracker().Track(GpuMemoryType::IndexBuffer, _indexBuffGLId, _count * _indexSize);
     }
 
-    void OpenGLIndexBuffer::Bind() const
+    void OpenGLIndexBuffer::Allocate(uint32 sizeInBytes)
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, _indexBuffGLId);
+        _count = 0;
+        _indexType = GL_UNSIGNED_INT;
+        _indexSize = sizeof(uint32);
+        glNamedBufferData(_indexBuffGLId, sizeInBytes, nullptr, GL_STATIC_DRAW);
+        _state.GetMemoryTracker().Track(GpuMemoryType::IndexBuffer, _indexBuffGLId, sizeInBytes);
     }
 
-    void OpenGLIndexBuffer::Unbind() const
+    void OpenGLIndexBuffer::UploadRange(uint32 offsetInBytes, const void* data, uint32 sizeInBytes) const
     {
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+        glNamedBufferSubData(_indexBuffGLId, offsetInBytes, sizeInBytes, data);
+        _state.CountUpload(sizeInBytes);
     }
 }
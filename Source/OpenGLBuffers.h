@@ -1,43 +1,78 @@
 #pragma once
 #include <Tbx/Graphics/Mesh.h>
 #include <Tbx/Math/Int.h>
+#include "OpenGLStateCache.h"
+#include "OpenGLVertexArrayCache.h"
+#include <vector>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
+    using VertexLayout = decltype(VertexBuffer::Layout);
+
+    // How OpenGLVertexBuffer::Upload stores vertices. When enabled, colours are stored as normalized RGBA8 and 2D vectors (UVs)
+    // as half floats. Normals look like any other Vector3, so only the elements listed here are stored as 10_10_10_2.
+    struct VertexPacking
+    {
+        bool IsEnabled = false;
+        // Bit i set packs layout element i, a unit length Vector3
+        uint32 NormalElements = 0;
+    };
+
     class OpenGLVertexBuffer final
     {
     public:
-        OpenGLVertexBuffer();
+        OpenGLVertexBuffer(OpenGLStateCache& state);
         ~OpenGLVertexBuffer();
 
-        void Bind() const;
-        void Unbind() const;
+        // Anything the packing doesn't cover keeps its full precision, see VertexPacking.
+        void Upload(const VertexBuffer& buffer, const VertexPacking& packing = {});
 
-        void Upload(const VertexBuffer& buffer);
-        void AddAttribute(uint index, uint32 size, uint32 type, uint32 stride, uint32 offset, bool normalized) const;
+        // The format vertices with the given layout are read with when uploaded unpacked.
+        static VertexFormat GetLayoutFormat(const VertexLayout& layout);
+
+        // Reserves uninitialized storage to be filled with UploadRange.
+        void Allocate(uint32 sizeInBytes);
+        void UploadRange(uint32 offsetInBytes, const void* data, uint32 sizeInBytes) const;
 
         uint32 GetCount() const { return _count; }
+        uint32 GetGLId() const { return _vertBufferGLId; }
+        uint32 GetStride() const { return _stride; }
+        const VertexFormat& GetFormat() const { return _format; }
 
     private:
+        OpenGLStateCache& _state;
         uint32 _vertBufferGLId = -1;
         uint32 _count = 0;
+        uint32 _stride = 0;
+        VertexFormat _format = {};
     };
 
     class OpenGLIndexBuffer final
     {
     public:
-        OpenGLIndexBuffer();
-        ~OpenGLIndexBuffer();
+        // 32 bit indices until an upload finds they fit in 16
+        static constexpr uint32 DefaultIndexType = 0x1405; // GL_UNSIGNED_INT
 
-        void Bind() const;
-        void Unbind() const;
+        OpenGLIndexBuffer(OpenGLStateCache& state);
+        ~OpenGLIndexBuffer();
 
+        // Stores indices as 16 bit when every index fits, 32 bit otherwise.
         void Upload(const IndexBuffer& buffer);
 
+        // Reserves uninitialized storage for 32 bit indices to be filled with UploadRange.
+        void Allocate(uint32 sizeInBytes);
+        void UploadRange(uint32 offsetInBytes, const void* data, uint32 sizeInBytes) const;
+
         uint32 GetCount() const { return _count; }
+        uint32 GetGLId() const { return _indexBuffGLId; }
+        uint32 GetIndexType() const { return _indexType; }
+        uint32 GetIndexSize() const { return _indexSize; }
 
     private:
+        OpenGLStateCache& _state;
         uint32 _indexBuffGLId = -1;
         uint32 _count = 0;
+        uint32 _indexType = DefaultIndexType;
+        uint32 _indexSize = sizeof(uint32);
     };
 }
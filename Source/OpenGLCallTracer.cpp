@@ -0,0 +1,1068 @@
+#include "OpenGLCallTracer.h"
+#include <Tbx/Debug/Asserts.h>
+#include <Tbx/Debug/Tracers.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define TBX_GL_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define TBX_GL_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    /////// Trace Format ///////////////////////////////////
+
+    // A trace is the header followed by one record per call: the function id, every argument, then whatever the call
+    // returned that the replay needs to check or remap. Scalars are written as they are, pointers as one of these kinds.
+    static constexpr char TraceMagic[8] = { 'T', 'B', 'X', 'G', 'L', 'T', 'R', '1' };
+    static constexpr uint32 TraceVersion = 1;
+    static constexpr uint16_t TraceFrameMarker = 0xFFFF;
+    static constexpr size_t TraceFlushSize = 1 << 20;
+    static constexpr size_t DefaultScratchSize = 64;
+
+    enum class GLPointerKind : uint8_t
+    {
+        // Decided by the pointer's constness, offsets into a bound buffer when const, outputs when not
+        Default,
+        Null,
+        // The pointer's value, e.g. an offset into the bound element, indirect or pixel buffer
+        Value,
+        // Bytes the call reads
+        Blob,
+        // Strings the call reads, for glShaderSource
+        Strings,
+        // Memory the call writes to that doesn't matter on replay
+        Scratch,
+        // Object names the call writes, compared on replay
+        Names
+    };
+
+    struct GLPointer
+    {
+        GLPointerKind Kind = GLPointerKind::Default;
+        size_t Size = 0;
+    };
+
+    static GLPointer Blob(size_t size) { return { GLPointerKind::Blob, size }; }
+    static GLPointer Scratch(size_t size) { return { GLPointerKind::Scratch, size }; }
+    static GLPointer Names(size_t count) { return { GLPointerKind::Names, count * sizeof(GLuint) }; }
+    static GLPointer Uints(size_t count) { return Blob(count * sizeof(GLuint)); }
+
+    template <typename T>
+    static void Write(std::vector<uint8_t>& trace, const T& value)
+    {
+        const auto* bytes = reinterpret_cast<const uint8_t*>(&value);
+        trace.insert(trace.end(), bytes, bytes + sizeof(T));
+    }
+
+    static void WriteBytes(std::vector<uint8_t>& trace, const void* data, size_t size)
+    {
+        Write(trace, (uint32)size);
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        trace.insert(trace.end(), bytes, bytes + size);
+    }
+
+    struct GLTraceReader
+    {
+        const uint8_t* Position = nullptr;
+        const uint8_t* End = nullptr;
+        bool IsValid = true;
+
+        template <typename T>
+        T Read()
+        {
+            T value = {};
+            if ((size_t)(End - Position) < sizeof(T))
+            {
+                IsValid = false;
+                Position = End;
+                return value;
+            }
+            std::memcpy(&value, Position, sizeof(T));
+            Position += sizeof(T);
+            return value;
+        }
+
+        const uint8_t* ReadBytes(size_t size)
+        {
+            if ((size_t)(End - Position) < size)
+            {
+                IsValid = false;
+                Position = End;
+                return nullptr;
+            }
+            const auto* bytes = Position;
+            Position += size;
+            return bytes;
+        }
+    };
+
+    struct GLReplayContext
+    {
+        OpenGLCallTracer::ReplayStats& Stats;
+        std::unordered_map<uint64_t, GLsync> Syncs = {};
+        // Per call memory for outputs, strings and blobs that aren't aligned in the trace
+        std::vector<std::vector<uint64_t>> Scratch = {};
+        std::vector<std::vector<const GLchar*>> Strings = {};
+        size_t ScratchUsed = 0;
+        size_t StringsUsed = 0;
+
+        void* Allocate(size_t size)
+        {
+            if (ScratchUsed == Scratch.size())
+            {
+                Scratch.emplace_back();
+            }
+            auto& memory = Scratch[ScratchUsed++];
+            memory.resize(std::max(memory.size(), size / sizeof(uint64_t) + 1));
+            return memory.data();
+        }
+    };
+
+    template <typename T>
+    static constexpr bool IsSync = std::is_same_v<T, GLsync>;
+    template <typename T>
+    static constexpr bool IsFunctionPointer = std::is_pointer_v<T> && std::is_function_v<std::remove_pointer_t<T>>;
+    template <typename T>
+    static constexpr bool IsDataPointer = std::is_pointer_v<T> && !IsSync<T> && !IsFunctionPointer<T>;
+
+    /////// Call Rules ///////////////////////////////////
+
+    // Describes the pointer arguments of a function for recording, by argument index.
+    // Every const pointer to client memory needs a rule, or it's recorded as an offset.
+    struct GLDefaultRules
+    {
+        // Calls whose results only make sense in the recording process
+        static constexpr bool IsSkippedOnReplay = false;
+        // Calls returning a new object name, compared on replay
+        static constexpr bool ReturnsName = false;
+
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments&) { return {}; }
+    };
+
+    template <GLFunction Id>
+    struct GLCallRules : GLDefaultRules {};
+
+    template <GLFunction Id>
+    static GLint QueryInteger(GLenum name);
+
+#define TBX_GL_RULE(name) template <> struct GLCallRules<GLFunction::name> : GLDefaultRules
+#define TBX_GL_NAMES_RULE(name, countIndex, kind) \
+    TBX_GL_RULE(name) \
+    { \
+        template <size_t Index, typename Arguments> \
+        static GLPointer Describe(const Arguments& args) { return kind((size_t)std::get<countIndex>(args)); } \
+    };
+
+    TBX_GL_RULE(CreateShader) { static constexpr bool ReturnsName = true; };
+    TBX_GL_RULE(CreateProgram) { static constexpr bool ReturnsName = true; };
+
+    TBX_GL_NAMES_RULE(CreateBuffers, 0, Names)
+    TBX_GL_NAMES_RULE(CreateFramebuffers, 0, Names)
+    TBX_GL_NAMES_RULE(CreateQueries, 1, Names)
+    TBX_GL_NAMES_RULE(CreateRenderbuffers, 0, Names)
+    TBX_GL_NAMES_RULE(CreateTextures, 1, Names)
+    TBX_GL_NAMES_RULE(CreateVertexArrays, 0, Names)
+    TBX_GL_NAMES_RULE(DeleteBuffers, 0, Uints)
+    TBX_GL_NAMES_RULE(DeleteFramebuffers, 0, Uints)
+    TBX_GL_NAMES_RULE(DeleteQueries, 0, Uints)
+    TBX_GL_NAMES_RULE(DeleteRenderbuffers, 0, Uints)
+    TBX_GL_NAMES_RULE(DeleteTextures, 0, Uints)
+    TBX_GL_NAMES_RULE(DeleteVertexArrays, 0, Uints)
+    TBX_GL_NAMES_RULE(DebugMessageControl, 3, Uints)
+
+    TBX_GL_RULE(NamedBufferData)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob((size_t)std::get<1>(args)); }
+    };
+
+    TBX_GL_RULE(NamedBufferStorage)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob((size_t)std::get<1>(args)); }
+    };
+
+    TBX_GL_RULE(NamedBufferSubData)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob((size_t)std::get<2>(args)); }
+    };
+
+    TBX_GL_RULE(Uniform1iv)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob((size_t)std::get<1>(args) * sizeof(GLint)); }
+    };
+
+    TBX_GL_RULE(UniformMatrix4fv)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob((size_t)std::get<1>(args) * 16 * sizeof(GLfloat)); }
+    };
+
+    TBX_GL_RULE(GetUniformLocation)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob(std::strlen(std::get<1>(args)) + 1); }
+    };
+
+    TBX_GL_RULE(ShaderSource)
+    {
+        // The strings are recorded null terminated, so the lengths aren't needed
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args)
+        {
+            if constexpr (Index == 2) return { GLPointerKind::Strings, (size_t)std::get<1>(args) };
+            else return { GLPointerKind::Null };
+        }
+    };
+
+    TBX_GL_RULE(ProgramBinary)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Blob((size_t)std::get<3>(args)); }
+    };
+
+    TBX_GL_RULE(GetProgramBinary)
+    {
+        static constexpr bool IsSkippedOnReplay = true;
+
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Scratch(Index == 4 ? (size_t)std::get<1>(args) : DefaultScratchSize); }
+    };
+
+    TBX_GL_RULE(DebugMessageCallback)
+    {
+        static constexpr bool IsSkippedOnReplay = true;
+    };
+
+    TBX_GL_RULE(GetShaderInfoLog)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Scratch(Index == 3 ? (size_t)std::get<1>(args) : DefaultScratchSize); }
+    };
+
+    TBX_GL_RULE(GetProgramInfoLog)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Scratch(Index == 3 ? (size_t)std::get<1>(args) : DefaultScratchSize); }
+    };
+
+    TBX_GL_RULE(GetActiveUniform)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return Scratch(Index == 6 ? (size_t)std::get<2>(args) : DefaultScratchSize); }
+    };
+
+    // Pixels come from client memory unless a pixel buffer is bound, then the pointer is an offset into it
+
+    static size_t GetPixelSize(GLenum format, GLenum type)
+    {
+        size_t components = 4;
+        switch (format)
+        {
+            case GL_RED: case GL_RED_INTEGER: case GL_DEPTH_COMPONENT: case GL_STENCIL_INDEX: components = 1; break;
+            case GL_RG: case GL_RG_INTEGER: case GL_DEPTH_STENCIL: components = 2; break;
+            case GL_RGB: case GL_BGR: case GL_RGB_INTEGER: components = 3; break;
+            default: break;
+        }
+
+        switch (type)
+        {
+            case GL_UNSIGNED_BYTE: case GL_BYTE: return components;
+            case GL_UNSIGNED_SHORT: case GL_SHORT: case GL_HALF_FLOAT: return components * 2;
+            case GL_UNSIGNED_INT: case GL_INT: case GL_FLOAT: return components * 4;
+            // Packed types hold every component in one value
+            case GL_UNSIGNED_SHORT_5_6_5: case GL_UNSIGNED_SHORT_4_4_4_4: case GL_UNSIGNED_SHORT_5_5_5_1: return 2;
+            default: return 4;
+        }
+    }
+
+    template <GLFunction Id>
+    static GLPointer DescribePixels(size_t size)
+    {
+        if (QueryInteger<Id>(GL_PIXEL_UNPACK_BUFFER_BINDING) != 0)
+        {
+            return { GLPointerKind::Value };
+        }
+        return Blob(size);
+    }
+
+    TBX_GL_RULE(TextureSubImage2D)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args)
+        {
+            const auto [texture, level, x, y, width, height, format, type, pixels] = args;
+            return DescribePixels<GLFunction::TextureSubImage2D>((size_t)width * height * GetPixelSize(format, type));
+        }
+    };
+
+    TBX_GL_RULE(TextureSubImage3D)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args)
+        {
+            const auto [texture, level, x, y, z, width, height, depth, format, type, pixels] = args;
+            return DescribePixels<GLFunction::TextureSubImage3D>((size_t)width * height * depth * GetPixelSize(format, type));
+        }
+    };
+
+    TBX_GL_RULE(CompressedTextureSubImage2D)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args) { return DescribePixels<GLFunction::CompressedTextureSubImage2D>((size_t)std::get<7>(args)); }
+    };
+
+    TBX_GL_RULE(GetTextureSubImage)
+    {
+        template <size_t Index, typename Arguments>
+        static GLPointer Describe(const Arguments& args)
+        {
+            if (QueryInteger<GLFunction::GetTextureSubImage>(GL_PIXEL_PACK_BUFFER_BINDING) != 0)
+            {
+                return { GLPointerKind::Value };
+            }
+            return Scratch((size_t)std::get<10>(args));
+        }
+    };
+
+#undef TBX_GL_NAMES_RULE
+#undef TBX_GL_RULE
+
+    /////// Null Driver ///////////////////////////////////
+
+    // Answers just enough for the plugin to believe everything it created works
+    struct GLNullState
+    {
+        GLuint NextName = 1;
+        uint64_t NextSync = 0;
+        GLuint PixelPackBuffer = 0;
+        GLuint PixelUnpackBuffer = 0;
+        std::unordered_map<GLuint, size_t> BufferSizes = {};
+        std::unordered_map<GLuint, std::vector<uint64_t>> BufferMemory = {};
+
+        void CreateNames(GLsizei count, GLuint* names)
+        {
+            for (GLsizei i = 0; i < count; i++)
+            {
+                names[i] = NextName++;
+            }
+        }
+
+        void SetBufferSize(GLuint buffer, size_t size)
+        {
+            BufferSizes[buffer] = size;
+            BufferMemory.erase(buffer);
+        }
+    };
+
+    static GLNullState NullState = {};
+
+    // Converts to a zero of whatever the function returns
+    struct GLZero
+    {
+        template <typename T>
+        operator T() const { return T{}; }
+    };
+
+    template <GLFunction Id>
+    struct GLNullDriver
+    {
+        template <typename... Args>
+        static GLZero Call(Args...) { return {}; }
+    };
+
+#define TBX_GL_NULL(name) template <> struct GLNullDriver<GLFunction::name>
+#define TBX_GL_NULL_CREATE(name) TBX_GL_NULL(name) { static void Call(GLsizei count, GLuint* names) { NullState.CreateNames(count, names); } };
+
+    TBX_GL_NULL_CREATE(CreateBuffers)
+    TBX_GL_NULL_CREATE(CreateFramebuffers)
+    TBX_GL_NULL_CREATE(CreateRenderbuffers)
+    TBX_GL_NULL_CREATE(CreateVertexArrays)
+    TBX_GL_NULL(CreateQueries) { static void Call(GLenum, GLsizei count, GLuint* names) { NullState.CreateNames(count, names); } };
+    TBX_GL_NULL(CreateTextures) { static void Call(GLenum, GLsizei count, GLuint* names) { NullState.CreateNames(count, names); } };
+    TBX_GL_NULL(CreateShader) { static GLuint Call(GLenum) { return NullState.NextName++; } };
+    TBX_GL_NULL(CreateProgram) { static GLuint Call() { return NullState.NextName++; } };
+
+    TBX_GL_NULL(BindBuffer)
+    {
+        static void Call(GLenum target, GLuint buffer)
+        {
+            if (target == GL_PIXEL_PACK_BUFFER) NullState.PixelPackBuffer = buffer;
+            else if (target == GL_PIXEL_UNPACK_BUFFER) NullState.PixelUnpackBuffer = buffer;
+        }
+    };
+
+    TBX_GL_NULL(DeleteBuffers)
+    {
+        static void Call(GLsizei count, const GLuint* buffers)
+        {
+            for (GLsizei i = 0; i < count; i++)
+            {
+                NullState.BufferSizes.erase(buffers[i]);
+                NullState.BufferMemory.erase(buffers[i]);
+                if (NullState.PixelPackBuffer == buffers[i]) NullState.PixelPackBuffer = 0;
+                if (NullState.PixelUnpackBuffer == buffers[i]) NullState.PixelUnpackBuffer = 0;
+            }
+        }
+    };
+
+    TBX_GL_NULL(NamedBufferData) { static void Call(GLuint buffer, GLsizeiptr size, const void*, GLenum) { NullState.SetBufferSize(buffer, (size_t)size); } };
+    TBX_GL_NULL(NamedBufferStorage) { static void Call(GLuint buffer, GLsizeiptr size, const void*, GLbitfield) { NullState.SetBufferSize(buffer, (size_t)size); } };
+
+    TBX_GL_NULL(MapNamedBufferRange)
+    {
+        // Backed by memory that lives as long as the buffer's storage, so persistent mappings stay valid
+        static void* Call(GLuint buffer, GLintptr offset, GLsizeiptr length, GLbitfield)
+        {
+            auto& memory = NullState.BufferMemory[buffer];
+            if (memory.empty())
+            {
+                const auto size = std::max(NullState.BufferSizes[buffer], (size_t)(offset + length));
+                memory.resize(size / sizeof(uint64_t) + 1);
+            }
+            return reinterpret_cast<uint8_t*>(memory.data()) + offset;
+        }
+    };
+
+    TBX_GL_NULL(UnmapNamedBuffer) { static GLboolean Call(GLuint) { return GL_TRUE; } };
+    TBX_GL_NULL(FenceSync) { static GLsync Call(GLenum, GLbitfield) { return reinterpret_cast<GLsync>(++NullState.NextSync); } };
+    TBX_GL_NULL(ClientWaitSync) { static GLenum Call(GLsync, GLbitfield, GLuint64) { return GL_ALREADY_SIGNALED; } };
+    TBX_GL_NULL(CheckNamedFramebufferStatus) { static GLenum Call(GLuint, GLenum) { return GL_FRAMEBUFFER_COMPLETE; } };
+    TBX_GL_NULL(GetUniformLocation) { static GLint Call(GLuint, const GLchar*) { return -1; } };
+    TBX_GL_NULL(GetQueryObjectiv) { static void Call(GLuint, GLenum, GLint* params) { *params = 1; } };
+    TBX_GL_NULL(GetQueryObjectui64v) { static void Call(GLuint, GLenum, GLuint64* params) { *params = 0; } };
+    TBX_GL_NULL(GetInteger64v) { static void Call(GLenum, GLint64* data) { *data = 0; } };
+
+    TBX_GL_NULL(GetIntegerv)
+    {
+        static void Call(GLenum name, GLint* data)
+        {
+            switch (name)
+            {
+                case GL_PIXEL_PACK_BUFFER_BINDING: *data = (GLint)NullState.PixelPackBuffer; break;
+                case GL_PIXEL_UNPACK_BUFFER_BINDING: *data = (GLint)NullState.PixelUnpackBuffer; break;
+                case GL_MAX_ARRAY_TEXTURE_LAYERS: *data = 2048; break;
+                case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+                case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT: *data = 256; break;
+                default: *data = 0; break;
+            }
+        }
+    };
+
+    static GLint GetNullStatus(GLenum name)
+    {
+        switch (name)
+        {
+            case GL_COMPILE_STATUS:
+            case GL_LINK_STATUS:
+            case GL_VALIDATE_STATUS:
+            case GL_COMPLETION_STATUS_KHR:
+                return GL_TRUE;
+            default:
+                return 0;
+        }
+    }
+
+    TBX_GL_NULL(GetShaderiv) { static void Call(GLuint, GLenum name, GLint* params) { *params = GetNullStatus(name); } };
+    TBX_GL_NULL(GetProgramiv) { static void Call(GLuint, GLenum name, GLint* params) { *params = GetNullStatus(name); } };
+
+    static void GetNullInfoLog(GLsizei bufSize, GLsizei* length, GLchar* log)
+    {
+        if (length) *length = 0;
+        if (log && bufSize > 0) log[0] = '\0';
+    }
+
+    TBX_GL_NULL(GetShaderInfoLog) { static void Call(GLuint, GLsizei bufSize, GLsizei* length, GLchar* log) { GetNullInfoLog(bufSize, length, log); } };
+    TBX_GL_NULL(GetProgramInfoLog) { static void Call(GLuint, GLsizei bufSize, GLsizei* length, GLchar* log) { GetNullInfoLog(bufSize, length, log); } };
+    TBX_GL_NULL(GetProgramBinary) { static void Call(GLuint, GLsizei, GLsizei* length, GLenum* format, void*) { if (length) *length = 0; if (format) *format = 0; } };
+
+    TBX_GL_NULL(GetTextureSubImage)
+    {
+        static void Call(GLuint, GLint, GLint, GLint, GLint, GLsizei, GLsizei, GLsizei, GLenum, GLenum, GLsizei bufSize, void* pixels)
+        {
+            if (!NullState.PixelPackBuffer)
+            {
+                std::memset(pixels, 0, (size_t)bufSize);
+            }
+        }
+    };
+
+    TBX_GL_NULL(GetString)
+    {
+        static const GLubyte* Call(GLenum name)
+        {
+            switch (name)
+            {
+                case GL_VENDOR: return reinterpret_cast<const GLubyte*>("Toybox");
+                case GL_RENDERER: return reinterpret_cast<const GLubyte*>("Null");
+                case GL_VERSION: return reinterpret_cast<const GLubyte*>("4.5 Null");
+                case GL_SHADING_LANGUAGE_VERSION: return reinterpret_cast<const GLubyte*>("4.50");
+                default: return reinterpret_cast<const GLubyte*>("");
+            }
+        }
+    };
+
+#undef TBX_GL_NULL_CREATE
+#undef TBX_GL_NULL
+
+    /////// Hooks ///////////////////////////////////
+
+    template <GLFunction Id, auto Slot, typename Function>
+    struct GLHook;
+
+    // Takes the place of glad's pointer to one GL function
+    template <GLFunction Id, auto Slot, typename Ret, typename... Args>
+    struct GLHook<Id, Slot, Ret (APIENTRYP)(Args...)>
+    {
+        using Function = Ret (APIENTRYP)(Args...);
+        using Arguments = std::tuple<Args...>;
+        using Rules = GLCallRules<Id>;
+
+        // Where calls go after being counted, the driver's function or the null driver's
+        static inline Function Next = nullptr;
+        static inline Function Original = nullptr;
+        static inline bool IsInstalled = false;
+
+        static void Install(GLTracerMode mode)
+        {
+            Original = *Slot;
+            Next = mode == GLTracerMode::Null ? &CallNull : Original;
+            // Functions the driver doesn't have stay null, so checks for them still work
+            if (Next)
+            {
+                *Slot = &Call;
+                IsInstalled = true;
+            }
+        }
+
+        static void Uninstall()
+        {
+            if (IsInstalled)
+            {
+                *Slot = Original;
+                IsInstalled = false;
+            }
+        }
+
+        static Ret APIENTRY Call(Args... args)
+        {
+            auto& tracer = OpenGLCallTracer::Get();
+            tracer.OnCall(Id, TBX_GL_RETURN_ADDRESS());
+            if (!tracer._traceFile)
+            {
+                return Next(args...);
+            }
+
+            auto& trace = tracer._traceBuffer;
+            const Arguments arguments = { args... };
+            Write(trace, (uint16_t)Id);
+            WriteArguments(trace, arguments, std::index_sequence_for<Args...>{});
+
+            if constexpr (std::is_void_v<Ret>)
+            {
+                Next(args...);
+                WriteOutputs(trace, arguments, std::index_sequence_for<Args...>{});
+                tracer.FlushTrace();
+            }
+            else
+            {
+                Ret result = Next(args...);
+                if constexpr (Rules::ReturnsName) Write(trace, result);
+                else if constexpr (IsSync<Ret>) Write(trace, (uint64_t)reinterpret_cast<uintptr_t>(result));
+                WriteOutputs(trace, arguments, std::index_sequence_for<Args...>{});
+                tracer.FlushTrace();
+                return result;
+            }
+        }
+
+        static Ret APIENTRY CallNull(Args... args)
+        {
+            if constexpr (std::is_void_v<Ret>) GLNullDriver<Id>::Call(args...);
+            else return GLNullDriver<Id>::Call(args...);
+        }
+
+        template <size_t Index>
+        static GLPointer DescribePointer(const Arguments& arguments)
+        {
+            using T = std::tuple_element_t<Index, Arguments>;
+            if (!std::get<Index>(arguments))
+            {
+                return { GLPointerKind::Null };
+            }
+
+            auto pointer = Rules::template Describe<Index>(arguments);
+            if (pointer.Kind == GLPointerKind::Default)
+            {
+                pointer = std::is_const_v<std::remove_pointer_t<T>> ? GLPointer{ GLPointerKind::Value } : Scratch(DefaultScratchSize);
+            }
+            return pointer;
+        }
+
+        template <size_t... Indices>
+        static void WriteArguments(std::vector<uint8_t>& trace, const Arguments& arguments, std::index_sequence<Indices...>)
+        {
+            (WriteArgument<Indices>(trace, arguments), ...);
+        }
+
+        template <size_t Index>
+        static void WriteArgument(std::vector<uint8_t>& trace, const Arguments& arguments)
+        {
+            using T = std::tuple_element_t<Index, Arguments>;
+            const auto& value = std::get<Index>(arguments);
+            if constexpr (IsSync<T>)
+            {
+                Write(trace, (uint64_t)reinterpret_cast<uintptr_t>(value));
+            }
+            else if constexpr (IsFunctionPointer<T>)
+            {
+                // Points into the recording process, replayed as null
+            }
+            else if constexpr (IsDataPointer<T>)
+            {
+                const auto pointer = DescribePointer<Index>(arguments);
+                Write(trace, pointer.Kind);
+                switch (pointer.Kind)
+                {
+                    case GLPointerKind::Value:
+                        Write(trace, (uint64_t)reinterpret_cast<uintptr_t>(value));
+                        break;
+                    case GLPointerKind::Blob:
+                        WriteBytes(trace, value, pointer.Size);
+                        break;
+                    case GLPointerKind::Scratch:
+                    case GLPointerKind::Names:
+                        Write(trace, (uint32)pointer.Size);
+                        break;
+                    case GLPointerKind::Strings:
+                        if constexpr (std::is_same_v<T, const GLchar* const*>)
+                        {
+                            const auto* lengths = std::get<3>(arguments);
+                            Write(trace, (uint32)pointer.Size);
+                            for (size_t i = 0; i < pointer.Size; i++)
+                            {
+                                const size_t length = lengths && lengths[i] >= 0 ? (size_t)lengths[i] : std::strlen(value[i]);
+                                WriteBytes(trace, value[i], length);
+                            }
+                        }
+                        break;
+                    default:
+                        break;
+                }
+            }
+            else
+            {
+                Write(trace, value);
+            }
+        }
+
+        template <size_t... Indices>
+        static void WriteOutputs(std::vector<uint8_t>& trace, const Arguments& arguments, std::index_sequence<Indices...>)
+        {
+            (WriteOutput<Indices>(trace, arguments), ...);
+        }
+
+        template <size_t Index>
+        static void WriteOutput(std::vector<uint8_t>& trace, const Arguments& arguments)
+        {
+            using T = std::tuple_element_t<Index, Arguments>;
+            if constexpr (IsDataPointer<T> && !std::is_const_v<std::remove_pointer_t<T>>)
+            {
+                const auto pointer = DescribePointer<Index>(arguments);
+                if (pointer.Kind == GLPointerKind::Names)
+                {
+                    const auto* bytes = reinterpret_cast<const uint8_t*>(std::get<Index>(arguments));
+                    trace.insert(trace.end(), bytes, bytes + pointer.Size);
+                }
+            }
+        }
+
+        static void Replay(GLTraceReader& reader, GLReplayContext& context)
+        {
+            context.ScratchUsed = 0;
+            context.StringsUsed = 0;
+
+            Arguments arguments = {};
+            std::vector<std::pair<uint32, const uint8_t*>> names = {};
+            ReadArguments(reader, context, arguments, names, std::index_sequence_for<Args...>{});
+            if (!reader.IsValid)
+            {
+                return;
+            }
+
+            if constexpr (Rules::IsSkippedOnReplay)
+            {
+                context.Stats.SkippedCalls++;
+                return;
+            }
+            else
+            {
+                // Through glad, so the replay is counted when the tracer is installed
+                if constexpr (std::is_void_v<Ret>)
+                {
+                    std::apply(*Slot, arguments);
+                }
+                else
+                {
+                    Ret result = std::apply(*Slot, arguments);
+                    if constexpr (Rules::ReturnsName)
+                    {
+                        if (reader.Read<GLuint>() != result) context.Stats.NameMismatches++;
+                    }
+                    else if constexpr (IsSync<Ret>)
+                    {
+                        context.Syncs[reader.Read<uint64_t>()] = result;
+                    }
+                }
+
+                for (const auto& [size, replayed] : names)
+                {
+                    const auto* recorded = reader.ReadBytes(size);
+                    if (recorded && std::memcmp(recorded, replayed, size) != 0) context.Stats.NameMismatches++;
+                }
+            }
+        }
+
+        template <size_t... Indices>
+        static void ReadArguments(GLTraceReader& reader, GLReplayContext& context, Arguments& arguments, std::vector<std::pair<uint32, const uint8_t*>>& names, std::index_sequence<Indices...>)
+        {
+            (ReadArgument<Indices>(reader, context, arguments, names), ...);
+        }
+
+        template <size_t Index>
+        static void ReadArgument(GLTraceReader& reader, GLReplayContext& context, Arguments& arguments, std::vector<std::pair<uint32, const uint8_t*>>& names)
+        {
+            using T = std::tuple_element_t<Index, Arguments>;
+            auto& value = std::get<Index>(arguments);
+            if constexpr (IsSync<T>)
+            {
+                const auto it = context.Syncs.find(reader.Read<uint64_t>());
+                value = it != context.Syncs.end() ? it->second : nullptr;
+            }
+            else if constexpr (IsFunctionPointer<T>)
+            {
+                value = nullptr;
+            }
+            else if constexpr (IsDataPointer<T>)
+            {
+                const auto kind = reader.Read<GLPointerKind>();
+                switch (kind)
+                {
+                    case GLPointerKind::Value:
+                        value = reinterpret_cast<T>((uintptr_t)reader.Read<uint64_t>());
+                        break;
+                    case GLPointerKind::Blob:
+                    {
+                        const auto size = reader.Read<uint32>();
+                        const auto* bytes = reader.ReadBytes(size);
+                        // Used in place unless it's misaligned for what the call reads
+                        if (bytes && reinterpret_cast<uintptr_t>(bytes) % alignof(uint64_t) != 0)
+                        {
+                            auto* copy = context.Allocate(size);
+                            std::memcpy(copy, bytes, size);
+                            bytes = static_cast<const uint8_t*>(copy);
+                        }
+                        value = (T)(bytes);
+                        break;
+                    }
+                    case GLPointerKind::Strings:
+                    {
+                        if (context.StringsUsed == context.Strings.size()) context.Strings.emplace_back();
+                        auto& strings = context.Strings[context.StringsUsed++];
+                        strings.clear();
+
+                        const auto count = reader.Read<uint32>();
+                        for (uint32 i = 0; i < count && reader.IsValid; i++)
+                        {
+                            const auto length = reader.Read<uint32>();
+                            const auto* bytes = reader.ReadBytes(length);
+                            auto* string = static_cast<GLchar*>(context.Allocate(length + 1));
+                            if (bytes) std::memcpy(string, bytes, length);
+                            string[length] = '\0';
+                            strings.push_back(string);
+                        }
+                        value = (T)(strings.data());
+                        break;
+                    }
+                    case GLPointerKind::Scratch:
+                    case GLPointerKind::Names:
+                    {
+                        const auto size = reader.Read<uint32>();
+                        auto* memory = context.Allocate(size);
+                        value = (T)(memory);
+                        if (kind == GLPointerKind::Names)
+                        {
+                            names.emplace_back(size, static_cast<const uint8_t*>(memory));
+                        }
+                        break;
+                    }
+                    default:
+                        value = nullptr;
+                        break;
+                }
+            }
+            else
+            {
+                value = reader.Read<T>();
+            }
+        }
+    };
+
+#define TBX_GL_HOOK(name) GLHook<GLFunction::name, &glad_gl##name, decltype(glad_gl##name)>
+
+    template <GLFunction Id>
+    static GLint QueryInteger(GLenum name)
+    {
+        // Straight to the driver, so the query isn't counted or recorded
+        GLint value = 0;
+        TBX_GL_HOOK(GetIntegerv)::Next(name, &value);
+        return value;
+    }
+
+    using GLReplayFunction = void (*)(GLTraceReader&, GLReplayContext&);
+
+    static constexpr GLReplayFunction ReplayFunctions[] =
+    {
+#define TBX_GL_REPLAY_FUNCTION(name) &TBX_GL_HOOK(name)::Replay,
+        TBX_GL_FUNCTIONS(TBX_GL_REPLAY_FUNCTION)
+#undef TBX_GL_REPLAY_FUNCTION
+    };
+
+    static constexpr std::string_view FunctionNames[] =
+    {
+#define TBX_GL_FUNCTION_NAME(name) "gl" #name,
+        TBX_GL_FUNCTIONS(TBX_GL_FUNCTION_NAME)
+#undef TBX_GL_FUNCTION_NAME
+    };
+
+    /////// Tracer ///////////////////////////////////
+
+    OpenGLCallTracer& OpenGLCallTracer::Get()
+    {
+        static OpenGLCallTracer tracer = {};
+        return tracer;
+    }
+
+    OpenGLCallTracer::~OpenGLCallTracer()
+    {
+        StopRecording();
+        Uninstall();
+    }
+
+    void OpenGLCallTracer::Install(GLTracerMode mode)
+    {
+        TBX_ASSERT(!_isInstalled, "GL Rendering: The call tracer is already installed!");
+        TBX_ASSERT(mode == GLTracerMode::Null || glad_glGetString, "GL Rendering: Load GL before installing the call tracer!");
+
+        if (mode == GLTracerMode::Null)
+        {
+            // The plugin checks for 4.5 before doing anything
+            NullState = {};
+            GLVersion.major = 4;
+            GLVersion.minor = 5;
+        }
+
+#define TBX_GL_INSTALL(name) TBX_GL_HOOK(name)::Install(mode);
+        TBX_GL_FUNCTIONS(TBX_GL_INSTALL)
+#undef TBX_GL_INSTALL
+
+        _mode = mode;
+        _isInstalled = true;
+        _frameCounts = {};
+        _lastFrameCounts = {};
+    }
+
+    void OpenGLCallTracer::Uninstall()
+    {
+        if (!_isInstalled)
+        {
+            return;
+        }
+
+        StopRecording();
+#define TBX_GL_UNINSTALL(name) TBX_GL_HOOK(name)::Uninstall();
+        TBX_GL_FUNCTIONS(TBX_GL_UNINSTALL)
+#undef TBX_GL_UNINSTALL
+
+        if (_mode == GLTracerMode::Null)
+        {
+            GLVersion.major = 0;
+            GLVersion.minor = 0;
+        }
+        _isInstalled = false;
+    }
+
+    void OpenGLCallTracer::OnCall(GLFunction function, const void* callSite)
+    {
+        _frameCounts[(size_t)function]++;
+        if (_isTrackingCallSites)
+        {
+            auto& site = _callSites[callSite];
+            site.Function = function;
+            site.Address = callSite;
+            site.Calls++;
+        }
+    }
+
+    void OpenGLCallTracer::EndFrame()
+    {
+        _lastFrameCounts = _frameCounts;
+        _frameCounts = {};
+
+        if (_traceFile)
+        {
+            Write(_traceBuffer, TraceFrameMarker);
+            std::fwrite(_traceBuffer.data(), 1, _traceBuffer.size(), _traceFile);
+            _traceBuffer.clear();
+        }
+    }
+
+    uint64_t OpenGLCallTracer::GetLastFrameCallCount() const
+    {
+        uint64_t count = 0;
+        for (const auto calls : _lastFrameCounts)
+        {
+            count += calls;
+        }
+        return count;
+    }
+
+    std::vector<OpenGLCallTracer::CallSite> OpenGLCallTracer::GetCallSites() const
+    {
+        std::vector<CallSite> sites = {};
+        sites.reserve(_callSites.size());
+        for (const auto& [address, site] : _callSites)
+        {
+            sites.push_back(site);
+        }
+        std::sort(sites.begin(), sites.end(), [](const CallSite& a, const CallSite& b) { return a.Calls > b.Calls; });
+        return sites;
+    }
+
+    bool OpenGLCallTracer::StartRecording(const std::filesystem::path& path)
+    {
+        TBX_ASSERT(_isInstalled, "GL Rendering: Install the call tracer before recording!");
+        StopRecording();
+
+        _traceFile = std::fopen(path.string().c_str(), "wb");
+        if (!_traceFile)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to open {} to record GL calls to!", path.string());
+            return false;
+        }
+
+        _traceBuffer.clear();
+        _traceBuffer.insert(_traceBuffer.end(), std::begin(TraceMagic), std::end(TraceMagic));
+        Write(_traceBuffer, TraceVersion);
+        Write(_traceBuffer, (uint16_t)GLFunction::Count);
+        return true;
+    }
+
+    void OpenGLCallTracer::StopRecording()
+    {
+        if (!_traceFile)
+        {
+            return;
+        }
+
+        std::fwrite(_traceBuffer.data(), 1, _traceBuffer.size(), _traceFile);
+        std::fclose(_traceFile);
+        _traceFile = nullptr;
+        _traceBuffer.clear();
+    }
+
+    void OpenGLCallTracer::FlushTrace()
+    {
+        if (_traceBuffer.size() >= TraceFlushSize)
+        {
+            std::fwrite(_traceBuffer.data(), 1, _traceBuffer.size(), _traceFile);
+            _traceBuffer.clear();
+        }
+    }
+
+    std::optional<OpenGLCallTracer::ReplayStats> OpenGLCallTracer::Replay(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary | std::ios::ate);
+        if (!file)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to open GL trace {}!", path.string());
+            return std::nullopt;
+        }
+
+        // Loaded whole into 8 byte aligned memory, blobs are handed to GL straight from it
+        const auto size = (size_t)file.tellg();
+        std::vector<uint64_t> data(size / sizeof(uint64_t) + 1);
+        file.seekg(0);
+        file.read(reinterpret_cast<char*>(data.data()), (std::streamsize)size);
+
+        GLTraceReader reader = {};
+        reader.Position = reinterpret_cast<const uint8_t*>(data.data());
+        reader.End = reader.Position + size;
+
+        const auto* magic = reader.ReadBytes(sizeof(TraceMagic));
+        const auto version = reader.Read<uint32>();
+        const auto functionCount = reader.Read<uint16_t>();
+        if (!magic || std::memcmp(magic, TraceMagic, sizeof(TraceMagic)) != 0 || version != TraceVersion || functionCount != (uint16_t)GLFunction::Count)
+        {
+            TBX_TRACE_ERROR("GL Rendering: {} isn't a GL trace this build can replay!", path.string());
+            return std::nullopt;
+        }
+
+        ReplayStats stats = {};
+        GLReplayContext context = { stats };
+
+        using Clock = std::chrono::steady_clock;
+        const auto start = Clock::now();
+        auto frameStart = start;
+        while (reader.Position < reader.End && reader.IsValid)
+        {
+            const auto id = reader.Read<uint16_t>();
+            if (id == TraceFrameMarker)
+            {
+                const auto now = Clock::now();
+                stats.FrameMilliseconds.push_back(std::chrono::duration<double, std::milli>(now - frameStart).count());
+                stats.Frames++;
+                frameStart = now;
+                continue;
+            }
+            if (id >= (uint16_t)GLFunction::Count)
+            {
+                TBX_TRACE_ERROR("GL Rendering: Unknown function {} in GL trace {}!", id, path.string());
+                return std::nullopt;
+            }
+
+            ReplayFunctions[id](reader, context);
+            stats.Calls++;
+        }
+
+        // Finish, so the time covers the GPU executing the trace rather than just the driver queueing it
+        glFinish();
+        stats.Seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+        if (!reader.IsValid)
+        {
+            TBX_TRACE_WARNING("GL Rendering: GL trace {} is truncated, replayed {} calls", path.string(), stats.Calls);
+        }
+        if (stats.NameMismatches)
+        {
+            TBX_TRACE_WARNING("GL Rendering: {} objects got different names replaying {}, the context wasn't fresh", stats.NameMismatches, path.string());
+        }
+        return stats;
+    }
+
+    std::string_view OpenGLCallTracer::GetFunctionName(GLFunction function)
+    {
+        return function < GLFunction::Count ? FunctionNames[(size_t)function] : "";
+    }
+}
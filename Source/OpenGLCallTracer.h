@@ -0,0 +1,227 @@
+#pragma once
+#include <Tbx/Math/Int.h>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Every GL entry point the plugin calls, these are the ones the call tracer hooks.
+// Anything calling a new entry point has to add it here, or it goes uncounted and is missing in null mode.
+#define TBX_GL_FUNCTIONS(X) \
+    X(AttachShader) \
+    X(BindBuffer) \
+    X(BindBufferRange) \
+    X(BindFramebuffer) \
+    X(BindImageTexture) \
+    X(BindTexture) \
+    X(BindTextureUnit) \
+    X(BindVertexArray) \
+    X(BlendFunc) \
+    X(BlitNamedFramebuffer) \
+    X(CheckNamedFramebufferStatus) \
+    X(Clear) \
+    X(ClearColor) \
+    X(ClearDepth) \
+    X(ClearTexSubImage) \
+    X(ClientWaitSync) \
+    X(CompileShader) \
+    X(CompressedTextureSubImage2D) \
+    X(CopyNamedBufferSubData) \
+    X(CreateBuffers) \
+    X(CreateFramebuffers) \
+    X(CreateProgram) \
+    X(CreateQueries) \
+    X(CreateRenderbuffers) \
+    X(CreateShader) \
+    X(CreateTextures) \
+    X(CreateVertexArrays) \
+    X(DebugMessageCallback) \
+    X(DebugMessageControl) \
+    X(DeleteBuffers) \
+    X(DeleteFramebuffers) \
+    X(DeleteProgram) \
+    X(DeleteQueries) \
+    X(DeleteRenderbuffers) \
+    X(DeleteShader) \
+    X(DeleteSync) \
+    X(DeleteTextures) \
+    X(DeleteVertexArrays) \
+    X(DepthFunc) \
+    X(DepthMask) \
+    X(DetachShader) \
+    X(Disable) \
+    X(DispatchCompute) \
+    X(DrawElements) \
+    X(DrawElementsBaseVertex) \
+    X(DrawElementsInstancedBaseInstance) \
+    X(DrawElementsInstancedBaseVertexBaseInstance) \
+    X(Enable) \
+    X(EnableVertexArrayAttrib) \
+    X(FenceSync) \
+    X(Finish) \
+    X(GenerateTextureMipmap) \
+    X(GetActiveUniform) \
+    X(GetInteger64v) \
+    X(GetIntegerv) \
+    X(GetProgramBinary) \
+    X(GetProgramInfoLog) \
+    X(GetProgramiv) \
+    X(GetQueryObjectiv) \
+    X(GetQueryObjectui64v) \
+    X(GetShaderInfoLog) \
+    X(GetShaderiv) \
+    X(GetString) \
+    X(GetTextureLevelParameteriv) \
+    X(GetTextureParameteriv) \
+    X(GetTextureSubImage) \
+    X(GetUniformLocation) \
+    X(LinkProgram) \
+    X(MapNamedBufferRange) \
+    X(MaxShaderCompilerThreadsKHR) \
+    X(MemoryBarrier) \
+    X(MultiDrawElementsIndirect) \
+    X(MultiDrawElementsIndirectCount) \
+    X(MultiDrawElementsIndirectCountARB) \
+    X(NamedBufferData) \
+    X(NamedBufferStorage) \
+    X(NamedBufferSubData) \
+    X(NamedFramebufferRenderbuffer) \
+    X(NamedFramebufferTexture) \
+    X(NamedFramebufferTextureLayer) \
+    X(NamedRenderbufferStorage) \
+    X(PixelStorei) \
+    X(ProgramBinary) \
+    X(ProgramParameteri) \
+    X(QueryCounter) \
+    X(ShaderSource) \
+    X(TextureParameteri) \
+    X(TextureStorage2D) \
+    X(TextureStorage3D) \
+    X(TextureSubImage2D) \
+    X(TextureSubImage3D) \
+    X(Uniform1f) \
+    X(Uniform1i) \
+    X(Uniform1iv) \
+    X(Uniform2f) \
+    X(Uniform3f) \
+    X(Uniform4f) \
+    X(UniformMatrix4fv) \
+    X(UnmapNamedBuffer) \
+    X(UseProgram) \
+    X(VertexArrayAttribBinding) \
+    X(VertexArrayAttribFormat) \
+    X(VertexArrayAttribIFormat) \
+    X(VertexArrayBindingDivisor) \
+    X(VertexArrayElementBuffer) \
+    X(VertexArrayVertexBuffer) \
+    X(Viewport)
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    enum class GLFunction : uint16_t
+    {
+#define TBX_GL_FUNCTION_ENUM(name) name,
+        TBX_GL_FUNCTIONS(TBX_GL_FUNCTION_ENUM)
+#undef TBX_GL_FUNCTION_ENUM
+        Count
+    };
+
+    enum class GLTracerMode
+    {
+        // Calls reach the driver, they are only counted and recorded on the way
+        Passthrough,
+        // Nothing reaches a driver, a fake one answers just enough for the plugin's logic to run without GL
+        Null
+    };
+
+    // Intercepts the plugin's GL calls by swapping glad's function pointers for counting wrappers.
+    // Counts every entry point per frame and optionally per call site, and can record a binary trace of
+    // the calls and their arguments that replays on another context, e.g. llvmpipe, for benchmarking.
+    // GL calls are made on the render thread only, and so must everything here.
+    class OpenGLCallTracer final
+    {
+    public:
+        using CallCounts = std::array<uint32, (size_t)GLFunction::Count>;
+
+        struct CallSite
+        {
+            GLFunction Function = GLFunction::Count;
+            // Return address of the call, symbolize it with addr2line or a debugger
+            const void* Address = nullptr;
+            uint64_t Calls = 0;
+        };
+
+        struct ReplayStats
+        {
+            uint64_t Calls = 0;
+            uint32 Frames = 0;
+            // Calls that only make sense in the recording process, like reading back program binaries
+            uint32 SkippedCalls = 0;
+            // Objects that got a different name than while recording, the replay draws garbage after the first
+            uint32 NameMismatches = 0;
+            double Seconds = 0.0;
+            std::vector<double> FrameMilliseconds = {};
+        };
+
+        static OpenGLCallTracer& Get();
+
+        ~OpenGLCallTracer();
+
+        OpenGLCallTracer(const OpenGLCallTracer&) = delete;
+        OpenGLCallTracer& operator=(const OpenGLCallTracer&) = delete;
+
+        // Passthrough needs glad loaded first, null mode needs nothing and should be installed before the plugin initializes.
+        void Install(GLTracerMode mode);
+        void Uninstall();
+        bool IsInstalled() const { return _isInstalled; }
+        GLTracerMode GetMode() const { return _mode; }
+
+        // Closes the frame's counts, the plugin calls it at the end of every frame.
+        void EndFrame();
+        const CallCounts& GetLastFrameCounts() const { return _lastFrameCounts; }
+        const CallCounts& GetCurrentFrameCounts() const { return _frameCounts; }
+        uint64_t GetLastFrameCallCount() const;
+
+        // Call sites cost a hash lookup per call, so they are only tracked when enabled.
+        void SetCallSiteTracking(bool enabled) { _isTrackingCallSites = enabled; }
+        std::vector<CallSite> GetCallSites() const;
+        void ResetCallSites() { _callSites.clear(); }
+
+        // Start recording before the plugin initializes to get a trace that replays on its own, calls using objects
+        // created before recording started fail on replay. What is written through mapped buffer pointers isn't recorded.
+        bool StartRecording(const std::filesystem::path& path);
+        void StopRecording();
+        bool IsRecording() const { return _traceFile != nullptr; }
+
+        // Replays a trace on the current context, which should be fresh so GL hands out the same names as while recording.
+        static std::optional<ReplayStats> Replay(const std::filesystem::path& path);
+
+        static std::string_view GetFunctionName(GLFunction function);
+
+    private:
+        template <GLFunction Id, auto Slot, typename Function>
+        friend struct GLHook;
+
+        OpenGLCallTracer() = default;
+
+        void OnCall(GLFunction function, const void* callSite);
+        void FlushTrace();
+
+    private:
+        bool _isInstalled = false;
+        GLTracerMode _mode = GLTracerMode::Passthrough;
+
+        CallCounts _frameCounts = {};
+        CallCounts _lastFrameCounts = {};
+
+        bool _isTrackingCallSites = false;
+        std::unordered_map<const void*, CallSite> _callSites = {};
+
+        std::FILE* _traceFile = nullptr;
+        std::vector<uint8_t> _traceBuffer = {};
+    };
+}
@@ -0,0 +1,281 @@
+#include "OpenGLCommandBuffer.h"
+#include <Tbx/Debug/Asserts.h>
+#include <cstring>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    /// Commands ////////////////////////////////////////////////////////////////
+
+    // Every command starts with its header, followed by its arguments
+    struct GLCommandHeader
+    {
+        GLCommandType Type = GLCommandType::Activate;
+        uint16_t Size = 0;
+    };
+
+    struct UseProgramCommand
+    {
+        GLCommandHeader Header = { GLCommandType::UseProgram };
+        OpenGLShaderProgram* Program = nullptr;
+    };
+
+    struct UploadUniformCommand
+    {
+        GLCommandHeader Header = { GLCommandType::UploadUniform };
+        OpenGLShaderProgram* Program = nullptr;
+        uint32 Handle = 0;
+        UniformValue Value = {};
+    };
+
+    struct BindTextureCommand
+    {
+        GLCommandHeader Header = { GLCommandType::BindTexture };
+        TextureResource* Texture = nullptr;
+        uint32 Slot = 0;
+    };
+
+    struct ResourceCommand
+    {
+        GLCommandHeader Header = {};
+        GraphicsResource* Resource = nullptr;
+    };
+
+    struct DrawCommand
+    {
+        GLCommandHeader Header = { GLCommandType::Draw };
+        MeshResource* Mesh = nullptr;
+    };
+
+    struct DrawInstancedCommand
+    {
+        GLCommandHeader Header = { GLCommandType::DrawInstanced };
+        OpenGLMesh* Mesh = nullptr;
+        uint32 InstanceCount = 0;
+        uint32 BaseInstance = 0;
+    };
+
+    struct StateCommand
+    {
+        GLCommandHeader Header = {};
+        uint32 Value = 0;
+        uint32 OtherValue = 0;
+    };
+
+    /// Recording ///////////////////////////////////////////////////////////////
+
+    template <typename TCommand>
+    void OpenGLCommandBuffer::Record(const TCommand& command)
+    {
+        static_assert(std::is_trivially_copyable_v<TCommand>, "Commands are copied around as bytes!");
+        constexpr auto size = (uint32)((sizeof(TCommand) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1));
+        static_assert(size <= BlockSize, "Command doesn't fit in a block!");
+
+        if (_blocks.empty() || _blocks[_currentBlock].Used + size > BlockSize)
+        {
+            if (!_blocks.empty())
+            {
+                _currentBlock++;
+            }
+            if (_currentBlock == _blocks.size())
+            {
+                _blocks.push_back({ std::make_unique<std::byte[]>(BlockSize), 0 });
+            }
+        }
+
+        auto& block = _blocks[_currentBlock];
+        auto* destination = block.Data.get() + block.Used;
+        std::memcpy(destination, &command, sizeof(TCommand));
+        reinterpret_cast<GLCommandHeader*>(destination)->Size = (uint16_t)size;
+        block.Used += size;
+        _commandCount++;
+    }
+
+    template <typename TResource>
+    TResource* OpenGLCommandBuffer::Hold(const Ref<TResource>& resource)
+    {
+        TBX_ASSERT(resource, "GL Rendering: Recorded a command for a null resource!");
+
+        // Commands on the same resource usually come in a row, only hold it once for them
+        if (_resources.empty() || _resources.back().get() != resource.get())
+        {
+            _resources.push_back(resource);
+        }
+        return resource.get();
+    }
+
+    void OpenGLCommandBuffer::UseProgram(const Ref<OpenGLShaderProgram>& program)
+    {
+        Record(UseProgramCommand{ .Program = Hold(program) });
+    }
+
+    void OpenGLCommandBuffer::Upload(const Ref<OpenGLShaderProgram>& program, uint32 handle, const UniformValue& value)
+    {
+        Record(UploadUniformCommand{ .Program = Hold(program), .Handle = handle, .Value = value });
+    }
+
+    void OpenGLCommandBuffer::BindTexture(const Ref<TextureResource>& texture, uint32 slot)
+    {
+        Record(BindTextureCommand{ .Texture = Hold(texture), .Slot = slot });
+    }
+
+    void OpenGLCommandBuffer::Activate(const Ref<GraphicsResource>& resource)
+    {
+        Record(ResourceCommand{ .Header = { GLCommandType::Activate }, .Resource = Hold(resource) });
+    }
+
+    void OpenGLCommandBuffer::Release(const Ref<GraphicsResource>& resource)
+    {
+        Record(ResourceCommand{ .Header = { GLCommandType::Release }, .Resource = Hold(resource) });
+    }
+
+    void OpenGLCommandBuffer::Draw(const Ref<MeshResource>& mesh)
+    {
+        Record(DrawCommand{ .Mesh = Hold(mesh) });
+    }
+
+    void OpenGLCommandBuffer::DrawInstanced(const Ref<OpenGLMesh>& mesh, uint32 instanceCount, uint32 baseInstance)
+    {
+        Record(DrawInstancedCommand{ .Mesh = Hold(mesh), .InstanceCount = instanceCount, .BaseInstance = baseInstance });
+    }
+
+    void OpenGLCommandBuffer::SetEnabled(uint32 capability, bool enabled)
+    {
+        Record(StateCommand{ .Header = { GLCommandType::SetEnabled }, .Value = capability, .OtherValue = enabled });
+    }
+
+    void OpenGLCommandBuffer::SetDepthMask(bool enabled)
+    {
+        Record(StateCommand{ .Header = { GLCommandType::SetDepthMask }, .Value = enabled });
+    }
+
+    void OpenGLCommandBuffer::SetDepthFunc(uint32 func)
+    {
+        Record(StateCommand{ .Header = { GLCommandType::SetDepthFunc }, .Value = func });
+    }
+
+    void OpenGLCommandBuffer::SetBlendFunc(uint32 srcFactor, uint32 dstFactor)
+    {
+        Record(StateCommand{ .Header = { GLCommandType::SetBlendFunc }, .Value = srcFactor, .OtherValue = dstFactor });
+    }
+
+    void OpenGLCommandBuffer::Reset()
+    {
+        for (auto& block : _blocks)
+        {
+            block.Used = 0;
+        }
+        _currentBlock = 0;
+        _commandCount = 0;
+        _resources.clear();
+    }
+
+    uint64_t OpenGLCommandBuffer::GetSizeInBytes() const
+    {
+        uint64_t size = 0;
+        for (const auto& block : _blocks)
+        {
+            size += block.Used;
+        }
+        return size;
+    }
+
+    /// Execution ///////////////////////////////////////////////////////////////
+
+    void OpenGLCommandBuffer::Execute(OpenGLStateCache& state) const
+    {
+        // Draws are skipped while the recorded program is still building or failed to
+        bool isProgramReady = true;
+        for (const auto& block : _blocks)
+        {
+            uint32 offset = 0;
+            while (offset < block.Used)
+            {
+                const auto* data = block.Data.get() + offset;
+                const auto& header = *reinterpret_cast<const GLCommandHeader*>(data);
+                switch (header.Type)
+                {
+                    case GLCommandType::UseProgram:
+                    {
+                        isProgramReady = reinterpret_cast<const UseProgramCommand*>(data)->Program->TryActivate();
+                        break;
+                    }
+                    case GLCommandType::UploadUniform:
+                    {
+                        const auto* command = reinterpret_cast<const UploadUniformCommand*>(data);
+                        command->Program->Upload(command->Handle, command->Value);
+                        break;
+                    }
+                    case GLCommandType::BindTexture:
+                    {
+                        const auto* command = reinterpret_cast<const BindTextureCommand*>(data);
+                        command->Texture->SetSlot(command->Slot);
+                        command->Texture->Activate();
+                        break;
+                    }
+                    case GLCommandType::Activate:
+                    {
+                        reinterpret_cast<const ResourceCommand*>(data)->Resource->Activate();
+                        break;
+                    }
+                    case GLCommandType::Release:
+                    {
+                        reinterpret_cast<const ResourceCommand*>(data)->Resource->Release();
+                        break;
+                    }
+                    case GLCommandType::Draw:
+                    {
+                        if (!isProgramReady)
+                        {
+                            break;
+                        }
+                        auto* mesh = reinterpret_cast<const DrawCommand*>(data)->Mesh;
+                        mesh->Activate();
+                        mesh->Draw();
+                        mesh->Release();
+                        break;
+                    }
+                    case GLCommandType::DrawInstanced:
+                    {
+                        if (!isProgramReady)
+                        {
+                            break;
+                        }
+                        const auto* command = reinterpret_cast<const DrawInstancedCommand*>(data);
+                        command->Mesh->Activate();
+                        command->Mesh->DrawInstanced(command->InstanceCount, command->BaseInstance);
+                        command->Mesh->Release();
+                        break;
+                    }
+                    case GLCommandType::SetEnabled:
+                    {
+                        const auto* command = reinterpret_cast<const StateCommand*>(data);
+                        state.SetEnabled(command->Value, command->OtherValue != 0);
+                        break;
+                    }
+                    case GLCommandType::SetDepthMask:
+                    {
+                        state.SetDepthMask(reinterpret_cast<const StateCommand*>(data)->Value != 0);
+                        break;
+                    }
+                    case GLCommandType::SetDepthFunc:
+                    {
+                        state.SetDepthFunc(reinterpret_cast<const StateCommand*>(data)->Value);
+                        break;
+                    }
+                    case GLCommandType::SetBlendFunc:
+                    {
+                        const auto* command = reinterpret_cast<const StateCommand*>(data);
+                        state.SetBlendFunc(command->Value, command->OtherValue);
+                        break;
+                    }
+                    default:
+                    {
+                        TBX_ASSERT(false, "GL Rendering: Unknown recorded command!");
+                        return;
+                    }
+                }
+                offset += header.Size;
+            }
+        }
+    }
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "OpenGLMesh.h"
+#include "OpenGLShader.h"
+#include "OpenGLStateCache.h"
+#include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Math/Int.h>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    enum class GLCommandType : uint8_t
+    {
+        UseProgram,
+        UploadUniform,
+        BindTexture,
+        Activate,
+        Release,
+        Draw,
+        DrawInstanced,
+        SetEnabled,
+        SetDepthMask,
+        SetDepthFunc,
+        SetBlendFunc
+    };
+
+    // Draws, binds, uniform uploads and state changes recorded without touching GL, so any thread can record them.
+    // Commands are plain structs packed into blocks the buffer keeps between frames. The buffer holds a reference to
+    // every resource it recorded until it's reset, so a buffer executed frames after recording never replays freed ones.
+    // A buffer must only be recorded by one thread at a time and executed on the render thread.
+    class OpenGLCommandBuffer final
+    {
+    public:
+        static constexpr uint32 BlockSize = 64 * 1024;
+
+        // Buffers submitted to the plugin execute in ascending order, equal orders in submission order.
+        OpenGLCommandBuffer(uint32 order = 0) : _order(order) {}
+
+        OpenGLCommandBuffer(const OpenGLCommandBuffer&) = delete;
+        OpenGLCommandBuffer& operator=(const OpenGLCommandBuffer&) = delete;
+
+        void SetOrder(uint32 order) { _order = order; }
+        uint32 GetOrder() const { return _order; }
+
+        void UseProgram(const Ref<OpenGLShaderProgram>& program);
+        // Resolve the handle with GetUniformHandle up front, on the render thread once the program is ready.
+        void Upload(const Ref<OpenGLShaderProgram>& program, uint32 handle, const UniformValue& value);
+        void BindTexture(const Ref<TextureResource>& texture, uint32 slot);
+        void Activate(const Ref<GraphicsResource>& resource);
+        void Release(const Ref<GraphicsResource>& resource);
+        // Activates, draws and releases the mesh.
+        void Draw(const Ref<MeshResource>& mesh);
+        void DrawInstanced(const Ref<OpenGLMesh>& mesh, uint32 instanceCount, uint32 baseInstance = 0);
+
+        void SetEnabled(uint32 capability, bool enabled);
+        void SetDepthMask(bool enabled);
+        void SetDepthFunc(uint32 func);
+        void SetBlendFunc(uint32 srcFactor, uint32 dstFactor);
+
+        // Replays every command in recording order, render thread only.
+        void Execute(OpenGLStateCache& state) const;
+        // Forgets the commands and lets go of their resources, but keeps the blocks for the next recording.
+        void Reset();
+
+        bool IsEmpty() const { return _commandCount == 0; }
+        uint32 GetCommandCount() const { return _commandCount; }
+        uint64_t GetSizeInBytes() const;
+
+    private:
+        struct Block
+        {
+            std::unique_ptr<std::byte[]> Data = nullptr;
+            uint32 Used = 0;
+        };
+
+        template <typename TCommand>
+        void Record(const TCommand& command);
+        // Keeps the resource alive until Reset, returning the pointer commands refer to it by.
+        template <typename TResource>
+        TResource* Hold(const Ref<TResource>& resource);
+
+    private:
+        uint32 _order = 0;
+        std::vector<Block> _blocks = {};
+        std::vector<Ref<GraphicsResource>> _resources = {};
+        uint32 _currentBlock = 0;
+        uint32 _commandCount = 0;
+    };
+}
@@ -0,0 +1,255 @@
+#include "OpenGLCulling.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__AVX__)
+    #define TBX_GL_AVX_CULLING
+    #include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #define TBX_GL_SSE_CULLING
+    #include <emmintrin.h>
+#endif
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    const VertexBufferElement* FindPositionElement(const VertexBufferLayout& layout)
+    {
+        const auto position = std::find_if(layout.Elements.begin(), layout.Elements.end(), [](const VertexBufferElement& element)
+        {
+            return std::holds_alternative<Vector3>(element.Type) && element.Count == 3;
+        });
+        return position != layout.Elements.end() ? &*position : nullptr;
+    }
+
+    MeshBounds ComputeMeshBounds(const VertexBuffer& buffer)
+    {
+        const auto& layout = buffer.Layout;
+        const auto* position = FindPositionElement(layout);
+        if (!position || layout.Stride == 0)
+        {
+            return {};
+        }
+
+        const auto stride = layout.Stride;
+        const auto vertexCount = (uint32)(buffer.Vertices.size() * sizeof(float) / stride);
+        if (vertexCount == 0 || position->Offset + 3 * sizeof(float) > stride)
+        {
+            return {};
+        }
+
+        const auto* bytes = reinterpret_cast<const uint8_t*>(buffer.Vertices.data()) + position->Offset;
+        float last[4] = {};
+        std::memcpy(last, bytes + (size_t)(vertexCount - 1) * stride, 3 * sizeof(float));
+
+        MeshBounds bounds = {};
+        float radiusSquared = 0.0f;
+#ifdef TBX_GL_SSE_CULLING
+        // Loads a whole vec4 per vertex, the fourth lane reads into the next vertex so the last one is loaded on its own
+        __m128 min = _mm_loadu_ps(last);
+        __m128 max = min;
+        for (uint32 vertex = 0; vertex + 1 < vertexCount; vertex++)
+        {
+            const auto v = _mm_loadu_ps(reinterpret_cast<const float*>(bytes + (size_t)vertex * stride));
+            min = _mm_min_ps(min, v);
+            max = _mm_max_ps(max, v);
+        }
+
+        float minValues[4] = {};
+        float maxValues[4] = {};
+        _mm_storeu_ps(minValues, min);
+        _mm_storeu_ps(maxValues, max);
+        bounds.Min = { minValues[0], minValues[1], minValues[2] };
+        bounds.Max = { maxValues[0], maxValues[1], maxValues[2] };
+
+        // Farthest vertex from the box's center, with the fourth lane masked out of the distance
+        const auto center = _mm_mul_ps(_mm_add_ps(min, max), _mm_set1_ps(0.5f));
+        const auto xyzMask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+        const auto distanceSquared = [&](__m128 v)
+        {
+            const auto d = _mm_and_ps(_mm_sub_ps(v, center), xyzMask);
+            auto sum = _mm_mul_ps(d, d);
+            sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(2, 3, 0, 1)));
+            sum = _mm_add_ps(sum, _mm_shuffle_ps(sum, sum, _MM_SHUFFLE(1, 0, 3, 2)));
+            return sum;
+        };
+        auto maxDistance = distanceSquared(_mm_loadu_ps(last));
+        for (uint32 vertex = 0; vertex + 1 < vertexCount; vertex++)
+        {
+            const auto v = _mm_loadu_ps(reinterpret_cast<const float*>(bytes + (size_t)vertex * stride));
+            maxDistance = _mm_max_ps(maxDistance, distanceSquared(v));
+        }
+        radiusSquared = _mm_cvtss_f32(maxDistance);
+#else
+        bounds.Min = { last[0], last[1], last[2] };
+        bounds.Max = bounds.Min;
+        for (uint32 vertex = 0; vertex < vertexCount; vertex++)
+        {
+            float v[3] = {};
+            std::memcpy(v, bytes + (size_t)vertex * stride, sizeof(v));
+            bounds.Min = { std::min(bounds.Min.X, v[0]), std::min(bounds.Min.Y, v[1]), std::min(bounds.Min.Z, v[2]) };
+            bounds.Max = { std::max(bounds.Max.X, v[0]), std::max(bounds.Max.Y, v[1]), std::max(bounds.Max.Z, v[2]) };
+        }
+
+        const float center[3] = { (bounds.Min.X + bounds.Max.X) * 0.5f, (bounds.Min.Y + bounds.Max.Y) * 0.5f, (bounds.Min.Z + bounds.Max.Z) * 0.5f };
+        for (uint32 vertex = 0; vertex < vertexCount; vertex++)
+        {
+            float v[3] = {};
+            std::memcpy(v, bytes + (size_t)vertex * stride, sizeof(v));
+            const float d[3] = { v[0] - center[0], v[1] - center[1], v[2] - center[2] };
+            radiusSquared = std::max(radiusSquared, d[0] * d[0] + d[1] * d[1] + d[2] * d[2]);
+        }
+#endif
+
+        bounds.Center = { (bounds.Min.X + bounds.Max.X) * 0.5f, (bounds.Min.Y + bounds.Max.Y) * 0.5f, (bounds.Min.Z + bounds.Max.Z) * 0.5f };
+        bounds.Radius = std::sqrt(radiusSquared);
+        bounds.IsValid = true;
+        return bounds;
+    }
+
+    OpenGLFrustum OpenGLFrustum::FromViewProjection(const Mat4x4& viewProjection)
+    {
+        // Column major, row i is every fourth value starting at i
+        const auto& m = viewProjection.Values;
+        const auto row = [&](uint32 i) { return std::array<float, 4>{ m[i], m[4 + i], m[8 + i], m[12 + i] }; };
+        const auto r0 = row(0);
+        const auto r1 = row(1);
+        const auto r2 = row(2);
+        const auto r3 = row(3);
+
+        // Left, right, bottom, top, near and far, from -w <= x, y, z <= w
+        OpenGLFrustum frustum = {};
+        for (uint32 i = 0; i < 4; i++)
+        {
+            frustum.Planes[0][i] = r3[i] + r0[i];
+            frustum.Planes[1][i] = r3[i] - r0[i];
+            frustum.Planes[2][i] = r3[i] + r1[i];
+            frustum.Planes[3][i] = r3[i] - r1[i];
+            frustum.Planes[4][i] = r3[i] + r2[i];
+            frustum.Planes[5][i] = r3[i] - r2[i];
+        }
+
+        // Normalized so a plane's distance compares with a sphere's radius
+        for (auto& plane : frustum.Planes)
+        {
+            const auto length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+            if (length > 0.0f)
+            {
+                for (auto& value : plane) value /= length;
+            }
+        }
+        return frustum;
+    }
+
+    void BoundingSpheres::Clear()
+    {
+        X.clear();
+        Y.clear();
+        Z.clear();
+        Radius.clear();
+    }
+
+    void BoundingSpheres::Add(const MeshBounds& bounds, const Mat4x4& transform)
+    {
+        if (!bounds.IsValid)
+        {
+            AddUnbounded();
+            return;
+        }
+
+        const auto& m = transform.Values;
+        const auto& c = bounds.Center;
+        X.push_back(m[0] * c.X + m[4] * c.Y + m[8] * c.Z + m[12]);
+        Y.push_back(m[1] * c.X + m[5] * c.Y + m[9] * c.Z + m[13]);
+        Z.push_back(m[2] * c.X + m[6] * c.Y + m[10] * c.Z + m[14]);
+
+        // Non uniform scales stretch the sphere into an ellipsoid, the longest axis still contains it
+        const auto scaleX = m[0] * m[0] + m[1] * m[1] + m[2] * m[2];
+        const auto scaleY = m[4] * m[4] + m[5] * m[5] + m[6] * m[6];
+        const auto scaleZ = m[8] * m[8] + m[9] * m[9] + m[10] * m[10];
+        Radius.push_back(bounds.Radius * std::sqrt(std::max({ scaleX, scaleY, scaleZ })));
+    }
+
+    void BoundingSpheres::AddUnbounded()
+    {
+        X.push_back(0.0f);
+        Y.push_back(0.0f);
+        Z.push_back(0.0f);
+        Radius.push_back(std::numeric_limits<float>::infinity());
+    }
+
+    uint32 CullSpheres(const OpenGLFrustum& frustum, const BoundingSpheres& spheres, uint8_t* visible)
+    {
+        const auto count = spheres.GetCount();
+        const auto* xs = spheres.X.data();
+        const auto* ys = spheres.Y.data();
+        const auto* zs = spheres.Z.data();
+        const auto* radii = spheres.Radius.data();
+
+        uint32 visibleCount = 0;
+        uint32 i = 0;
+#if defined(TBX_GL_AVX_CULLING)
+        for (; i + 8 <= count; i += 8)
+        {
+            const auto x = _mm256_loadu_ps(xs + i);
+            const auto y = _mm256_loadu_ps(ys + i);
+            const auto z = _mm256_loadu_ps(zs + i);
+            const auto negativeRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(radii + i));
+            auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (const auto& plane : frustum.Planes)
+            {
+                auto distance = _mm256_add_ps(_mm256_mul_ps(x, _mm256_set1_ps(plane[0])), _mm256_set1_ps(plane[3]));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(y, _mm256_set1_ps(plane[1])));
+                distance = _mm256_add_ps(distance, _mm256_mul_ps(z, _mm256_set1_ps(plane[2])));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+            }
+
+            const auto mask = (uint32)_mm256_movemask_ps(inside);
+            for (uint32 lane = 0; lane < 8; lane++)
+            {
+                visible[i + lane] = (mask >> lane) & 1;
+            }
+            visibleCount += (uint32)std::popcount(mask);
+        }
+#endif
+#if defined(TBX_GL_SSE_CULLING)
+        for (; i + 4 <= count; i += 4)
+        {
+            const auto x = _mm_loadu_ps(xs + i);
+            const auto y = _mm_loadu_ps(ys + i);
+            const auto z = _mm_loadu_ps(zs + i);
+            const auto negativeRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(radii + i));
+            auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (const auto& plane : frustum.Planes)
+            {
+                auto distance = _mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane[0])), _mm_set1_ps(plane[3]));
+                distance = _mm_add_ps(distance, _mm_mul_ps(y, _mm_set1_ps(plane[1])));
+                distance = _mm_add_ps(distance, _mm_mul_ps(z, _mm_set1_ps(plane[2])));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+            }
+
+            const auto mask = (uint32)_mm_movemask_ps(inside);
+            for (uint32 lane = 0; lane < 4; lane++)
+            {
+                visible[i + lane] = (mask >> lane) & 1;
+            }
+            visibleCount += (uint32)std::popcount(mask);
+        }
+#endif
+        // Whatever doesn't fill a register
+        for (; i < count; i++)
+        {
+            bool inside = true;
+            for (const auto& plane : frustum.Planes)
+            {
+                inside &= plane[0] * xs[i] + plane[1] * ys[i] + plane[2] * zs[i] + plane[3] >= -radii[i];
+            }
+            visible[i] = inside ? 1 : 0;
+            visibleCount += inside ? 1 : 0;
+        }
+        return visibleCount;
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+#include <Tbx/Graphics/Vertex.h>
+#include <Tbx/Math/Int.h>
+#include <Tbx/Math/Mat4x4.h>
+#include <Tbx/Math/Vectors.h>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Object space extent of a mesh's positions
+    struct MeshBounds
+    {
+        Vector3 Min = {};
+        Vector3 Max = {};
+        // Centered on the box, so it's not the tightest sphere but never misses a vertex
+        Vector3 Center = {};
+        float Radius = 0.0f;
+        // False for meshes without positions to bound, which are never culled
+        bool IsValid = false;
+    };
+
+    // The first three component Vector3 element of the layout, which is taken to be the position. Null if there's none.
+    const VertexBufferElement* FindPositionElement(const VertexBufferLayout& layout);
+
+    // Bounds of the layout's position element, see FindPositionElement.
+    MeshBounds ComputeMeshBounds(const VertexBuffer& buffer);
+
+    // Planes of a view projection's clip volume, pointing inwards. Each is a, b, c, d with a point inside when ax + by + cz + d >= 0.
+    struct OpenGLFrustum
+    {
+        std::array<std::array<float, 4>, 6> Planes = {};
+
+        static OpenGLFrustum FromViewProjection(const Mat4x4& viewProjection);
+    };
+
+    // World space spheres as structure of arrays, so culling tests a whole SIMD register of them per plane.
+    struct BoundingSpheres
+    {
+        std::vector<float> X = {};
+        std::vector<float> Y = {};
+        std::vector<float> Z = {};
+        std::vector<float> Radius = {};
+
+        uint32 GetCount() const { return (uint32)X.size(); }
+        void Clear();
+        // Transforms the sphere of bounds by the instance's transform, scaling its radius by the largest axis scale
+        void Add(const MeshBounds& bounds, const Mat4x4& transform);
+        // An infinite sphere, never culled
+        void AddUnbounded();
+    };
+
+    // Writes 1 to visible for each sphere at least partly inside the frustum, 0 otherwise. Returns how many are visible.
+    // Uses AVX when the plugin is built with it, SSE otherwise, and plain floats when neither is available.
+    uint32 CullSpheres(const OpenGLFrustum& frustum, const BoundingSpheres& spheres, uint8_t* visible);
+}
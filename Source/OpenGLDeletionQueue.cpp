@@ -0,0 +1,92 @@
+#include "OpenGLDeletionQueue.h"
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLDeletionQueue::OpenGLDeletionQueue(DestroyFunction destroy)
+        : _destroy(std::move(destroy))
+    {
+    }
+
+    OpenGLDeletionQueue::~OpenGLDeletionQueue()
+    {
+        Flush();
+    }
+
+    void OpenGLDeletionQueue::Push(GraphicsResource* resource)
+    {
+        auto* node = new Node();
+        node->Resource = resource;
+        node->Frame = _frame.load(std::memory_order_acquire);
+        node->Next = _pushed.load(std::memory_order_relaxed);
+        while (!_pushed.compare_exchange_weak(node->Next, node, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        _pushedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void OpenGLDeletionQueue::EndFrame(uint64_t nextFrame, uint64_t completedFrames)
+    {
+        // Anything pushed from now on may still be used by the next frame
+        _frame.store(nextFrame, std::memory_order_release);
+
+        CollectPushed();
+        DestroyRetired(completedFrames);
+    }
+
+    void OpenGLDeletionQueue::Flush()
+    {
+        if (_retiring.empty() && !_pushed.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        glFinish();
+
+        // Destroying a resource can release others it was holding on to
+        CollectPushed();
+        while (!_retiring.empty())
+        {
+            DestroyRetired(~0ull);
+            CollectPushed();
+        }
+    }
+
+    void OpenGLDeletionQueue::CollectPushed()
+    {
+        auto* node = _pushed.exchange(nullptr, std::memory_order_acquire);
+
+        // The stack hands them back newest first, keep destruction in push order
+        const auto first = _retiring.size();
+        while (node)
+        {
+            auto* next = node->Next;
+            _retiring.push_back({ node->Resource, node->Frame });
+            _pushedCount.fetch_sub(1, std::memory_order_relaxed);
+            delete node;
+            node = next;
+        }
+        std::reverse(_retiring.begin() + first, _retiring.end());
+    }
+
+    void OpenGLDeletionQueue::DestroyRetired(uint64_t completedFrames)
+    {
+        // Destroying may push more resources, which land in the stack rather than the list we're walking
+        std::vector<Retiring> retired = {};
+        std::erase_if(_retiring, [&](const Retiring& entry)
+        {
+            if (entry.Frame >= completedFrames)
+            {
+                return false;
+            }
+            retired.push_back(entry);
+            return true;
+        });
+
+        for (const auto& entry : retired)
+        {
+            _destroy(entry.Resource);
+        }
+    }
+}
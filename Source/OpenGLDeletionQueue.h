@@ -0,0 +1,62 @@
+#pragma once
+#include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Math/Int.h>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Defers destroying resources until the GPU is done with them, and moves it onto the render thread.
+    // Push is lock free and may be called from any thread, resources are tagged with the frame being recorded.
+    // Everything else must be called on the render thread, where the frame pacer's fences tell when a frame's resources can go.
+    class OpenGLDeletionQueue final
+    {
+    public:
+        using DestroyFunction = std::function<void(GraphicsResource*)>;
+
+        OpenGLDeletionQueue(DestroyFunction destroy);
+        ~OpenGLDeletionQueue();
+
+        OpenGLDeletionQueue(const OpenGLDeletionQueue&) = delete;
+        OpenGLDeletionQueue& operator=(const OpenGLDeletionQueue&) = delete;
+
+        void Push(GraphicsResource* resource);
+
+        // Starts tagging pushed resources with nextFrame, then destroys everything from frames below completedFrames.
+        void EndFrame(uint64_t nextFrame, uint64_t completedFrames);
+        // Waits for the GPU and destroys everything still queued.
+        void Flush();
+
+        // Resources waiting to be destroyed, only exact on the render thread.
+        uint32 GetPendingCount() const { return _pushedCount.load(std::memory_order_relaxed) + (uint32)_retiring.size(); }
+
+    private:
+        struct Node
+        {
+            GraphicsResource* Resource = nullptr;
+            uint64_t Frame = 0;
+            Node* Next = nullptr;
+        };
+
+        struct Retiring
+        {
+            GraphicsResource* Resource = nullptr;
+            uint64_t Frame = 0;
+        };
+
+        void CollectPushed();
+        void DestroyRetired(uint64_t completedFrames);
+
+    private:
+        DestroyFunction _destroy = nullptr;
+
+        // Lock free stack of pushed resources, the render thread takes all of it at once so there is no ABA problem
+        std::atomic<Node*> _pushed = nullptr;
+        std::atomic<uint32> _pushedCount = 0;
+        std::atomic<uint64_t> _frame = 0;
+
+        std::vector<Retiring> _retiring = {};
+    };
+}
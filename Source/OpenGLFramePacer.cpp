@@ -0,0 +1,127 @@
+#include "OpenGLFramePacer.h"
+#include <Tbx/Debug/Asserts.h>
+#include <Tbx/Debug/Tracers.h>
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLFramePacer::~OpenGLFramePacer()
+    {
+        for (auto& slot : _slots)
+        {
+            if (slot.Fence)
+            {
+                glDeleteSync(static_cast<GLsync>(slot.Fence));
+            }
+        }
+    }
+
+    void OpenGLFramePacer::SetFramesInFlight(uint32 frameCount)
+    {
+        _framesInFlight = std::clamp(frameCount, 1u, MaxFramesInFlight);
+    }
+
+    void OpenGLFramePacer::BeginFrame(uint64_t frameNumber)
+    {
+        const auto waitStart = std::chrono::steady_clock::now();
+
+        // Slots are about to be handed out differently, nothing in flight may still be using them
+        if (_slots.size() != _framesInFlight)
+        {
+            for (auto& slot : _slots)
+            {
+                WaitForSlot(slot);
+            }
+            _slots.resize(_framesInFlight);
+        }
+
+        _frame = frameNumber;
+        _slot = (uint32)(frameNumber % _framesInFlight);
+        WaitForSlot(_slots[_slot]);
+        PollFences();
+
+        _stats.CpuWaitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - waitStart).count();
+    }
+
+    void OpenGLFramePacer::EndFrame()
+    {
+        if (_slots.empty())
+        {
+            return;
+        }
+
+        auto& slot = _slots[_slot];
+        TBX_ASSERT(!slot.Fence, "GL Rendering: Frame slot ended twice without beginning!");
+        slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.Frame = _frame;
+        slot.SubmitTime = std::chrono::steady_clock::now();
+        PollFences();
+    }
+
+    void OpenGLFramePacer::PollFences()
+    {
+        _stats.FramesInFlight = 0;
+        for (auto& slot : _slots)
+        {
+            if (!slot.Fence)
+            {
+                continue;
+            }
+
+            const auto result = glClientWaitSync(static_cast<GLsync>(slot.Fence), 0, 0);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED)
+            {
+                RetireSlot(slot);
+            }
+            else
+            {
+                _stats.FramesInFlight++;
+            }
+        }
+    }
+
+    void OpenGLFramePacer::WaitForSlot(Slot& slot)
+    {
+        auto fence = static_cast<GLsync>(slot.Fence);
+        if (!fence)
+        {
+            return;
+        }
+
+        // Flush on the first wait so the fence is guaranteed to make it to the GPU
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        constexpr GLuint64 timeout = 1000000; // 1ms
+        GLuint64 waited = 0;
+        bool warned = false;
+        while (true)
+        {
+            const auto result = glClientWaitSync(fence, flags, timeout);
+            if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED || result == GL_WAIT_FAILED)
+            {
+                TBX_ASSERT(result != GL_WAIT_FAILED, "GL Rendering: Failed waiting on frame fence!");
+                break;
+            }
+
+            flags = 0;
+            waited += timeout;
+            if (waited >= StallWarningNs && !warned)
+            {
+                TBX_TRACE_WARNING("GL Rendering: Waited over a second for the GPU to finish a frame!");
+                warned = true;
+            }
+        }
+
+        RetireSlot(slot);
+    }
+
+    void OpenGLFramePacer::RetireSlot(Slot& slot)
+    {
+        _stats.GpuLatencyMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - slot.SubmitTime).count();
+        glDeleteSync(static_cast<GLsync>(slot.Fence));
+        slot.Fence = nullptr;
+
+        // Fences signal in order, so every frame before this one is done as well
+        _completedFrames = std::max(_completedFrames, slot.Frame + 1);
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <Tbx/Math/Int.h>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Keeps the CPU at most a fixed number of frames ahead of the GPU.
+    // Every frame ends with a fence and a frame only begins once the frame that last used its slot has finished,
+    // so per frame data written into slot GetSlotIndex() is never overwritten while the GPU may still read it.
+    class OpenGLFramePacer final
+    {
+    public:
+        struct Stats
+        {
+            // Time BeginFrame spent waiting for the GPU
+            double CpuWaitMs = 0.0;
+            // Time from submitting a frame to seeing its fence signalled, only checked at frame boundaries
+            // so it's an upper bound.
+            double GpuLatencyMs = 0.0;
+            // Frames submitted that the GPU hasn't been seen finishing yet
+            uint32 FramesInFlight = 0;
+        };
+
+        static constexpr uint32 DefaultFramesInFlight = 2;
+        static constexpr uint32 MaxFramesInFlight = 8;
+        // Waiting this long for a frame is traced as a likely GPU hang, the wait still goes on
+        static constexpr uint64_t StallWarningNs = 1000000000;
+
+        OpenGLFramePacer() = default;
+        ~OpenGLFramePacer();
+
+        OpenGLFramePacer(const OpenGLFramePacer&) = delete;
+        OpenGLFramePacer& operator=(const OpenGLFramePacer&) = delete;
+
+        // Takes effect at the next BeginFrame, which first waits for every frame in flight.
+        void SetFramesInFlight(uint32 frameCount);
+        uint32 GetFramesInFlight() const { return _framesInFlight; }
+
+        // Waits until the frame that last used this frame's slot has finished on the GPU.
+        void BeginFrame(uint64_t frameNumber);
+        // Fences everything submitted for the frame.
+        void EndFrame();
+
+        // Slot of the frame being recorded, in [0, GetFramesInFlight()).
+        uint32 GetSlotIndex() const { return _slot; }
+        // Every frame numbered below this has been seen finished on the GPU.
+        uint64_t GetCompletedFrameCount() const { return _completedFrames; }
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        struct Slot
+        {
+            // GLsync, kept opaque so this header doesn't need glad
+            void* Fence = nullptr;
+            uint64_t Frame = 0;
+            std::chrono::steady_clock::time_point SubmitTime = {};
+        };
+
+        void PollFences();
+        void WaitForSlot(Slot& slot);
+        void RetireSlot(Slot& slot);
+
+    private:
+        uint32 _framesInFlight = DefaultFramesInFlight;
+        std::vector<Slot> _slots = {};
+        uint32 _slot = 0;
+        uint64_t _frame = 0;
+        uint64_t _completedFrames = 0;
+        Stats _stats = {};
+    };
+}
@@ -0,0 +1,79 @@
+#include "OpenGLFreeListAllocator.h"
+#include <Tbx/Debug/Asserts.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLFreeListAllocator::OpenGLFreeListAllocator(uint32 capacity)
+        : _capacity(capacity)
+        , _freeSize(capacity)
+    {
+        if (capacity > 0)
+        {
+            _freeRanges.emplace(0, capacity);
+        }
+    }
+
+    std::optional<uint32> OpenGLFreeListAllocator::Allocate(uint32 size)
+    {
+        if (size == 0 || size > _freeSize)
+        {
+            return std::nullopt;
+        }
+
+        for (auto it = _freeRanges.begin(); it != _freeRanges.end(); ++it)
+        {
+            const auto [offset, rangeSize] = *it;
+            if (rangeSize < size)
+            {
+                continue;
+            }
+
+            // Keep whatever is left of the range free
+            _freeRanges.erase(it);
+            if (rangeSize > size)
+            {
+                _freeRanges.emplace(offset + size, rangeSize - size);
+            }
+            _freeSize -= size;
+            return offset;
+        }
+
+        return std::nullopt;
+    }
+
+    void OpenGLFreeListAllocator::Free(uint32 offset, uint32 size)
+    {
+        if (size == 0)
+        {
+            return;
+        }
+        TBX_ASSERT(offset + size <= _capacity, "GL Rendering: Freed range is out of the allocators bounds!");
+
+        auto [it, inserted] = _freeRanges.emplace(offset, size);
+        if (!inserted)
+        {
+            TBX_ASSERT(false, "GL Rendering: Range was freed twice!");
+            return;
+        }
+        _freeSize += size;
+
+        // Merge with the following range
+        auto next = std::next(it);
+        if (next != _freeRanges.end() && it->first + it->second == next->first)
+        {
+            it->second += next->second;
+            _freeRanges.erase(next);
+        }
+
+        // Merge with the preceding range
+        if (it != _freeRanges.begin())
+        {
+            auto prev = std::prev(it);
+            if (prev->first + prev->second == it->first)
+            {
+                prev->second += it->second;
+                _freeRanges.erase(it);
+            }
+        }
+    }
+}
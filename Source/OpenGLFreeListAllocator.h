@@ -0,0 +1,28 @@
+#pragma once
+#include <Tbx/Math/Int.h>
+#include <map>
+#include <optional>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Hands out ranges of a fixed size space (bytes, vertices, indices, layers...) and merges them back on free.
+    class OpenGLFreeListAllocator final
+    {
+    public:
+        OpenGLFreeListAllocator() = default;
+        OpenGLFreeListAllocator(uint32 capacity);
+
+        // Returns the offset of a free range of the given size, first fit.
+        std::optional<uint32> Allocate(uint32 size);
+        void Free(uint32 offset, uint32 size);
+
+        uint32 GetCapacity() const { return _capacity; }
+        uint32 GetFreeSize() const { return _freeSize; }
+
+    private:
+        // Free ranges keyed by offset
+        std::map<uint32, uint32> _freeRanges = {};
+        uint32 _capacity = 0;
+        uint32 _freeSize = 0;
+    };
+}
@@ -0,0 +1,572 @@
+#include "OpenGLGpuCulling.h"
+#include "OpenGLCulling.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <string>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static_assert(sizeof(GpuInstance) == 112, "GpuInstance must match its std430 layout!");
+
+    // GL_PARAMETER_BUFFER_ARB, the same value as GL 4.6's GL_PARAMETER_BUFFER
+    static constexpr GLenum ParameterBuffer = 0x80EE;
+
+    // Core on GL 4.6, glad only loads it there, otherwise ARB_indirect_parameters' version of it
+    static PFNGLMULTIDRAWELEMENTSINDIRECTCOUNTPROC GetDrawCountFunction()
+    {
+        if (glMultiDrawElementsIndirectCount)
+        {
+            return glMultiDrawElementsIndirectCount;
+        }
+        if (GLAD_GL_ARB_indirect_parameters && glMultiDrawElementsIndirectCountARB)
+        {
+            return glMultiDrawElementsIndirectCountARB;
+        }
+        return nullptr;
+    }
+
+    static constexpr uint32 CullGroupSize = 64;
+    static constexpr uint32 HiZGroupSize = 8;
+    static constexpr uint32 CommandBinding = 1;
+    static constexpr uint32 DrawCountBinding = 2;
+    static constexpr uint32 ParametersBinding = 3;
+
+    // Matches the Parameters block of the cull shader
+    struct CullParameters
+    {
+        float Planes[6][4] = {};
+        Mat4x4 HiZViewProjection = {};
+        // Target width, height, level count and whether Hi-Z is used
+        float HiZ[4] = {};
+        uint32 InstanceCount = 0;
+        uint32 IsCompacting = 0;
+        // The part of the power of two sized pyramid the target covers
+        float HiZUvScale[2] = {};
+    };
+
+    static const char* CullShaderSource = R"(
+        layout(local_size_x = 64) in;
+
+        struct GpuInstance { mat4 Transform; vec4 Color; vec4 Sphere; uvec4 Draw; };
+        struct DrawCommand { uint Count; uint InstanceCount; uint FirstIndex; int BaseVertex; uint BaseInstance; };
+
+        layout(std430, binding = 0) readonly buffer Instances { GpuInstance instances[]; };
+        layout(std430, binding = 1) writeonly buffer Commands { DrawCommand commands[]; };
+        layout(std430, binding = 2) buffer DrawCount { uint drawCount; };
+        layout(std430, binding = 3) readonly buffer Parameters
+        {
+            vec4 planes[6];
+            mat4 hiZViewProjection;
+            vec4 hiZ;
+            uint instanceCount;
+            uint isCompacting;
+            vec2 hiZUvScale;
+        };
+        layout(binding = HIZ_UNIT) uniform sampler2D hiZTexture;
+
+        // Whether the sphere's box is behind the farthest depth of every texel it covers in the pyramid
+        bool IsOccluded(vec3 center, float radius)
+        {
+            vec2 minUv = vec2(1.0);
+            vec2 maxUv = vec2(0.0);
+            float nearest = 1.0;
+            for (int corner = 0; corner < 8; corner++)
+            {
+                vec3 offset = vec3((corner & 1) != 0 ? radius : -radius, (corner & 2) != 0 ? radius : -radius, (corner & 4) != 0 ? radius : -radius);
+                vec4 clip = hiZViewProjection * vec4(center + offset, 1.0);
+                // Reaches behind the camera, too close to tell
+                if (clip.w <= 0.0)
+                {
+                    return false;
+                }
+                vec3 ndc = clip.xyz / clip.w;
+                minUv = min(minUv, ndc.xy * 0.5 + 0.5);
+                maxUv = max(maxUv, ndc.xy * 0.5 + 0.5);
+                nearest = min(nearest, ndc.z * 0.5 + 0.5);
+            }
+
+            // The level where the box covers at most two texels a side, so its four corners sample all of them.
+            // Every level of the pyramid exactly halves the one above, so texels there cover 2^level target texels.
+            minUv = clamp(minUv, 0.0, 1.0);
+            maxUv = clamp(maxUv, 0.0, 1.0);
+            vec2 size = (maxUv - minUv) * hiZ.xy;
+            float level = clamp(ceil(log2(max(max(size.x, size.y), 1.0))), 0.0, hiZ.z - 1.0);
+            minUv *= hiZUvScale;
+            maxUv *= hiZUvScale;
+            float farthest = max(
+                max(textureLod(hiZTexture, minUv, level).r, textureLod(hiZTexture, vec2(maxUv.x, minUv.y), level).r),
+                max(textureLod(hiZTexture, vec2(minUv.x, maxUv.y), level).r, textureLod(hiZTexture, maxUv, level).r));
+            return nearest > farthest;
+        }
+
+        void main()
+        {
+            uint index = gl_GlobalInvocationID.x;
+            if (index >= instanceCount)
+            {
+                return;
+            }
+
+            GpuInstance instance = instances[index];
+            bool isVisible = true;
+            // A negative radius has no bounds to cull with
+            if (instance.Sphere.w >= 0.0)
+            {
+                mat4 transform = instance.Transform;
+                vec3 center = (transform * vec4(instance.Sphere.xyz, 1.0)).xyz;
+                float scale = max(max(dot(transform[0].xyz, transform[0].xyz), dot(transform[1].xyz, transform[1].xyz)), dot(transform[2].xyz, transform[2].xyz));
+                float radius = instance.Sphere.w * sqrt(scale);
+                for (int plane = 0; plane < 6; plane++)
+                {
+                    isVisible = isVisible && dot(planes[plane].xyz, center) + planes[plane].w >= -radius;
+                }
+                if (isVisible && hiZ.w > 0.0)
+                {
+                    isVisible = !IsOccluded(center, radius);
+                }
+            }
+
+            DrawCommand command = DrawCommand(instance.Draw.x, isVisible ? 1u : 0u, instance.Draw.y, int(instance.Draw.z), index);
+            if (isCompacting == 0u)
+            {
+                commands[index] = command;
+            }
+            else if (isVisible)
+            {
+                commands[atomicAdd(drawCount, 1u)] = command;
+            }
+        })";
+
+    static const char* HiZCopyShaderSource = R"(
+        layout(local_size_x = 8, local_size_y = 8) in;
+        layout(binding = HIZ_UNIT) uniform sampler2D depthTexture;
+        layout(r32f, binding = 0) writeonly uniform image2D hiZ;
+
+        void main()
+        {
+            ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+            if (any(greaterThanEqual(texel, imageSize(hiZ))))
+            {
+                return;
+            }
+
+            // Padding past the target is as far as depth goes, so it never hides anything
+            bool isInside = all(lessThan(texel, textureSize(depthTexture, 0)));
+            imageStore(hiZ, texel, vec4(isInside ? texelFetch(depthTexture, texel, 0).r : 1.0));
+        })";
+
+    static const char* HiZReduceShaderSource = R"(
+        layout(local_size_x = 8, local_size_y = 8) in;
+        layout(r32f, binding = 0) readonly uniform image2D source;
+        layout(r32f, binding = 1) writeonly uniform image2D destination;
+
+        void main()
+        {
+            ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+            ivec2 size = imageSize(destination);
+            if (any(greaterThanEqual(texel, size)))
+            {
+                return;
+            }
+
+            // Levels are powers of two, each texel is exactly the four below it, or two once a side is down to one
+            ivec2 sourceSize = imageSize(source);
+            ivec2 first = texel * 2;
+            ivec2 last = min(first + 1, sourceSize - 1);
+            float depth = max(
+                max(imageLoad(source, first).r, imageLoad(source, ivec2(last.x, first.y)).r),
+                max(imageLoad(source, ivec2(first.x, last.y)).r, imageLoad(source, last).r));
+            imageStore(destination, texel, vec4(depth));
+        })";
+
+    static uint32 CreateComputeProgram(const char* body)
+    {
+        auto source = std::string("#version 450 core\n#define HIZ_UNIT ") + std::to_string(OpenGLGpuCuller::HiZTextureUnit) + "\n" + body;
+        const auto* sourceText = source.c_str();
+
+        const auto shader = glCreateShader(GL_COMPUTE_SHADER);
+        glShaderSource(shader, 1, &sourceText, nullptr);
+        glCompileShader(shader);
+        GLint status = GL_FALSE;
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            GLchar log[1024] = {};
+            glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+            TBX_ASSERT(false, "GL Rendering: GPU culling shader failed to compile: {}", log);
+        }
+
+        const auto program = glCreateProgram();
+        glAttachShader(program, shader);
+        glLinkProgram(program);
+        glGetProgramiv(program, GL_LINK_STATUS, &status);
+        if (status != GL_TRUE)
+        {
+            GLchar log[1024] = {};
+            glGetProgramInfoLog(program, sizeof(log), nullptr, log);
+            TBX_ASSERT(false, "GL Rendering: GPU culling program failed to link: {}", log);
+        }
+        glDetachShader(program, shader);
+        glDeleteShader(shader);
+        return program;
+    }
+
+    static GpuInstance MakeGpuInstance(const OpenGLArenaMesh& mesh, const MeshInstance& instance)
+    {
+        GpuInstance gpuInstance = {};
+        gpuInstance.Transform = instance.Transform;
+        gpuInstance.Color = instance.Color;
+
+        const auto& bounds = mesh.GetBounds();
+        gpuInstance.Sphere[0] = bounds.Center.X;
+        gpuInstance.Sphere[1] = bounds.Center.Y;
+        gpuInstance.Sphere[2] = bounds.Center.Z;
+        gpuInstance.Sphere[3] = bounds.IsValid ? bounds.Radius : -1.0f;
+
+        const auto& allocation = mesh.GetAllocation();
+        gpuInstance.Draw[0] = allocation.IndexCount;
+        gpuInstance.Draw[1] = allocation.FirstIndex;
+        gpuInstance.Draw[2] = allocation.BaseVertex;
+        return gpuInstance;
+    }
+
+    OpenGLGpuCuller::OpenGLGpuCuller(OpenGLStateCache& state, OpenGLUniformRing& uniforms)
+        : _state(state)
+        , _uniforms(uniforms)
+    {
+    }
+
+    OpenGLGpuCuller::~OpenGLGpuCuller()
+    {
+        for (auto& group : _groups)
+        {
+            DeleteBuffers(*group);
+        }
+        for (auto program : { _cullProgramGLId, _hiZCopyProgramGLId, _hiZReduceProgramGLId })
+        {
+            if (program != 0)
+            {
+                _state.OnProgramDeleted(program);
+                glDeleteProgram(program);
+            }
+        }
+        if (_hiZTextureGLId != 0)
+        {
+            _state.GetMemoryTracker().Untrack(GpuMemoryType::Texture, _hiZTextureGLId);
+            _state.OnTextureDeleted(_hiZTextureGLId);
+            glDeleteTextures(1, &_hiZTextureGLId);
+        }
+    }
+
+    bool OpenGLGpuCuller::IsDrawCountSupported()
+    {
+        return GetDrawCountFunction() != nullptr;
+    }
+
+    uint32 OpenGLGpuCuller::AddInstance(const Ref<MeshResource>& mesh, const MeshInstance& instance)
+    {
+        auto* arenaMesh = dynamic_cast<OpenGLArenaMesh*>(mesh.get());
+        TBX_ASSERT(arenaMesh, "GL Rendering: GPU culling only draws meshes uploaded into arenas!");
+        if (!arenaMesh)
+        {
+            return InvalidInstance;
+        }
+
+        auto& arena = arenaMesh->GetArena();
+        const auto block = arenaMesh->GetAllocation().Block;
+        auto& blockGroups = _groupIndices[&arena];
+        if (blockGroups.size() <= block)
+        {
+            blockGroups.resize(block + 1, InvalidInstance);
+        }
+        if (blockGroups[block] == InvalidInstance)
+        {
+            blockGroups[block] = (uint32)_groups.size();
+            auto group = std::make_unique<Group>();
+            group->Arena = &arena;
+            group->Block = block;
+            _groups.push_back(std::move(group));
+        }
+
+        const auto groupIndex = blockGroups[block];
+        auto& group = *_groups[groupIndex];
+        const auto slot = (uint32)group.Instances.size();
+        uint32 handle = 0;
+        if (!_freeHandles.empty())
+        {
+            handle = _freeHandles.back();
+            _freeHandles.pop_back();
+        }
+        else
+        {
+            handle = (uint32)_handles.size();
+            _handles.emplace_back();
+        }
+        _handles[handle] = { groupIndex, slot };
+
+        group.Instances.push_back(MakeGpuInstance(*arenaMesh, instance));
+        group.Meshes.push_back(mesh);
+        group.Handles.push_back(handle);
+        MarkDirty(group, slot);
+        _instanceCount++;
+        return handle;
+    }
+
+    void OpenGLGpuCuller::UpdateInstance(uint32 handle, const MeshInstance& instance)
+    {
+        TBX_ASSERT(handle < _handles.size() && _handles[handle].Group != InvalidInstance, "GL Rendering: Updating a GPU culled instance that doesn't exist!");
+        const auto [groupIndex, slot] = _handles[handle];
+        auto& group = *_groups[groupIndex];
+        group.Instances[slot].Transform = instance.Transform;
+        group.Instances[slot].Color = instance.Color;
+        MarkDirty(group, slot);
+    }
+
+    void OpenGLGpuCuller::RemoveInstance(uint32 handle)
+    {
+        TBX_ASSERT(handle < _handles.size() && _handles[handle].Group != InvalidInstance, "GL Rendering: Removing a GPU culled instance that doesn't exist!");
+        const auto [groupIndex, slot] = _handles[handle];
+        auto& group = *_groups[groupIndex];
+
+        // The last instance takes its place, keeping the group packed for the cull pass
+        const auto last = (uint32)group.Instances.size() - 1;
+        if (slot != last)
+        {
+            group.Instances[slot] = group.Instances[last];
+            group.Meshes[slot] = std::move(group.Meshes[last]);
+            group.Handles[slot] = group.Handles[last];
+            _handles[group.Handles[slot]].Slot = slot;
+            MarkDirty(group, slot);
+        }
+        group.Instances.pop_back();
+        group.Meshes.pop_back();
+        group.Handles.pop_back();
+
+        _handles[handle] = { InvalidInstance, 0 };
+        _freeHandles.push_back(handle);
+        _instanceCount--;
+    }
+
+    void OpenGLGpuCuller::BuildHiZ(const OpenGLRenderTarget& target, const Mat4x4& viewProjection)
+    {
+        const auto depthTextureGLId = target.GetDepthTextureGLId();
+        TBX_ASSERT(depthTextureGLId != 0, "GL Rendering: Hi-Z needs a render target with sampled depth!");
+        if (depthTextureGLId == 0)
+        {
+            return;
+        }
+        CreatePrograms();
+
+        const auto width = target.GetWidth();
+        const auto height = target.GetHeight();
+        if (width != _hiZWidth || height != _hiZHeight)
+        {
+            if (_hiZTextureGLId != 0)
+            {
+                _state.GetMemoryTracker().Untrack(GpuMemoryType::Texture, _hiZTextureGLId);
+                _state.OnTextureDeleted(_hiZTextureGLId);
+                glDeleteTextures(1, &_hiZTextureGLId);
+            }
+
+            // Padded to powers of two so every level halves the last exactly, an odd sized level would have texels
+            // covering more of the target than the cull pass assumes and it could sample past what occludes
+            _hiZWidth = width;
+            _hiZHeight = height;
+            _hiZPyramidWidth = std::bit_ceil(width);
+            _hiZPyramidHeight = std::bit_ceil(height);
+            _hiZLevels = 1;
+            while ((std::max(_hiZPyramidWidth, _hiZPyramidHeight) >> _hiZLevels) > 0)
+            {
+                _hiZLevels++;
+            }
+
+            glCreateTextures(GL_TEXTURE_2D, 1, &_hiZTextureGLId);
+            glTextureParameteri(_hiZTextureGLId, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+            glTextureParameteri(_hiZTextureGLId, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTextureParameteri(_hiZTextureGLId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(_hiZTextureGLId, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureStorage2D(_hiZTextureGLId, _hiZLevels, GL_R32F, _hiZPyramidWidth, _hiZPyramidHeight);
+            _state.GetMemoryTracker().Track(GpuMemoryType::Texture, _hiZTextureGLId, OpenGLMemoryTracker::GetTextureSize(GL_R32F, _hiZPyramidWidth, _hiZPyramidHeight, _hiZLevels));
+        }
+
+        // Depth into the first level, then every level the maximum of the one above
+        _state.UseProgram(_hiZCopyProgramGLId);
+        _state.BindTextureUnit(HiZTextureUnit, depthTextureGLId);
+        glBindImageTexture(0, _hiZTextureGLId, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+        glDispatchCompute((_hiZPyramidWidth + HiZGroupSize - 1) / HiZGroupSize, (_hiZPyramidHeight + HiZGroupSize - 1) / HiZGroupSize, 1);
+
+        _state.UseProgram(_hiZReduceProgramGLId);
+        for (uint32 level = 1; level < _hiZLevels; level++)
+        {
+            glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+            glBindImageTexture(0, _hiZTextureGLId, level - 1, GL_FALSE, 0, GL_READ_ONLY, GL_R32F);
+            glBindImageTexture(1, _hiZTextureGLId, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+            const auto levelWidth = std::max(_hiZPyramidWidth >> level, 1u);
+            const auto levelHeight = std::max(_hiZPyramidHeight >> level, 1u);
+            glDispatchCompute((levelWidth + HiZGroupSize - 1) / HiZGroupSize, (levelHeight + HiZGroupSize - 1) / HiZGroupSize, 1);
+        }
+        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+
+        _hiZViewProjection = viewProjection;
+        _isHiZEnabled = true;
+    }
+
+    void OpenGLGpuCuller::Draw(OpenGLShaderProgram& program, const Mat4x4& viewProjection)
+    {
+        _stats = {};
+        _stats.Instances = _instanceCount;
+        // Nothing to draw with until the program is built, culling can wait too
+        if (_instanceCount == 0 || !program.IsReady())
+        {
+            return;
+        }
+        CreatePrograms();
+
+        const auto drawCount = GetDrawCountFunction();
+        const auto isCompacting = drawCount != nullptr;
+        CullParameters parameters = {};
+        const auto frustum = OpenGLFrustum::FromViewProjection(viewProjection);
+        std::memcpy(parameters.Planes, frustum.Planes.data(), sizeof(parameters.Planes));
+        parameters.HiZViewProjection = _hiZViewProjection;
+        parameters.HiZ[0] = (float)_hiZWidth;
+        parameters.HiZ[1] = (float)_hiZHeight;
+        parameters.HiZ[2] = (float)_hiZLevels;
+        parameters.HiZ[3] = _isHiZEnabled ? 1.0f : 0.0f;
+        parameters.HiZUvScale[0] = _hiZPyramidWidth ? (float)_hiZWidth / (float)_hiZPyramidWidth : 1.0f;
+        parameters.HiZUvScale[1] = _hiZPyramidHeight ? (float)_hiZHeight / (float)_hiZPyramidHeight : 1.0f;
+        parameters.IsCompacting = isCompacting ? 1 : 0;
+
+        // Every group's commands first, so one barrier covers all of them
+        _state.UseProgram(_cullProgramGLId);
+        if (_isHiZEnabled)
+        {
+            _state.BindTextureUnit(HiZTextureUnit, _hiZTextureGLId);
+        }
+        for (auto& group : _groups)
+        {
+            const auto instanceCount = (uint32)group->Instances.size();
+            if (instanceCount == 0)
+            {
+                continue;
+            }
+            Upload(*group);
+
+            if (isCompacting)
+            {
+                const uint32 zero = 0;
+                glNamedBufferSubData(group->CountBufferGLId, 0, sizeof(zero), &zero);
+            }
+            parameters.InstanceCount = instanceCount;
+            _uniforms.BindStorageBlock(ParametersBinding, &parameters, sizeof(parameters));
+            _state.BindBufferRange(GL_SHADER_STORAGE_BUFFER, InstanceStorageBinding, group->InstanceBufferGLId, 0, instanceCount * (uint32)sizeof(GpuInstance));
+            _state.BindBufferRange(GL_SHADER_STORAGE_BUFFER, CommandBinding, group->CommandBufferGLId, 0, instanceCount * (uint32)sizeof(DrawElementsIndirectCommand));
+            _state.BindBufferRange(GL_SHADER_STORAGE_BUFFER, DrawCountBinding, group->CountBufferGLId, 0, sizeof(uint32));
+            glDispatchCompute((instanceCount + CullGroupSize - 1) / CullGroupSize, 1, 1);
+            _stats.Dispatches++;
+        }
+        glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+
+        program.Activate();
+        for (auto& group : _groups)
+        {
+            const auto instanceCount = (uint32)group->Instances.size();
+            if (instanceCount == 0)
+            {
+                continue;
+            }
+
+            group->Arena->BindBlock(group->Block);
+            _state.BindBufferRange(GL_SHADER_STORAGE_BUFFER, InstanceStorageBinding, group->InstanceBufferGLId, 0, instanceCount * (uint32)sizeof(GpuInstance));
+            _state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, group->CommandBufferGLId);
+            if (isCompacting)
+            {
+                _state.BindBuffer(ParameterBuffer, group->CountBufferGLId);
+                drawCount(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, 0, (GLsizei)instanceCount, 0);
+            }
+            else
+            {
+                glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)instanceCount, 0);
+            }
+            _state.CountDraws();
+            _stats.Draws++;
+        }
+    }
+
+    void OpenGLGpuCuller::CreatePrograms()
+    {
+        // On first use, there's no context yet when the plugin is constructed
+        if (_cullProgramGLId == 0)
+        {
+            _cullProgramGLId = CreateComputeProgram(CullShaderSource);
+            _hiZCopyProgramGLId = CreateComputeProgram(HiZCopyShaderSource);
+            _hiZReduceProgramGLId = CreateComputeProgram(HiZReduceShaderSource);
+        }
+    }
+
+    void OpenGLGpuCuller::Upload(Group& group)
+    {
+        const auto instanceCount = (uint32)group.Instances.size();
+        if (instanceCount > group.Capacity)
+        {
+            ResizeBuffers(group, std::max(instanceCount, group.Capacity * 2));
+            group.DirtyBegin = 0;
+            group.DirtyEnd = instanceCount;
+        }
+
+        // Only what changed since the last frame, most instances don't move
+        const auto dirtyEnd = std::min(group.DirtyEnd, instanceCount);
+        if (group.DirtyBegin < dirtyEnd)
+        {
+            const auto offset = group.DirtyBegin * (uint32)sizeof(GpuInstance);
+            const auto sizeInBytes = (dirtyEnd - group.DirtyBegin) * (uint32)sizeof(GpuInstance);
+            glNamedBufferSubData(group.InstanceBufferGLId, offset, sizeInBytes, group.Instances.data() + group.DirtyBegin);
+            _state.CountUpload(sizeInBytes);
+        }
+        group.DirtyBegin = ~0u;
+        group.DirtyEnd = 0;
+    }
+
+    void OpenGLGpuCuller::ResizeBuffers(Group& group, uint32 capacity)
+    {
+        DeleteBuffers(group);
+        group.Capacity = capacity;
+
+        glCreateBuffers(1, &group.InstanceBufferGLId);
+        glCreateBuffers(1, &group.CommandBufferGLId);
+        glCreateBuffers(1, &group.CountBufferGLId);
+        glNamedBufferData(group.InstanceBufferGLId, capacity * sizeof(GpuInstance), nullptr, GL_DYNAMIC_DRAW);
+        glNamedBufferData(group.CommandBufferGLId, capacity * sizeof(DrawElementsIndirectCommand), nullptr, GL_DYNAMIC_COPY);
+        glNamedBufferData(group.CountBufferGLId, sizeof(uint32), nullptr, GL_DYNAMIC_COPY);
+
+        auto& memory = _state.GetMemoryTracker();
+        memory.Track(GpuMemoryType::StorageBuffer, group.InstanceBufferGLId, capacity * sizeof(GpuInstance));
+        memory.Track(GpuMemoryType::IndirectBuffer, group.CommandBufferGLId, capacity * sizeof(DrawElementsIndirectCommand));
+        memory.Track(GpuMemoryType::StorageBuffer, group.CountBufferGLId, sizeof(uint32));
+    }
+
+    void OpenGLGpuCuller::DeleteBuffers(Group& group)
+    {
+        auto& memory = _state.GetMemoryTracker();
+        for (auto* buffer : { &group.InstanceBufferGLId, &group.CommandBufferGLId, &group.CountBufferGLId })
+        {
+            if (*buffer == 0)
+            {
+                continue;
+            }
+            memory.Untrack(buffer == &group.CommandBufferGLId ? GpuMemoryType::IndirectBuffer : GpuMemoryType::StorageBuffer, *buffer);
+            _state.OnBufferDeleted(*buffer);
+            glDeleteBuffers(1, buffer);
+            *buffer = 0;
+        }
+        group.Capacity = 0;
+    }
+
+    void OpenGLGpuCuller::MarkDirty(Group& group, uint32 slot)
+    {
+        group.DirtyBegin = std::min(group.DirtyBegin, slot);
+        group.DirtyEnd = std::max(group.DirtyEnd, slot + 1);
+    }
+}
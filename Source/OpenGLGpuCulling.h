@@ -0,0 +1,131 @@
+#pragma once
+#include "OpenGLMesh.h"
+#include "OpenGLRenderTarget.h"
+#include "OpenGLShader.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLUniformRing.h"
+#include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Math/Int.h>
+#include <Tbx/Math/Mat4x4.h>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // An instance as the cull pass and the draws read it, matching the std430 struct
+    // struct GpuInstance { mat4 Transform; vec4 Color; vec4 Sphere; uvec4 Draw; };
+    struct GpuInstance
+    {
+        Mat4x4 Transform = {};
+        RgbaColor Color = {};
+        // Object space bounding sphere, centre and radius
+        float Sphere[4] = {};
+        // Index count, first index and base vertex of the mesh in its arena block
+        uint32 Draw[4] = {};
+    };
+
+    // Culls instances of arena meshes on the GPU so the CPU cost of a frame doesn't grow with the number of objects.
+    // Instances live in storage buffers and are only uploaded when they change. Every frame a compute pass tests them
+    // against the frustum, and optionally a Hi-Z pyramid of an earlier frame's depth, and writes the draw commands of
+    // the visible ones, drawn with one multi draw per arena block.
+    // Vertex shaders read their instance with gl_BaseInstance from
+    //   layout(std430, binding = 0) readonly buffer Instances { GpuInstance instances[]; };
+    class OpenGLGpuCuller final
+    {
+    public:
+        static constexpr uint32 InstanceStorageBinding = 0;
+        static constexpr uint32 InvalidInstance = ~0u;
+        // Out of the way of the slots materials use
+        static constexpr uint32 HiZTextureUnit = OpenGLStateCache::MaxTextureUnits - 1;
+
+        struct Stats
+        {
+            uint32 Instances = 0;
+            uint32 Dispatches = 0;
+            // Multi draws issued, one per arena block with instances
+            uint32 Draws = 0;
+        };
+
+        OpenGLGpuCuller(OpenGLStateCache& state, OpenGLUniformRing& uniforms);
+        ~OpenGLGpuCuller();
+
+        OpenGLGpuCuller(const OpenGLGpuCuller&) = delete;
+        OpenGLGpuCuller& operator=(const OpenGLGpuCuller&) = delete;
+
+        // Drawing only the visible commands needs glMultiDrawElementsIndirectCount, from GL 4.6 or ARB_indirect_parameters.
+        // Without it every instance keeps its command and culled ones are drawn with no instances.
+        static bool IsDrawCountSupported();
+
+        // The instance keeps the mesh alive and draws the range it has when added, add it again after resizing the mesh.
+        uint32 AddInstance(const Ref<MeshResource>& mesh, const MeshInstance& instance);
+        void UpdateInstance(uint32 handle, const MeshInstance& instance);
+        void RemoveInstance(uint32 handle);
+        uint32 GetInstanceCount() const { return _instanceCount; }
+
+        // Reduces the target's depth into a pyramid of maximum depths, which later draws also cull against,
+        // projecting instances with the view projection the depth was drawn with. The target must have sampled depth.
+        void BuildHiZ(const OpenGLRenderTarget& target, const Mat4x4& viewProjection);
+        void DisableHiZ() { _isHiZEnabled = false; }
+        bool IsHiZEnabled() const { return _isHiZEnabled; }
+
+        // Culls every instance and draws the visible ones with the program.
+        void Draw(OpenGLShaderProgram& program, const Mat4x4& viewProjection);
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        // Instances of the meshes in one arena block, which one multi draw can draw
+        struct Group
+        {
+            OpenGLMeshArena* Arena = nullptr;
+            uint32 Block = 0;
+            std::vector<GpuInstance> Instances = {};
+            std::vector<Ref<MeshResource>> Meshes = {};
+            std::vector<uint32> Handles = {};
+            uint32 DirtyBegin = ~0u;
+            uint32 DirtyEnd = 0;
+
+            uint32 Capacity = 0;
+            uint32 InstanceBufferGLId = 0;
+            uint32 CommandBufferGLId = 0;
+            uint32 CountBufferGLId = 0;
+        };
+
+        struct Handle
+        {
+            uint32 Group = 0;
+            uint32 Slot = 0;
+        };
+
+        void CreatePrograms();
+        void Upload(Group& group);
+        void ResizeBuffers(Group& group, uint32 capacity);
+        void DeleteBuffers(Group& group);
+        void MarkDirty(Group& group, uint32 slot);
+
+    private:
+        OpenGLStateCache& _state;
+        OpenGLUniformRing& _uniforms;
+        Stats _stats = {};
+
+        std::vector<std::unique_ptr<Group>> _groups = {};
+        // Group of each block of an arena, InvalidInstance for blocks without one
+        std::unordered_map<OpenGLMeshArena*, std::vector<uint32>> _groupIndices = {};
+        std::vector<Handle> _handles = {};
+        std::vector<uint32> _freeHandles = {};
+        uint32 _instanceCount = 0;
+
+        uint32 _cullProgramGLId = 0;
+        uint32 _hiZCopyProgramGLId = 0;
+        uint32 _hiZReduceProgramGLId = 0;
+
+        uint32 _hiZTextureGLId = 0;
+        uint32 _hiZWidth = 0;
+        uint32 _hiZHeight = 0;
+        uint32 _hiZPyramidWidth = 0;
+        uint32 _hiZPyramidHeight = 0;
+        uint32 _hiZLevels = 0;
+        Mat4x4 _hiZViewProjection = {};
+        bool _isHiZEnabled = false;
+    };
+}
@@ -0,0 +1,27 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // FNV-1a, for keys of the plugin's caches. Stable across runs, so it can key what's stored on disk.
+    static constexpr uint64_t HashSeed = 14695981039346656037ull;
+    static constexpr uint64_t HashPrime = 1099511628211ull;
+
+    inline uint64_t HashBytes(const void* data, size_t size, uint64_t hash = HashSeed)
+    {
+        const auto* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            hash ^= bytes[i];
+            hash *= HashPrime;
+        }
+        return hash;
+    }
+
+    // Mixes in a whole value at once, for keys built field by field
+    inline uint64_t HashCombine(uint64_t hash, uint64_t value)
+    {
+        return (hash ^ value) * HashPrime;
+    }
+}
@@ -0,0 +1,87 @@
+#ifdef TBX_GL_HEADLESS_EGL
+#include "OpenGLHeadlessContext.h"
+#include <Tbx/Debug/Tracers.h>
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <cstring>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static bool HasClientExtension(const char* name)
+    {
+        const auto* extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+        return extensions && std::strstr(extensions, name);
+    }
+
+    std::unique_ptr<OpenGLHeadlessContext> OpenGLHeadlessContext::Create()
+    {
+        if (!HasClientExtension("EGL_MESA_platform_surfaceless") || !HasClientExtension("EGL_EXT_platform_base"))
+        {
+            TBX_TRACE_ERROR("GL Rendering: EGL has no surfaceless platform, can't create a headless context!");
+            return nullptr;
+        }
+
+        auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        auto display = getPlatformDisplay ? getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) : EGL_NO_DISPLAY;
+        EGLint major = 0;
+        EGLint minor = 0;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor))
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to initialize the surfaceless EGL display!");
+            return nullptr;
+        }
+
+        auto context = std::unique_ptr<OpenGLHeadlessContext>(new OpenGLHeadlessContext());
+        context->_display = display;
+
+        // Surfaceless contexts need no config, but older drivers want one anyway
+        const EGLint configAttributes[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = nullptr;
+        EGLint configCount = 0;
+        eglChooseConfig(display, configAttributes, &config, 1, &configCount);
+
+        const EGLint contextAttributes[] =
+        {
+            EGL_CONTEXT_MAJOR_VERSION, 4,
+            EGL_CONTEXT_MINOR_VERSION, 5,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_NONE
+        };
+        eglBindAPI(EGL_OPENGL_API);
+        context->_context = eglCreateContext(display, configCount > 0 ? config : nullptr, EGL_NO_CONTEXT, contextAttributes);
+        if (context->_context == EGL_NO_CONTEXT)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to create a headless OpenGL 4.5 core context, EGL error {}!", eglGetError());
+            return nullptr;
+        }
+
+        if (!context->MakeCurrent() || !gladLoadGLLoader((GLADloadproc)eglGetProcAddress))
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to load OpenGL through the headless context!");
+            return nullptr;
+        }
+
+        TBX_TRACE_INFO("GL Rendering: Created headless context on EGL {}.{}", major, minor);
+        return context;
+    }
+
+    OpenGLHeadlessContext::~OpenGLHeadlessContext()
+    {
+        if (_context)
+        {
+            eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(_display, _context);
+        }
+        if (_display)
+        {
+            eglTerminate(_display);
+        }
+    }
+
+    bool OpenGLHeadlessContext::MakeCurrent() const
+    {
+        return eglMakeCurrent(_display, EGL_NO_SURFACE, EGL_NO_SURFACE, _context) == EGL_TRUE;
+    }
+}
+#endif
@@ -0,0 +1,31 @@
+#pragma once
+#ifdef TBX_GL_HEADLESS_EGL
+#include <memory>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // OpenGL 4.5 core context without any window or surface, on an EGL surfaceless display.
+    // Lets the plugin render into render targets on machines without a display server or GPU, e.g. with Mesa llvmpipe.
+    class OpenGLHeadlessContext final
+    {
+    public:
+        // Creates the context, makes it current on the calling thread and loads GL through it.
+        // Returns null when EGL has no surfaceless platform or can't create a 4.5 core context.
+        static std::unique_ptr<OpenGLHeadlessContext> Create();
+        ~OpenGLHeadlessContext();
+
+        OpenGLHeadlessContext(const OpenGLHeadlessContext&) = delete;
+        OpenGLHeadlessContext& operator=(const OpenGLHeadlessContext&) = delete;
+
+        bool MakeCurrent() const;
+
+    private:
+        OpenGLHeadlessContext() = default;
+
+    private:
+        // EGLDisplay and EGLContext, kept opaque so this header doesn't need EGL
+        void* _display = nullptr;
+        void* _context = nullptr;
+    };
+}
+#endif
@@ -0,0 +1,179 @@
+#include "OpenGLMemoryTracker.h"
+#include "OpenGLTextureContainer.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Bytes a texel takes in VRAM, 3 channel formats are padded to 4 by every driver we know of
+    static uint32 GetTexelSize(uint32 internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GL_R8:
+                return 1;
+            case GL_RG8:
+            case GL_R16F:
+            case GL_DEPTH_COMPONENT16:
+                return 2;
+            case GL_RGB8:
+            case GL_SRGB8:
+            case GL_RGBA8:
+            case GL_SRGB8_ALPHA8:
+            case GL_RGB10_A2:
+            case GL_R11F_G11F_B10F:
+            case GL_RG16F:
+            case GL_R32F:
+            case GL_DEPTH_COMPONENT24:
+            case GL_DEPTH_COMPONENT32F:
+            case GL_DEPTH24_STENCIL8:
+                return 4;
+            case GL_RGBA16F:
+            case GL_RG32F:
+            case GL_DEPTH32F_STENCIL8:
+                return 8;
+            case GL_RGBA32F:
+                return 16;
+            default:
+                TBX_ASSERT(false, "GL Rendering: Unknown texture format, can't account for its memory!");
+                return 4;
+        }
+    }
+
+    OpenGLMemoryTracker::OpenGLMemoryTracker()
+    {
+        _tagNames.emplace_back(UntaggedName);
+        _tags.emplace_back();
+    }
+
+    void OpenGLMemoryTracker::Track(GpuMemoryType type, uint32 glId, uint64_t sizeInBytes)
+    {
+        auto& typeUsage = _types[(size_t)type];
+        auto [it, isNew] = _allocations.try_emplace(GetKey(type, glId));
+        auto& allocation = it->second;
+        if (isNew)
+        {
+            allocation.Tag = _tagStack.empty() ? 0 : _tagStack.back();
+        }
+        else
+        {
+            // Reallocated storage, drop the old size but keep the original tag
+            Remove(_total, allocation.Bytes, 1);
+            Remove(typeUsage, allocation.Bytes, 1);
+            Remove(_tags[allocation.Tag], allocation.Bytes, 1);
+        }
+
+        allocation.Bytes = sizeInBytes;
+        Add(_total, sizeInBytes, 1);
+        Add(typeUsage, sizeInBytes, 1);
+        Add(_tags[allocation.Tag], sizeInBytes, 1);
+
+        // Growing while over budget, give the owner a chance to evict. Evicting frees resources which untracks them,
+        // but anything the callback allocates itself mustn't notify again.
+        if (IsOverBudget() && _onOverBudget && !_isNotifying)
+        {
+            _isNotifying = true;
+            _onOverBudget(_total.Bytes, _budget);
+            _isNotifying = false;
+        }
+    }
+
+    void OpenGLMemoryTracker::Untrack(GpuMemoryType type, uint32 glId)
+    {
+        const auto it = _allocations.find(GetKey(type, glId));
+        if (it == _allocations.end())
+        {
+            return;
+        }
+
+        const auto& allocation = it->second;
+        Remove(_total, allocation.Bytes, 1);
+        Remove(_types[(size_t)type], allocation.Bytes, 1);
+        Remove(_tags[allocation.Tag], allocation.Bytes, 1);
+        _allocations.erase(it);
+    }
+
+    void OpenGLMemoryTracker::PushTag(std::string_view tag)
+    {
+        auto it = std::find(_tagNames.begin(), _tagNames.end(), tag);
+        if (it == _tagNames.end())
+        {
+            _tagNames.emplace_back(tag);
+            _tags.emplace_back();
+            it = _tagNames.end() - 1;
+        }
+        _tagStack.push_back((uint32)(it - _tagNames.begin()));
+    }
+
+    void OpenGLMemoryTracker::PopTag()
+    {
+        TBX_ASSERT(!_tagStack.empty(), "GL Rendering: Popped a memory tag that was never pushed!");
+        if (!_tagStack.empty())
+        {
+            _tagStack.pop_back();
+        }
+    }
+
+    void OpenGLMemoryTracker::SetBudget(uint64_t budgetBytes, OverBudgetCallback onOverBudget)
+    {
+        _budget = budgetBytes;
+        _onOverBudget = std::move(onOverBudget);
+    }
+
+    GpuMemoryUsage OpenGLMemoryTracker::GetTagUsage(std::string_view tag) const
+    {
+        const auto it = std::find(_tagNames.begin(), _tagNames.end(), tag);
+        if (it == _tagNames.end())
+        {
+            return {};
+        }
+        return _tags[it - _tagNames.begin()];
+    }
+
+    std::vector<std::string> OpenGLMemoryTracker::GetTags() const
+    {
+        return _tagNames;
+    }
+
+    void OpenGLMemoryTracker::ResetPeaks()
+    {
+        _total.PeakBytes = _total.Bytes;
+        for (auto& usage : _types) usage.PeakBytes = usage.Bytes;
+        for (auto& usage : _tags) usage.PeakBytes = usage.Bytes;
+    }
+
+    uint64_t OpenGLMemoryTracker::GetTextureSize(uint32 internalFormat, uint32 width, uint32 height, uint32 levels, uint32 layers)
+    {
+        const auto blockSize = GetCompressedBlockSize(internalFormat);
+        uint64_t size = 0;
+        for (uint32 level = 0; level < levels; level++)
+        {
+            const auto levelWidth = std::max(width >> level, 1u);
+            const auto levelHeight = std::max(height >> level, 1u);
+            if (blockSize != 0)
+            {
+                // Compressed levels are stored in whole 4x4 blocks, even the tiny ones
+                size += (uint64_t)((levelWidth + 3) / 4) * ((levelHeight + 3) / 4) * blockSize;
+            }
+            else
+            {
+                size += (uint64_t)levelWidth * levelHeight * GetTexelSize(internalFormat);
+            }
+        }
+        return size * layers;
+    }
+
+    void OpenGLMemoryTracker::Add(GpuMemoryUsage& usage, uint64_t sizeInBytes, uint32 allocations)
+    {
+        usage.Bytes += sizeInBytes;
+        usage.Allocations += allocations;
+        usage.PeakBytes = std::max(usage.PeakBytes, usage.Bytes);
+    }
+
+    void OpenGLMemoryTracker::Remove(GpuMemoryUsage& usage, uint64_t sizeInBytes, uint32 allocations)
+    {
+        usage.Bytes -= std::min(usage.Bytes, sizeInBytes);
+        usage.Allocations -= std::min(usage.Allocations, allocations);
+    }
+}
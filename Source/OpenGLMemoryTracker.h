@@ -0,0 +1,98 @@
+#pragma once
+#include <Tbx/Math/Int.h>
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    enum class GpuMemoryType : uint8_t
+    {
+        VertexBuffer,
+        IndexBuffer,
+        StreamingBuffer,
+        IndirectBuffer,
+        StorageBuffer,
+        Texture,
+        TextureArray,
+        RenderTarget,
+        ReadbackBuffer,
+        Count
+    };
+
+    struct GpuMemoryUsage
+    {
+        uint64_t Bytes = 0;
+        uint64_t PeakBytes = 0;
+        uint32 Allocations = 0;
+    };
+
+    // Keeps count of the bytes backing every GL buffer and texture we create, in total, per type and per caller tag.
+    // Resources report their storage whenever they (re)allocate it, so numbers are exact as far as GL tells us:
+    // textures include their whole mip chain and the padding of 3 channel formats, buffers their full allocation.
+    class OpenGLMemoryTracker final
+    {
+    public:
+        // Called when an allocation leaves us over budget, with the bytes in use and the budget.
+        // Meant for evicting resources, it's called again on every allocation until usage drops below the budget.
+        using OverBudgetCallback = std::function<void(uint64_t usedBytes, uint64_t budgetBytes)>;
+
+        static constexpr std::string_view UntaggedName = "Untagged";
+
+        OpenGLMemoryTracker();
+
+        // Records the current size of a GL object's storage, replacing what was recorded for it before.
+        void Track(GpuMemoryType type, uint32 glId, uint64_t sizeInBytes);
+        void Untrack(GpuMemoryType type, uint32 glId);
+
+        // Allocations made while a tag is pushed are attributed to it, e.g. the level or system loading them.
+        void PushTag(std::string_view tag);
+        void PopTag();
+
+        // A budget of 0 means unlimited.
+        void SetBudget(uint64_t budgetBytes, OverBudgetCallback onOverBudget = nullptr);
+        uint64_t GetBudget() const { return _budget; }
+        bool IsOverBudget() const { return _budget != 0 && _total.Bytes > _budget; }
+
+        const GpuMemoryUsage& GetTotalUsage() const { return _total; }
+        const GpuMemoryUsage& GetUsage(GpuMemoryType type) const { return _types[(size_t)type]; }
+        // Usage of a tag, untagged allocations are found under UntaggedName.
+        GpuMemoryUsage GetTagUsage(std::string_view tag) const;
+        std::vector<std::string> GetTags() const;
+
+        // Forgets the high-water marks, they restart from the current usage.
+        void ResetPeaks();
+
+        // Bytes of immutable storage for a texture of the given internal format, including every level and layer.
+        static uint64_t GetTextureSize(uint32 internalFormat, uint32 width, uint32 height, uint32 levels, uint32 layers = 1);
+
+    private:
+        struct Allocation
+        {
+            uint64_t Bytes = 0;
+            uint32 Tag = 0;
+        };
+
+        static uint64_t GetKey(GpuMemoryType type, uint32 glId) { return ((uint64_t)type << 32) | glId; }
+        static void Add(GpuMemoryUsage& usage, uint64_t sizeInBytes, uint32 allocations);
+        static void Remove(GpuMemoryUsage& usage, uint64_t sizeInBytes, uint32 allocations);
+
+    private:
+        std::unordered_map<uint64_t, Allocation> _allocations = {};
+        GpuMemoryUsage _total = {};
+        std::array<GpuMemoryUsage, (size_t)GpuMemoryType::Count> _types = {};
+
+        // Tags are interned, allocations refer to them by index and index 0 is untagged
+        std::vector<std::string> _tagNames = {};
+        std::vector<GpuMemoryUsage> _tags = {};
+        std::vector<uint32> _tagStack = {};
+
+        uint64_t _budget = 0;
+        OverBudgetCallback _onOverBudget = nullptr;
+        bool _isNotifying = false;
+    };
+}
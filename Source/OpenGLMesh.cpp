@@ -1,58 +1,336 @@
 #include "OpenGLMesh.h"
 #include "OpenGLBuffers.h"
 #include <glad/glad.h>
+#include <algorithm>
+#include <cstddef>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
-    OpenGLRendering::OpenGLMesh::OpenGLMesh(const Mesh& mesh)
-    {
-        auto id = static_cast<uint32>(RenderId);
-        glGenVertexArrays(1, &id);
-        RenderId = id;
+    static_assert(sizeof(MeshInstance) == 20 * sizeof(float), "Mesh instances must be tightly packed!");
 
+    OpenGLRendering::OpenGLMesh::OpenGLMesh(const Mesh& mesh, OpenGLStateCache& state, OpenGLVertexArrayCache& vertexArrays, const VertexPacking& packing)
+        : _state(state)
+        , _vertexArrays(vertexArrays)
+        , _vertexBuffer(state)
+        , _indexBuffer(state)
+        , _packing(packing)
+    {
         SetVertexBuffer(mesh.Vertices);
         SetIndexBuffer(mesh.Indices);
     }
 
-    OpenGLMesh::~OpenGLMesh()
-    {
-        auto id = static_cast<uint32>(RenderId);
-        glDeleteVertexArrays(1, &id);
-    }
+    OpenGLMesh::~OpenGLMesh() = default;
 
     void OpenGLMesh::Draw()
     {
-        glDrawElements(GL_TRIANGLES, _indexBuffer.GetCount(), GL_UNSIGNED_INT, 0);
+        glDrawElements(GL_TRIANGLES, _indexBuffer.GetCount(), _indexBuffer.GetIndexType(), 0);
+        _state.CountDraws();
     }
 
     void OpenGLMesh::SetVertexBuffer(const VertexBuffer& buffer)
     {
-        glBindVertexArray(RenderId);
         TBX_ASSERT(buffer.Vertices.size(), "GL Rendering: Vertex buffer must not be empty!");
         TBX_ASSERT(buffer.Layout.Elements.size(), "GL Rendering: Vertex buffer must provide a layout!");
-        _vertexBuffer.Bind();
-        _vertexBuffer.Upload(buffer);
+        _vertexBuffer.Upload(buffer, _packing);
+        _bounds = ComputeMeshBounds(buffer);
+
+        // Instance attributes follow the mesh's own
+        _instanceAttributeLocation = (uint32)buffer.Layout.Elements.size();
+        AcquireVertexArray();
     }
 
     void OpenGLMesh::SetIndexBuffer(const IndexBuffer& buffer)
     {
-        glBindVertexArray(RenderId);
         TBX_ASSERT(buffer.size(), "GL Rendering: Index buffer must not be empty!");
-        _indexBuffer.Bind();
         _indexBuffer.Upload(buffer);
     }
 
+    void OpenGLMesh::SetInstances(const std::vector<MeshInstance>& instances)
+    {
+        _instanceCount = (uint32)instances.size();
+        if (instances.empty())
+        {
+            return;
+        }
+
+        if (!_instanceBuffer)
+        {
+            _instanceBuffer = std::make_unique<OpenGLVertexBuffer>(_state);
+            AcquireVertexArray();
+        }
+
+        // Grow geometrically so per frame updates settle on a capacity and stop reallocating
+        if (_instanceCount > _instanceCapacity)
+        {
+            _instanceCapacity = std::max(_instanceCount, _instanceCapacity * 2);
+            _instanceBuffer->Allocate(_instanceCapacity * (uint32)sizeof(MeshInstance));
+        }
+        _instanceBuffer->UploadRange(0, instances.data(), _instanceCount * (uint32)sizeof(MeshInstance));
+    }
+
+    void OpenGLMesh::DrawInstanced(uint32 instanceCount, uint32 baseInstance)
+    {
+        TBX_ASSERT(!_instanceBuffer || baseInstance + instanceCount <= _instanceCount, "GL Rendering: Drawing more instances than were uploaded!");
+        glDrawElementsInstancedBaseInstance(GL_TRIANGLES, _indexBuffer.GetCount(), _indexBuffer.GetIndexType(), 0, instanceCount, baseInstance);
+        _state.CountDraws();
+    }
+
+    void OpenGLMesh::AcquireVertexArray()
+    {
+        auto format = _vertexBuffer.GetFormat();
+        if (_instanceBuffer)
+        {
+            // A mat4 attribute takes up four vec4 locations
+            constexpr auto columnSize = (uint32)(4 * sizeof(float));
+            constexpr auto binding = OpenGLVertexArrayCache::InstanceBinding;
+            for (uint32 column = 0; column < 4; column++)
+            {
+                format.push_back({ GL_FLOAT, 4, (uint32)offsetof(MeshInstance, Transform) + column * columnSize, false, binding });
+            }
+            format.push_back({ GL_FLOAT, 4, (uint32)offsetof(MeshInstance, Color), false, binding });
+        }
+
+        RenderId = _vertexArrays.Acquire(format);
+    }
+
     void OpenGLMesh::Activate()
     {
-        glBindVertexArray(RenderId);
-        _vertexBuffer.Bind();
-        _indexBuffer.Bind();
+        // The vertex array is shared with every mesh of the same format, so attach our buffers to it
+        const auto vertexArray = (uint32)RenderId;
+        _state.BindVertexArray(vertexArray);
+        _state.BindVertexBuffer(vertexArray, OpenGLVertexArrayCache::VertexBinding, _vertexBuffer.GetGLId(), 0, _vertexBuffer.GetStride());
+        _state.BindElementBuffer(vertexArray, _indexBuffer.GetGLId());
+        if (_instanceBuffer)
+        {
+            _state.BindVertexBuffer(vertexArray, OpenGLVertexArrayCache::InstanceBinding, _instanceBuffer->GetGLId(), 0, sizeof(MeshInstance));
+        }
     }
 
     void OpenGLMesh::Release()
     {
-        glBindVertexArray(0);
-        _vertexBuffer.Unbind();
-        _indexBuffer.Unbind();
+        if (_state.IsStrictMode())
+        {
+            _state.BindVertexArray(0);
+        }
+    }
+
+    /// Arena Mesh ////////////////////////////////////////////////////////////
+
+    static uint32 GetVertexCount(const VertexBuffer& buffer)
+    {
+        const auto stride = buffer.Layout.Stride;
+        const auto sizeInBytes = (uint32)(buffer.Vertices.size() * sizeof(float));
+        return (sizeInBytes + stride - 1) / stride;
+    }
+
+    OpenGLArenaMesh::OpenGLArenaMesh(const Mesh& mesh, OpenGLMeshArena& arena)
+        : _arena(arena)
+    {
+        TBX_ASSERT(mesh.Vertices.Vertices.size(), "GL Rendering: Vertex buffer must not be empty!");
+        TBX_ASSERT(mesh.Indices.size(), "GL Rendering: Index buffer must not be empty!");
+
+        _allocation = _arena.Allocate(GetVertexCount(mesh.Vertices), (uint32)mesh.Indices.size());
+        _arena.UploadVertices(_allocation, mesh.Vertices);
+        _arena.UploadIndices(_allocation, mesh.Indices);
+        _bounds = ComputeMeshBounds(mesh.Vertices);
+    }
+
+    OpenGLArenaMesh::~OpenGLArenaMesh()
+    {
+        _arena.Free(_allocation);
+    }
+
+    void OpenGLArenaMesh::Draw()
+    {
+        const auto* firstIndex = reinterpret_cast<const void*>(static_cast<uintptr_t>(_allocation.FirstIndex * sizeof(uint32)));
+        glDrawElementsBaseVertex(GL_TRIANGLES, _allocation.IndexCount, GL_UNSIGNED_INT, firstIndex, (GLint)_allocation.BaseVertex);
+        _arena.GetStateCache().CountDraws();
+    }
+
+    void OpenGLArenaMesh::DrawInstanced(uint32 instanceCount, uint32 baseInstance)
+    {
+        const auto* firstIndex = reinterpret_cast<const void*>(static_cast<uintptr_t>(_allocation.FirstIndex * sizeof(uint32)));
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, _allocation.IndexCount, GL_UNSIGNED_INT, firstIndex, instanceCount, (GLint)_allocation.BaseVertex, baseInstance);
+        _arena.GetStateCache().CountDraws();
+    }
+
+    void OpenGLArenaMesh::SetVertexBuffer(const VertexBuffer& buffer)
+    {
+        TBX_ASSERT(buffer.Vertices.size(), "GL Rendering: Vertex buffer must not be empty!");
+        TBX_ASSERT(OpenGLMeshArena::HashLayout(buffer.Layout) == OpenGLMeshArena::HashLayout(_arena.GetLayout()), "GL Rendering: Arena meshes can't change their vertex layout!");
+        // Keeps its vertices when asserts are compiled out, there's no counting them without a stride
+        if (buffer.Layout.Stride == 0)
+        {
+            return;
+        }
+
+        const auto vertexCount = GetVertexCount(buffer);
+        if (vertexCount != _allocation.VertexCount)
+        {
+            Reallocate(vertexCount, _allocation.IndexCount);
+        }
+        _arena.UploadVertices(_allocation, buffer);
+        _bounds = ComputeMeshBounds(buffer);
+    }
+
+    void OpenGLArenaMesh::SetIndexBuffer(const IndexBuffer& buffer)
+    {
+        TBX_ASSERT(buffer.size(), "GL Rendering: Index buffer must not be empty!");
+
+        const auto indexCount = (uint32)buffer.size();
+        if (indexCount != _allocation.IndexCount)
+        {
+            Reallocate(_allocation.VertexCount, indexCount);
+        }
+        _arena.UploadIndices(_allocation, buffer);
+    }
+
+    void OpenGLArenaMesh::Activate()
+    {
+        _arena.BindBlock(_allocation.Block);
+    }
+
+    void OpenGLArenaMesh::Release()
+    {
+        _arena.UnbindBlock();
+    }
+
+    DrawElementsIndirectCommand OpenGLArenaMesh::GetDrawCommand(uint32 baseInstance) const
+    {
+        return { _allocation.IndexCount, 1, _allocation.FirstIndex, (int)_allocation.BaseVertex, baseInstance };
+    }
+
+    void OpenGLArenaMesh::Reallocate(uint32 vertexCount, uint32 indexCount)
+    {
+        // Vertices and indices move together, carry over whichever half isn't about to be re-uploaded
+        const auto old = _allocation;
+        _allocation = _arena.Allocate(vertexCount, indexCount);
+        if (vertexCount == old.VertexCount)
+        {
+            _arena.CopyVertices(old, _allocation);
+        }
+        if (indexCount == old.IndexCount)
+        {
+            _arena.CopyIndices(old, _allocation);
+        }
+        _arena.Free(old);
+    }
+
+    /// Dynamic Mesh //////////////////////////////////////////////////////////
+
+    OpenGLDynamicMesh::OpenGLDynamicMesh(const Mesh& mesh, OpenGLStateCache& state, OpenGLVertexArrayCache& vertexArrays)
+        : _state(state)
+        , _vertexArrays(vertexArrays)
+        , _vertexRing(state, (uint32)(mesh.Vertices.Vertices.size() * sizeof(float)) + mesh.Vertices.Layout.Stride)
+        , _indexRing(state, (uint32)(mesh.Indices.size() * sizeof(uint32)) + (uint32)sizeof(uint32))
+    {
+        SetVertexBuffer(mesh.Vertices);
+        SetIndexBuffer(mesh.Indices);
+    }
+
+    OpenGLDynamicMesh::~OpenGLDynamicMesh() = default;
+
+    void OpenGLDynamicMesh::Draw()
+    {
+        // Rings get a new id when they grow, which may have happened since we were activated
+        BindRingBuffers();
+
+        const auto* indexOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(_indexOffset));
+        glDrawElementsBaseVertex(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, indexOffset, (GLint)_baseVertex);
+        _state.CountDraws();
+    }
+
+    void OpenGLDynamicMesh::DrawInstanced(uint32 instanceCount, uint32 baseInstance)
+    {
+        BindRingBuffers();
+
+        const auto* indexOffset = reinterpret_cast<const void*>(static_cast<uintptr_t>(_indexOffset));
+        glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, _indexCount, GL_UNSIGNED_INT, indexOffset, instanceCount, (GLint)_baseVertex, baseInstance);
+        _state.CountDraws();
+    }
+
+    void OpenGLDynamicMesh::SetVertexBuffer(const VertexBuffer& buffer)
+    {
+        TBX_ASSERT(buffer.Vertices.size(), "GL Rendering: Vertex buffer must not be empty!");
+        TBX_ASSERT(buffer.Layout.Elements.size(), "GL Rendering: Vertex buffer must provide a layout!");
+        TBX_ASSERT(buffer.Layout.Stride > 0, "GL Rendering: Dynamic meshes require a vertex layout with a stride!");
+        // Keeps its vertices when asserts are compiled out, the plugin uploads meshes without a stride as static ones
+        if (buffer.Layout.Stride == 0)
+        {
+            return;
+        }
+
+        // Aligning to the stride lets us address the data through the base vertex without rebinding at an offset
+        _stride = buffer.Layout.Stride;
+        const auto offset = _vertexRing.Write(buffer.Vertices.data(), (uint32)(buffer.Vertices.size() * sizeof(float)), _stride);
+        _baseVertex = offset / _stride;
+        _bounds = ComputeMeshBounds(buffer);
+        RenderId = _vertexArrays.Acquire(OpenGLVertexBuffer::GetLayoutFormat(buffer.Layout));
+    }
+
+    void OpenGLDynamicMesh::SetIndexBuffer(const IndexBuffer& buffer)
+    {
+        TBX_ASSERT(buffer.size(), "GL Rendering: Index buffer must not be empty!");
+
+        _indexCount = (uint32)buffer.size();
+        _indexOffset = _indexRing.Write(buffer.data(), _indexCount * (uint32)sizeof(uint32), sizeof(uint32));
+    }
+
+    void OpenGLDynamicMesh::Activate()
+    {
+        BindRingBuffers();
+    }
+
+    void OpenGLDynamicMesh::Release()
+    {
+        if (_state.IsStrictMode())
+        {
+            _state.BindVertexArray(0);
+        }
+    }
+
+    void OpenGLDynamicMesh::BindRingBuffers()
+    {
+        const auto vertexArray = (uint32)RenderId;
+        _state.BindVertexArray(vertexArray);
+        _state.BindVertexBuffer(vertexArray, OpenGLVertexArrayCache::VertexBinding, _vertexRing.GetGLId(), 0, _stride);
+        _state.BindElementBuffer(vertexArray, _indexRing.GetGLId());
+    }
+
+    const MeshBounds* GetMeshBounds(const MeshResource& mesh)
+    {
+        if (const auto* instancedMesh = dynamic_cast<const OpenGLMesh*>(&mesh))
+        {
+            return &instancedMesh->GetBounds();
+        }
+        if (const auto* arenaMesh = dynamic_cast<const OpenGLArenaMesh*>(&mesh))
+        {
+            return &arenaMesh->GetBounds();
+        }
+        if (const auto* dynamicMesh = dynamic_cast<const OpenGLDynamicMesh*>(&mesh))
+        {
+            return &dynamicMesh->GetBounds();
+        }
+        return nullptr;
+    }
+
+    bool DrawMeshInstances(MeshResource& mesh, uint32 instanceCount, uint32 baseInstance)
+    {
+        if (auto* instancedMesh = dynamic_cast<OpenGLMesh*>(&mesh))
+        {
+            instancedMesh->DrawInstanced(instanceCount, baseInstance);
+            return true;
+        }
+        if (auto* arenaMesh = dynamic_cast<OpenGLArenaMesh*>(&mesh))
+        {
+            arenaMesh->DrawInstanced(instanceCount, baseInstance);
+            return true;
+        }
+        if (auto* dynamicMesh = dynamic_cast<OpenGLDynamicMesh*>(&mesh))
+        {
+            dynamicMesh->DrawInstanced(instanceCount, baseInstance);
+            return true;
+        }
+        return false;
     }
-}
\ No newline at end of file
+}
@@ -1,14 +1,32 @@
 #pragma once
 #include "OpenGLBuffers.h"
+#include "OpenGLCulling.h"
+#include "OpenGLMeshArena.h"
+#include "OpenGLRingBuffer.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLVertexArrayCache.h"
 #include <Tbx/Graphics/Vertex.h>
 #include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Graphics/Color.h>
+#include <Tbx/Math/Mat4x4.h>
+#include <memory>
+#include <vector>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
+    // Per instance data of instanced draws, read by shaders as a mat4 followed by a vec4. Either as instance attributes
+    // starting at OpenGLMesh::GetInstanceAttributeLocation, or as a std430 struct in the render queue's draw storage block.
+    struct MeshInstance
+    {
+        Mat4x4 Transform = {};
+        RgbaColor Color = {};
+    };
+
     class OpenGLMesh final : public MeshResource
     {
     public:
-        OpenGLMesh(const Mesh& mesh);
+        // Packed meshes store their vertices in compact formats, see VertexPacking.
+        OpenGLMesh(const Mesh& mesh, OpenGLStateCache& state, OpenGLVertexArrayCache& vertexArrays, const VertexPacking& packing = {});
         ~OpenGLMesh() override;
 
         void Activate() override;
@@ -18,9 +36,97 @@ namespace Tbx::Plugins::OpenGLRendering
         void SetVertexBuffer(const VertexBuffer& buffer) override;
         void SetIndexBuffer(const IndexBuffer& buffer) override;
 
+        // Uploads per instance data, the instance buffer only grows so updating it every frame doesn't reallocate.
+        void SetInstances(const std::vector<MeshInstance>& instances);
+        // Without instances set, shaders fetch per instance data themselves with gl_BaseInstance + gl_InstanceID.
+        void DrawInstanced(uint32 instanceCount, uint32 baseInstance = 0);
+        uint32 GetInstanceCount() const { return _instanceCount; }
+        uint32 GetInstanceAttributeLocation() const { return _instanceAttributeLocation; }
+        const MeshBounds& GetBounds() const { return _bounds; }
+
+    private:
+        void AcquireVertexArray();
+
     private:
+        OpenGLStateCache& _state;
+        OpenGLVertexArrayCache& _vertexArrays;
         OpenGLVertexBuffer _vertexBuffer;
         OpenGLIndexBuffer _indexBuffer;
+        std::unique_ptr<OpenGLVertexBuffer> _instanceBuffer = nullptr;
+        uint32 _instanceCapacity = 0;
+        uint32 _instanceCount = 0;
+        uint32 _instanceAttributeLocation = 0;
+        MeshBounds _bounds = {};
+        VertexPacking _packing = {};
     };
-}
 
+    // Mesh living in a shared OpenGLMeshArena instead of owning its own vertex array and buffers.
+    class OpenGLArenaMesh final : public MeshResource
+    {
+    public:
+        OpenGLArenaMesh(const Mesh& mesh, OpenGLMeshArena& arena);
+        ~OpenGLArenaMesh() override;
+
+        void Activate() override;
+        void Release() override;
+
+        void Draw() override;
+        void SetVertexBuffer(const VertexBuffer& buffer) override;
+        void SetIndexBuffer(const IndexBuffer& buffer) override;
+
+        void DrawInstanced(uint32 instanceCount, uint32 baseInstance = 0);
+
+        OpenGLMeshArena& GetArena() const { return _arena; }
+        const OpenGLMeshAllocation& GetAllocation() const { return _allocation; }
+        DrawElementsIndirectCommand GetDrawCommand(uint32 baseInstance) const;
+        const MeshBounds& GetBounds() const { return _bounds; }
+
+    private:
+        void Reallocate(uint32 vertexCount, uint32 indexCount);
+
+    private:
+        OpenGLMeshArena& _arena;
+        OpenGLMeshAllocation _allocation = {};
+        MeshBounds _bounds = {};
+    };
+
+    // Mesh for geometry that changes every frame, its vertices and indices are streamed through
+    // persistently mapped ring buffers so updating them never reallocates driver storage.
+    class OpenGLDynamicMesh final : public MeshResource
+    {
+    public:
+        OpenGLDynamicMesh(const Mesh& mesh, OpenGLStateCache& state, OpenGLVertexArrayCache& vertexArrays);
+        ~OpenGLDynamicMesh() override;
+
+        void Activate() override;
+        void Release() override;
+
+        void Draw() override;
+        void SetVertexBuffer(const VertexBuffer& buffer) override;
+        void SetIndexBuffer(const IndexBuffer& buffer) override;
+
+        void DrawInstanced(uint32 instanceCount, uint32 baseInstance = 0);
+
+        const MeshBounds& GetBounds() const { return _bounds; }
+
+    private:
+        void BindRingBuffers();
+
+    private:
+        OpenGLStateCache& _state;
+        OpenGLVertexArrayCache& _vertexArrays;
+        OpenGLRingBuffer _vertexRing;
+        OpenGLRingBuffer _indexRing;
+        uint32 _stride = 0;
+        uint32 _baseVertex = 0;
+        uint32 _indexOffset = 0;
+        uint32 _indexCount = 0;
+        MeshBounds _bounds = {};
+    };
+
+    // Bounds of any of the plugin's meshes, null for anything else
+    const MeshBounds* GetMeshBounds(const MeshResource& mesh);
+    // Draws instances of any of the plugin's meshes starting at baseInstance, so shaders can find their
+    // per draw data at gl_BaseInstance + gl_InstanceID. The mesh must be active, false for anything else.
+    bool DrawMeshInstances(MeshResource& mesh, uint32 instanceCount, uint32 baseInstance);
+}
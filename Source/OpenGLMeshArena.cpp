@@ -0,0 +1,168 @@
+#include "OpenGLMeshArena.h"
+#include "OpenGLHash.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <functional>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static_assert(sizeof(DrawElementsIndirectCommand) == 5 * sizeof(uint32), "Indirect commands must be tightly packed!");
+
+    OpenGLMeshArena::OpenGLMeshArena(const VertexLayout& layout, OpenGLStateCache& state, OpenGLVertexArrayCache& vertexArrays)
+        : _state(state)
+        , _layout(layout)
+        , _vertexArray(vertexArrays.Acquire(OpenGLVertexBuffer::GetLayoutFormat(layout)))
+    {
+        TBX_ASSERT(layout.Stride > 0, "GL Rendering: Mesh arenas require a vertex layout with a stride!");
+        glCreateBuffers(1, &_indirectBufferGLId);
+    }
+
+    OpenGLMeshArena::~OpenGLMeshArena()
+    {
+        _state.GetMemoryTracker().Untrack(GpuMemoryType::IndirectBuffer, _indirectBufferGLId);
+        _state.OnBufferDeleted(_indirectBufferGLId);
+        glDeleteBuffers(1, &_indirectBufferGLId);
+    }
+
+    uint64_t OpenGLMeshArena::HashLayout(const VertexLayout& layout)
+    {
+        // FNV-1a over everything that affects how attributes are read
+        auto hash = HashSeed;
+        const auto mix = [&hash](uint64_t value) { hash = HashCombine(hash, value); };
+
+        mix(layout.Stride);
+        for (const auto& element : layout.Elements)
+        {
+            mix(element.Type.index());
+            mix(element.Count);
+            mix(element.Offset);
+            mix(element.Normalized ? 1 : 0);
+        }
+        return hash;
+    }
+
+    OpenGLMeshAllocation OpenGLMeshArena::Allocate(uint32 vertexCount, uint32 indexCount)
+    {
+        for (uint32 blockIndex = 0; blockIndex <= (uint32)_blocks.size(); blockIndex++)
+        {
+            if (blockIndex == _blocks.size())
+            {
+                AddBlock(vertexCount, indexCount);
+            }
+
+            auto& block = *_blocks[blockIndex];
+            const auto baseVertex = block.VertexRanges.Allocate(vertexCount);
+            if (!baseVertex)
+            {
+                continue;
+            }
+            const auto firstIndex = block.IndexRanges.Allocate(indexCount);
+            if (!firstIndex)
+            {
+                block.VertexRanges.Free(*baseVertex, vertexCount);
+                continue;
+            }
+
+            return { blockIndex, *baseVertex, vertexCount, *firstIndex, indexCount };
+        }
+
+        TBX_ASSERT(false, "GL Rendering: Failed to allocate mesh from arena!");
+        return {};
+    }
+
+    void OpenGLMeshArena::Free(const OpenGLMeshAllocation& allocation)
+    {
+        if (allocation.Block >= _blocks.size())
+        {
+            return;
+        }
+
+        auto& block = *_blocks[allocation.Block];
+        block.VertexRanges.Free(allocation.BaseVertex, allocation.VertexCount);
+        block.IndexRanges.Free(allocation.FirstIndex, allocation.IndexCount);
+    }
+
+    void OpenGLMeshArena::UploadVertices(const OpenGLMeshAllocation& allocation, const VertexBuffer& buffer) const
+    {
+        const auto sizeInBytes = (uint32)(buffer.Vertices.size() * sizeof(float));
+        TBX_ASSERT(sizeInBytes <= allocation.VertexCount * _layout.Stride, "GL Rendering: Vertices don't fit their arena allocation!");
+        _blocks[allocation.Block]->Vertices.UploadRange(allocation.BaseVertex * _layout.Stride, buffer.Vertices.data(), sizeInBytes);
+    }
+
+    void OpenGLMeshArena::UploadIndices(const OpenGLMeshAllocation& allocation, const IndexBuffer& buffer) const
+    {
+        TBX_ASSERT(buffer.size() <= allocation.IndexCount, "GL Rendering: Indices don't fit their arena allocation!");
+        _blocks[allocation.Block]->Indices.UploadRange(allocation.FirstIndex * sizeof(uint32), buffer.data(), (uint32)(buffer.size() * sizeof(uint32)));
+    }
+
+    void OpenGLMeshArena::CopyVertices(const OpenGLMeshAllocation& from, const OpenGLMeshAllocation& to) const
+    {
+        const auto sizeInBytes = std::min(from.VertexCount, to.VertexCount) * _layout.Stride;
+        glCopyNamedBufferSubData(
+            _blocks[from.Block]->Vertices.GetGLId(), _blocks[to.Block]->Vertices.GetGLId(),
+            from.BaseVertex * _layout.Stride, to.BaseVertex * _layout.Stride, sizeInBytes);
+    }
+
+    void OpenGLMeshArena::CopyIndices(const OpenGLMeshAllocation& from, const OpenGLMeshAllocation& to) const
+    {
+        const auto sizeInBytes = std::min(from.IndexCount, to.IndexCount) * (uint32)sizeof(uint32);
+        glCopyNamedBufferSubData(
+            _blocks[from.Block]->Indices.GetGLId(), _blocks[to.Block]->Indices.GetGLId(),
+            from.FirstIndex * sizeof(uint32), to.FirstIndex * sizeof(uint32), sizeInBytes);
+    }
+
+    void OpenGLMeshArena::BindBlock(uint32 block) const
+    {
+        // Blocks share the vertex array of our layout, switching between them only swaps buffers
+        const auto& blockBuffers = *_blocks[block];
+        _state.BindVertexArray(_vertexArray);
+        _state.BindVertexBuffer(_vertexArray, OpenGLVertexArrayCache::VertexBinding, blockBuffers.Vertices.GetGLId(), 0, _layout.Stride);
+        _state.BindElementBuffer(_vertexArray, blockBuffers.Indices.GetGLId());
+    }
+
+    void OpenGLMeshArena::UnbindBlock() const
+    {
+        if (_state.IsStrictMode())
+        {
+            _state.BindVertexArray(0);
+        }
+    }
+
+    void OpenGLMeshArena::DrawBlock(uint32 block, const std::vector<DrawElementsIndirectCommand>& commands)
+    {
+        if (commands.empty())
+        {
+            return;
+        }
+
+        // Orphan and refill the indirect buffer, growing it when needed
+        const auto sizeInBytes = (uint32)(commands.size() * sizeof(DrawElementsIndirectCommand));
+        if (sizeInBytes > _indirectBufferSize)
+        {
+            _indirectBufferSize = std::max(sizeInBytes, _indirectBufferSize * 2);
+        }
+        glNamedBufferData(_indirectBufferGLId, _indirectBufferSize, nullptr, GL_STREAM_DRAW);
+        _state.GetMemoryTracker().Track(GpuMemoryType::IndirectBuffer, _indirectBufferGLId, _indirectBufferSize);
+        glNamedBufferSubData(_indirectBufferGLId, 0, sizeInBytes, commands.data());
+
+        BindBlock(block);
+        _state.BindBuffer(GL_DRAW_INDIRECT_BUFFER, _indirectBufferGLId);
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+        _state.CountUpload(sizeInBytes);
+        _state.CountDraws();
+    }
+
+    void OpenGLMeshArena::AddBlock(uint32 minVertexCount, uint32 minIndexCount)
+    {
+        const auto vertexCapacity = std::max(DefaultBlockVertexBytes / _layout.Stride, minVertexCount);
+        const auto indexCapacity = std::max(DefaultBlockIndexCount, minIndexCount);
+
+        auto block = std::make_unique<Block>(_state);
+        block->VertexRanges = OpenGLFreeListAllocator(vertexCapacity);
+        block->IndexRanges = OpenGLFreeListAllocator(indexCapacity);
+        block->Vertices.Allocate(vertexCapacity * _layout.Stride);
+        block->Indices.Allocate(indexCapacity * (uint32)sizeof(uint32));
+        _blocks.push_back(std::move(block));
+    }
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include "OpenGLBuffers.h"
+#include "OpenGLFreeListAllocator.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLVertexArrayCache.h"
+#include <memory>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Matches the layout glMultiDrawElementsIndirect expects.
+    struct DrawElementsIndirectCommand
+    {
+        uint32 Count = 0;
+        uint32 InstanceCount = 0;
+        uint32 FirstIndex = 0;
+        int BaseVertex = 0;
+        uint32 BaseInstance = 0;
+    };
+
+    struct OpenGLMeshAllocation
+    {
+        uint32 Block = 0;
+        uint32 BaseVertex = 0;
+        uint32 VertexCount = 0;
+        uint32 FirstIndex = 0;
+        uint32 IndexCount = 0;
+    };
+
+    // Sub-allocates meshes sharing one vertex layout out of a few large vertex and index buffers,
+    // so they can be drawn together with a single multi draw per block.
+    class OpenGLMeshArena final
+    {
+    public:
+        static constexpr uint32 DefaultBlockVertexBytes = 16 * 1024 * 1024;
+        static constexpr uint32 DefaultBlockIndexCount = 4 * 1024 * 1024;
+
+        OpenGLMeshArena(const VertexLayout& layout, OpenGLStateCache& state, OpenGLVertexArrayCache& vertexArrays);
+        ~OpenGLMeshArena();
+
+        static uint64_t HashLayout(const VertexLayout& layout);
+        const VertexLayout& GetLayout() const { return _layout; }
+        OpenGLStateCache& GetStateCache() const { return _state; }
+        uint32 GetBlockCount() const { return (uint32)_blocks.size(); }
+
+        // Finds room for a mesh, adding a new block if none of the existing ones can fit it.
+        OpenGLMeshAllocation Allocate(uint32 vertexCount, uint32 indexCount);
+        void Free(const OpenGLMeshAllocation& allocation);
+
+        void UploadVertices(const OpenGLMeshAllocation& allocation, const VertexBuffer& buffer) const;
+        void UploadIndices(const OpenGLMeshAllocation& allocation, const IndexBuffer& buffer) const;
+
+        void CopyVertices(const OpenGLMeshAllocation& from, const OpenGLMeshAllocation& to) const;
+        void CopyIndices(const OpenGLMeshAllocation& from, const OpenGLMeshAllocation& to) const;
+
+        void BindBlock(uint32 block) const;
+        void UnbindBlock() const;
+
+        // Issues all commands with one glMultiDrawElementsIndirect, commands must all target the given block.
+        void DrawBlock(uint32 block, const std::vector<DrawElementsIndirectCommand>& commands);
+
+    private:
+        struct Block
+        {
+            Block(OpenGLStateCache& state) : Vertices(state), Indices(state) {}
+
+            OpenGLVertexBuffer Vertices;
+            OpenGLIndexBuffer Indices;
+            OpenGLFreeListAllocator VertexRanges = {};
+            OpenGLFreeListAllocator IndexRanges = {};
+        };
+
+        void AddBlock(uint32 minVertexCount, uint32 minIndexCount);
+
+    private:
+        OpenGLStateCache& _state;
+        VertexLayout _layout = {};
+        uint32 _vertexArray = 0;
+        std::vector<std::unique_ptr<Block>> _blocks = {};
+        uint32 _indirectBufferGLId = 0;
+        uint32 _indirectBufferSize = 0;
+    };
+}
@@ -0,0 +1,319 @@
+#include "OpenGLMeshOptimizer.h"
+#include "OpenGLCulling.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static constexpr uint32 NoVertex = ~0u;
+
+    void MeshOptimizationStats::Add(const MeshOptimizationStats& other)
+    {
+        Meshes += other.Meshes;
+        Triangles += other.Triangles;
+        Vertices += other.Vertices;
+        TransformsBefore += other.TransformsBefore;
+        TransformsAfter += other.TransformsAfter;
+    }
+
+    uint64_t CountVertexTransforms(const IndexBuffer& indices, uint32 vertexCount, uint32 cacheSize)
+    {
+        // A vertex is cached while fewer than cacheSize misses happened since its own
+        std::vector<uint64_t> cachedAt(vertexCount, 0);
+        uint64_t time = cacheSize;
+        uint64_t transforms = 0;
+        for (const auto index : indices)
+        {
+            if (time - cachedAt[index] >= cacheSize)
+            {
+                cachedAt[index] = time++;
+                transforms++;
+            }
+        }
+        return transforms;
+    }
+
+    std::vector<uint32> OptimizeVertexCache(IndexBuffer& indices, uint32 vertexCount, uint32 cacheSize)
+    {
+        const auto triangleCount = (uint32)indices.size() / 3;
+        std::vector<uint32> clusterStarts = {};
+        if (triangleCount == 0)
+        {
+            return clusterStarts;
+        }
+
+        // Triangles using each vertex, and how many of them are still to be emitted
+        std::vector<uint32> liveTriangles(vertexCount, 0);
+        for (uint32 i = 0; i < triangleCount * 3; i++)
+        {
+            liveTriangles[indices[i]]++;
+        }
+        std::vector<uint32> adjacencyOffsets(vertexCount + 1, 0);
+        std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+        std::vector<uint32> adjacency(triangleCount * 3);
+        {
+            auto cursors = adjacencyOffsets;
+            for (uint32 i = 0; i < triangleCount * 3; i++)
+            {
+                adjacency[cursors[indices[i]]++] = i / 3;
+            }
+        }
+
+        std::vector<uint32> cachedAt(vertexCount, 0);
+        std::vector<uint8_t> isEmitted(triangleCount, 0);
+        std::vector<uint32> deadEnds = {};
+        std::vector<uint32> candidates = {};
+        std::vector<uint32> order = {};
+        order.reserve(triangleCount);
+        uint32 time = cacheSize + 1;
+        uint32 cursor = 0;
+
+        // Most recently used vertex with triangles left, or failing that the next one in input order
+        const auto skipDeadEnd = [&]()
+        {
+            while (!deadEnds.empty())
+            {
+                const auto vertex = deadEnds.back();
+                deadEnds.pop_back();
+                if (liveTriangles[vertex] > 0)
+                {
+                    return vertex;
+                }
+            }
+            while (cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0)
+                {
+                    return cursor;
+                }
+                cursor++;
+            }
+            return NoVertex;
+        };
+
+        auto fanning = skipDeadEnd();
+        clusterStarts.push_back(0);
+        while (fanning != NoVertex)
+        {
+            // Every triangle left around the fanning vertex
+            candidates.clear();
+            for (uint32 i = adjacencyOffsets[fanning]; i < adjacencyOffsets[fanning + 1]; i++)
+            {
+                const auto triangle = adjacency[i];
+                if (isEmitted[triangle])
+                {
+                    continue;
+                }
+                for (uint32 corner = 0; corner < 3; corner++)
+                {
+                    const auto vertex = indices[triangle * 3 + corner];
+                    deadEnds.push_back(vertex);
+                    candidates.push_back(vertex);
+                    liveTriangles[vertex]--;
+                    if (time - cachedAt[vertex] > cacheSize)
+                    {
+                        cachedAt[vertex] = time++;
+                    }
+                }
+                isEmitted[triangle] = 1;
+                order.push_back(triangle);
+            }
+
+            // The candidate that's been cached longest and will still be once its own triangles are emitted
+            auto next = NoVertex;
+            uint32 bestPriority = 0;
+            for (const auto vertex : candidates)
+            {
+                if (liveTriangles[vertex] == 0)
+                {
+                    continue;
+                }
+                const auto age = time - cachedAt[vertex];
+                const auto priority = age + 2 * liveTriangles[vertex] <= cacheSize ? age : 0;
+                if (priority > bestPriority)
+                {
+                    bestPriority = priority;
+                    next = vertex;
+                }
+            }
+            if (next == NoVertex)
+            {
+                next = skipDeadEnd();
+                if (next != NoVertex)
+                {
+                    clusterStarts.push_back((uint32)order.size());
+                }
+            }
+            fanning = next;
+        }
+
+        IndexBuffer reordered(indices.size());
+        for (uint32 i = 0; i < triangleCount; i++)
+        {
+            std::memcpy(&reordered[i * 3], &indices[order[i] * 3], 3 * sizeof(uint32));
+        }
+        // Anything past the last whole triangle stays where it was
+        std::copy(indices.begin() + triangleCount * 3, indices.end(), reordered.begin() + triangleCount * 3);
+        indices = std::move(reordered);
+        return clusterStarts;
+    }
+
+    void OptimizeOverdraw(IndexBuffer& indices, const VertexBuffer& vertices, const std::vector<uint32>& clusterStarts)
+    {
+        const auto* position = FindPositionElement(vertices.Layout);
+        const auto stride = vertices.Layout.Stride;
+        const auto triangleCount = (uint32)indices.size() / 3;
+        if (!position || stride == 0 || clusterStarts.size() < 2)
+        {
+            return;
+        }
+
+        const auto* bytes = reinterpret_cast<const uint8_t*>(vertices.Vertices.data()) + position->Offset;
+        const auto readPosition = [&](uint32 vertex)
+        {
+            std::array<float, 3> value = {};
+            std::memcpy(value.data(), bytes + (size_t)vertex * stride, sizeof(value));
+            return value;
+        };
+
+        // Area weighted centroid and normal of each cluster, the cross product's length is twice the triangle's area
+        struct Cluster
+        {
+            std::array<float, 3> Centroid = {};
+            std::array<float, 3> Normal = {};
+            float Area = 0.0f;
+            uint32 First = 0;
+            uint32 Count = 0;
+            float SortKey = 0.0f;
+        };
+        std::vector<Cluster> clusters(clusterStarts.size());
+        std::array<float, 3> meshCentroid = {};
+        float meshArea = 0.0f;
+        for (uint32 c = 0; c < (uint32)clusters.size(); c++)
+        {
+            auto& cluster = clusters[c];
+            cluster.First = clusterStarts[c];
+            cluster.Count = (c + 1 < clusterStarts.size() ? clusterStarts[c + 1] : triangleCount) - cluster.First;
+            for (uint32 triangle = cluster.First; triangle < cluster.First + cluster.Count; triangle++)
+            {
+                const auto a = readPosition(indices[triangle * 3]);
+                const auto b = readPosition(indices[triangle * 3 + 1]);
+                const auto p = readPosition(indices[triangle * 3 + 2]);
+                const std::array<float, 3> ab = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+                const std::array<float, 3> ap = { p[0] - a[0], p[1] - a[1], p[2] - a[2] };
+                const std::array<float, 3> normal = { ab[1] * ap[2] - ab[2] * ap[1], ab[2] * ap[0] - ab[0] * ap[2], ab[0] * ap[1] - ab[1] * ap[0] };
+                const auto area = std::sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+                for (uint32 i = 0; i < 3; i++)
+                {
+                    cluster.Centroid[i] += (a[i] + b[i] + p[i]) / 3.0f * area;
+                    cluster.Normal[i] += normal[i];
+                }
+                cluster.Area += area;
+            }
+            for (uint32 i = 0; i < 3; i++)
+            {
+                meshCentroid[i] += cluster.Centroid[i];
+            }
+            meshArea += cluster.Area;
+        }
+        if (meshArea <= 0.0f)
+        {
+            return;
+        }
+        for (auto& value : meshCentroid) value /= meshArea;
+
+        // How far the cluster faces out of the mesh, clusters on the outside facing the camera hide what's behind them
+        for (auto& cluster : clusters)
+        {
+            const auto normalLength = std::sqrt(cluster.Normal[0] * cluster.Normal[0] + cluster.Normal[1] * cluster.Normal[1] + cluster.Normal[2] * cluster.Normal[2]);
+            if (cluster.Area <= 0.0f || normalLength <= 0.0f)
+            {
+                continue;
+            }
+            for (uint32 i = 0; i < 3; i++)
+            {
+                cluster.SortKey += (cluster.Centroid[i] / cluster.Area - meshCentroid[i]) * cluster.Normal[i] / normalLength;
+            }
+        }
+        std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.SortKey > b.SortKey; });
+
+        IndexBuffer reordered(indices.begin(), indices.end());
+        uint32 written = 0;
+        for (const auto& cluster : clusters)
+        {
+            std::copy(indices.begin() + cluster.First * 3, indices.begin() + (cluster.First + cluster.Count) * 3, reordered.begin() + written * 3);
+            written += cluster.Count;
+        }
+        indices = std::move(reordered);
+    }
+
+    void OptimizeVertexFetch(VertexBuffer& vertices, IndexBuffer& indices)
+    {
+        const auto stride = vertices.Layout.Stride;
+        const auto vertexCount = (uint32)(vertices.Vertices.size() * sizeof(float) / stride);
+
+        std::vector<uint32> remap(vertexCount, NoVertex);
+        uint32 nextVertex = 0;
+        for (auto& index : indices)
+        {
+            if (remap[index] == NoVertex)
+            {
+                remap[index] = nextVertex++;
+            }
+            index = remap[index];
+        }
+        for (auto& newVertex : remap)
+        {
+            if (newVertex == NoVertex)
+            {
+                newVertex = nextVertex++;
+            }
+        }
+
+        std::vector<float> reordered(vertices.Vertices.size());
+        const auto* source = reinterpret_cast<const uint8_t*>(vertices.Vertices.data());
+        auto* destination = reinterpret_cast<uint8_t*>(reordered.data());
+        for (uint32 vertex = 0; vertex < vertexCount; vertex++)
+        {
+            std::memcpy(destination + (size_t)remap[vertex] * stride, source + (size_t)vertex * stride, stride);
+        }
+        // A partial vertex at the end stays there
+        const auto wholeBytes = (size_t)vertexCount * stride;
+        std::memcpy(destination + wholeBytes, source + wholeBytes, vertices.Vertices.size() * sizeof(float) - wholeBytes);
+        vertices.Vertices = std::move(reordered);
+    }
+
+    MeshOptimizationStats OptimizeMesh(Mesh& mesh, bool reduceOverdraw)
+    {
+        auto& indices = mesh.Indices;
+        const auto stride = mesh.Vertices.Layout.Stride;
+        const auto vertexCount = stride ? (uint32)(mesh.Vertices.Vertices.size() * sizeof(float) / stride) : 0;
+        if (vertexCount == 0 || indices.size() < 3 || indices.size() % 3 != 0)
+        {
+            return {};
+        }
+        if (std::any_of(indices.begin(), indices.end(), [vertexCount](uint32 index) { return index >= vertexCount; }))
+        {
+            return {};
+        }
+
+        MeshOptimizationStats stats = {};
+        stats.Meshes = 1;
+        stats.Triangles = (uint32)indices.size() / 3;
+        stats.Vertices = vertexCount;
+        stats.TransformsBefore = CountVertexTransforms(indices, vertexCount);
+
+        const auto clusterStarts = OptimizeVertexCache(indices, vertexCount);
+        if (reduceOverdraw)
+        {
+            OptimizeOverdraw(indices, mesh.Vertices, clusterStarts);
+        }
+        OptimizeVertexFetch(mesh.Vertices, indices);
+
+        stats.TransformsAfter = CountVertexTransforms(indices, vertexCount);
+        return stats;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <Tbx/Graphics/Mesh.h>
+#include <Tbx/Graphics/Vertex.h>
+#include <Tbx/Math/Int.h>
+#include <cstdint>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Entries of the FIFO post-transform cache meshes are optimized for and measured with.
+    // Real GPUs vary, orders good for 16 entries stay good for other sizes.
+    static constexpr uint32 VertexCacheSize = 16;
+
+    struct MeshOptimizationStats
+    {
+        uint32 Meshes = 0;
+        uint32 Triangles = 0;
+        uint32 Vertices = 0;
+        // Vertex shader invocations, misses in a VertexCacheSize FIFO cache, before and after optimizing
+        uint64_t TransformsBefore = 0;
+        uint64_t TransformsAfter = 0;
+
+        // Average cache miss ratio, transforms per triangle. 3 is the worst, around 0.5 to 0.7 is good for a regular grid.
+        float GetAcmrBefore() const { return Triangles ? (float)TransformsBefore / Triangles : 0.0f; }
+        float GetAcmrAfter() const { return Triangles ? (float)TransformsAfter / Triangles : 0.0f; }
+        // Average transform to vertex ratio, 1 is ideal whatever the mesh.
+        float GetAtvrBefore() const { return Vertices ? (float)TransformsBefore / Vertices : 0.0f; }
+        float GetAtvrAfter() const { return Vertices ? (float)TransformsAfter / Vertices : 0.0f; }
+
+        void Add(const MeshOptimizationStats& other);
+    };
+
+    // How many vertices a FIFO post-transform cache of cacheSize entries transforms drawing the triangle list.
+    uint64_t CountVertexTransforms(const IndexBuffer& indices, uint32 vertexCount, uint32 cacheSize = VertexCacheSize);
+
+    // Reorders triangles for the post-transform cache with Tipsify, fanning around the vertex that stays cached longest.
+    // Returns where each cluster starts in the new order, in triangles. A cluster ends where the fan had to jump to a
+    // vertex that isn't cached, so clusters can be reordered with little loss in cache hits.
+    std::vector<uint32> OptimizeVertexCache(IndexBuffer& indices, uint32 vertexCount, uint32 cacheSize = VertexCacheSize);
+
+    // Sorts the clusters of OptimizeVertexCache so those facing away from the mesh's centre draw first,
+    // they tend to occlude the rest. Needs the buffer's positions, see FindPositionElement.
+    void OptimizeOverdraw(IndexBuffer& indices, const VertexBuffer& vertices, const std::vector<uint32>& clusterStarts);
+
+    // Reorders vertices in the order the indices first use them and remaps the indices, so vertex fetches walk memory forwards.
+    // Vertices no index uses move to the end.
+    void OptimizeVertexFetch(VertexBuffer& vertices, IndexBuffer& indices);
+
+    // All of the above, in order. Meshes that aren't triangle lists over their own vertices are left as they are.
+    MeshOptimizationStats OptimizeMesh(Mesh& mesh, bool reduceOverdraw);
+}
@@ -0,0 +1,65 @@
+#include "OpenGLNamePool.h"
+#include <glad/glad.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLNamePool::~OpenGLNamePool()
+    {
+        if (!_buffers.empty())
+        {
+            glDeleteBuffers((GLsizei)_buffers.size(), _buffers.data());
+        }
+        for (auto& [target, textures] : _textures)
+        {
+            if (!textures.empty())
+            {
+                glDeleteTextures((GLsizei)textures.size(), textures.data());
+            }
+        }
+    }
+
+    uint32 OpenGLNamePool::AcquireBuffer()
+    {
+        if (_buffers.empty())
+        {
+            _buffers.resize(BatchSize);
+            glCreateBuffers(BatchSize, _buffers.data());
+        }
+
+        const auto buffer = _buffers.back();
+        _buffers.pop_back();
+        return buffer;
+    }
+
+    void OpenGLNamePool::ReleaseBuffer(uint32 buffer)
+    {
+        if (_buffers.size() >= MaxPooledBuffers)
+        {
+            glDeleteBuffers(1, &buffer);
+            return;
+        }
+
+        // Orphan the storage so the memory goes back to the driver while the name waits for its next owner
+        glNamedBufferData(buffer, 0, nullptr, GL_STATIC_DRAW);
+        _buffers.push_back(buffer);
+    }
+
+    uint32 OpenGLNamePool::AcquireTexture(uint32 target)
+    {
+        auto& textures = _textures[target];
+        if (textures.empty())
+        {
+            textures.resize(BatchSize);
+            glCreateTextures(target, BatchSize, textures.data());
+        }
+
+        const auto texture = textures.back();
+        textures.pop_back();
+        return texture;
+    }
+
+    void OpenGLNamePool::ReleaseTexture(uint32 texture)
+    {
+        glDeleteTextures(1, &texture);
+    }
+}
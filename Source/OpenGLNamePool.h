@@ -0,0 +1,37 @@
+#pragma once
+#include <Tbx/Math/Int.h>
+#include <unordered_map>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Hands out buffer and texture names, created in batches so short lived resources don't cost a driver call each.
+    // Released buffers keep their name with their storage dropped and are handed out again.
+    // Textures have immutable storage which can't be respecified, so released ones are deleted for real.
+    class OpenGLNamePool final
+    {
+    public:
+        static constexpr uint32 BatchSize = 32;
+        static constexpr uint32 MaxPooledBuffers = 256;
+
+        OpenGLNamePool() = default;
+        ~OpenGLNamePool();
+
+        OpenGLNamePool(const OpenGLNamePool&) = delete;
+        OpenGLNamePool& operator=(const OpenGLNamePool&) = delete;
+
+        // Buffers handed out have no storage, give them some with glNamedBufferData.
+        uint32 AcquireBuffer();
+        void ReleaseBuffer(uint32 buffer);
+
+        uint32 AcquireTexture(uint32 target);
+        void ReleaseTexture(uint32 texture);
+
+        uint32 GetPooledBufferCount() const { return (uint32)_buffers.size(); }
+
+    private:
+        std::vector<uint32> _buffers = {};
+        // Texture names are created for a target and can't be bound to any other
+        std::unordered_map<uint32, std::vector<uint32>> _textures = {};
+    };
+}
@@ -0,0 +1,266 @@
+#include "OpenGLProfiler.h"
+#include <Tbx/Debug/Asserts.h>
+#include <Tbx/Debug/Tracers.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    /// Helpers ///////////////////////////////////////////////////////////
+
+    static void AppendJsonString(std::string& json, std::string_view value)
+    {
+        json += '"';
+        for (const char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                json += '\\';
+                json += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                char escaped[8] = {};
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                json += escaped;
+            }
+            else
+            {
+                json += c;
+            }
+        }
+        json += '"';
+    }
+
+    // Complete ("X") event, times are nanoseconds but the trace format wants microseconds
+    static void AppendTraceEvent(std::string& json, std::string_view name, const char* category, uint32 thread, int64_t begin, int64_t end, uint64_t frame)
+    {
+        char buffer[192] = {};
+        json += "{\"name\":";
+        AppendJsonString(json, name);
+        std::snprintf(buffer, sizeof(buffer), ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u,\"args\":{\"frame\":%llu}},\n",
+            category, (double)begin / 1000.0, (double)(end - begin) / 1000.0, thread, (unsigned long long)frame);
+        json += buffer;
+    }
+
+    /// Profiler //////////////////////////////////////////////////////////
+
+    OpenGLProfiler::OpenGLProfiler()
+    {
+        _epoch = GetCpuTime();
+    }
+
+    OpenGLProfiler::~OpenGLProfiler()
+    {
+        if (!_queries.empty())
+        {
+            glDeleteQueries((GLsizei)_queries.size(), _queries.data());
+        }
+    }
+
+    void OpenGLProfiler::SetCapturedFrameCount(uint32 frameCount)
+    {
+        _capturedFrameCount = std::max(frameCount, 1u);
+        while (_frames.size() > _capturedFrameCount)
+        {
+            _frames.pop_front();
+        }
+    }
+
+    void OpenGLProfiler::BeginFrame(uint64_t frameNumber)
+    {
+        TBX_ASSERT(!_isRecording, "GL Rendering: Profiler frame began before the last one ended!");
+
+        // The slot we're about to reuse was recorded a few frames ago, its queries have most likely landed by now
+        _pendingFrame = (_pendingFrame + 1) % FrameLatency;
+        auto& pending = _pendingFrames[_pendingFrame];
+        if (pending.IsRecorded)
+        {
+            Resolve(pending);
+        }
+
+        _isRecording = _isEnabled;
+        if (!_isRecording)
+        {
+            return;
+        }
+
+        // Line up GPU timestamps with our clock once, both tick in nanoseconds
+        if (!_isGpuClockSynced)
+        {
+            GLint64 gpuTime = 0;
+            glGetInteger64v(GL_TIMESTAMP, &gpuTime);
+            _gpuToCpuOffset = GetCpuTime() - (int64_t)gpuTime;
+            _isGpuClockSynced = true;
+        }
+
+        pending.Results = {};
+        pending.Results.Number = frameNumber;
+        pending.ScopeQueries.clear();
+        pending.IsRecorded = true;
+        BeginScope("Frame");
+    }
+
+    void OpenGLProfiler::EndFrame(const OpenGLStateCache::FrameStats& stats)
+    {
+        if (!_isRecording)
+        {
+            return;
+        }
+
+        TBX_ASSERT(_openScopes.size() == 1, "GL Rendering: Profiler scopes are unbalanced!");
+        while (!_openScopes.empty())
+        {
+            EndScope();
+        }
+
+        _pendingFrames[_pendingFrame].Results.Stats = stats;
+        _isRecording = false;
+    }
+
+    void OpenGLProfiler::BeginScope(std::string_view name)
+    {
+        if (!_isRecording)
+        {
+            return;
+        }
+
+        auto& pending = _pendingFrames[_pendingFrame];
+        _openScopes.push_back((uint32)pending.Results.Scopes.size());
+
+        Scope scope = {};
+        scope.Name = name;
+        scope.Depth = (uint32)_openScopes.size() - 1;
+        scope.CpuBegin = GetCpuTime();
+        pending.Results.Scopes.push_back(std::move(scope));
+
+        const auto beginQuery = AcquireQuery();
+        pending.ScopeQueries.push_back({ beginQuery, AcquireQuery() });
+        glQueryCounter(beginQuery, GL_TIMESTAMP);
+    }
+
+    void OpenGLProfiler::EndScope()
+    {
+        if (!_isRecording || _openScopes.empty())
+        {
+            return;
+        }
+
+        auto& pending = _pendingFrames[_pendingFrame];
+        const auto scope = _openScopes.back();
+        _openScopes.pop_back();
+
+        glQueryCounter(pending.ScopeQueries[scope][1], GL_TIMESTAMP);
+        pending.Results.Scopes[scope].CpuEnd = GetCpuTime();
+    }
+
+    std::string OpenGLProfiler::ToChromeTrace() const
+    {
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+        json += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}},\n";
+
+        char buffer[256] = {};
+        for (const auto& frame : _frames)
+        {
+            for (const auto& scope : frame.Scopes)
+            {
+                AppendTraceEvent(json, scope.Name, "cpu", 1, scope.CpuBegin, scope.CpuEnd, frame.Number);
+                if (scope.HasGpuTime)
+                {
+                    AppendTraceEvent(json, scope.Name, "gpu", 2, scope.GpuBegin, scope.GpuEnd, frame.Number);
+                }
+            }
+
+            // Counters are sampled at the start of their frame
+            const auto frameBegin = frame.Scopes.empty() ? 0 : frame.Scopes.front().CpuBegin;
+            std::snprintf(buffer, sizeof(buffer), "{\"name\":\"Frame Stats\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"args\":{\"draws\":%u,\"binds\":%u,\"skippedBinds\":%u,\"uploadedBytes\":%llu}},\n",
+                (double)frameBegin / 1000.0, frame.Stats.DrawCalls, frame.Stats.IssuedCalls, frame.Stats.SkippedCalls, (unsigned long long)frame.Stats.UploadedBytes);
+            json += buffer;
+        }
+
+        // Drop the trailing comma, JSON doesn't allow it
+        if (json.ends_with(",\n"))
+        {
+            json.erase(json.size() - 2, 1);
+        }
+        json += "]}\n";
+        return json;
+    }
+
+    bool OpenGLProfiler::ExportChromeTrace(const std::filesystem::path& path) const
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        if (!file)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to open {0} for the profiler trace!", path.string());
+            return false;
+        }
+
+        const auto json = ToChromeTrace();
+        file.write(json.data(), (std::streamsize)json.size());
+        return (bool)file;
+    }
+
+    int64_t OpenGLProfiler::GetCpuTime() const
+    {
+        const auto now = std::chrono::steady_clock::now().time_since_epoch();
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count() - _epoch;
+    }
+
+    uint32 OpenGLProfiler::AcquireQuery()
+    {
+        if (_freeQueries.empty())
+        {
+            uint32 query = 0;
+            glCreateQueries(GL_TIMESTAMP, 1, &query);
+            _queries.push_back(query);
+            return query;
+        }
+
+        const auto query = _freeQueries.back();
+        _freeQueries.pop_back();
+        return query;
+    }
+
+    void OpenGLProfiler::Resolve(PendingFrame& pending)
+    {
+        // The frame's own end timestamp was issued last, once it's there the rest are too
+        GLint isAvailable = GL_FALSE;
+        if (!pending.ScopeQueries.empty())
+        {
+            glGetQueryObjectiv(pending.ScopeQueries.front()[1], GL_QUERY_RESULT_AVAILABLE, &isAvailable);
+        }
+
+        auto& scopes = pending.Results.Scopes;
+        for (size_t i = 0; i < scopes.size(); i++)
+        {
+            const auto& queries = pending.ScopeQueries[i];
+            if (isAvailable)
+            {
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+                scopes[i].GpuBegin = (int64_t)begin + _gpuToCpuOffset;
+                scopes[i].GpuEnd = (int64_t)end + _gpuToCpuOffset;
+                scopes[i].HasGpuTime = true;
+            }
+            _freeQueries.push_back(queries[0]);
+            _freeQueries.push_back(queries[1]);
+        }
+
+        _frames.push_back(std::move(pending.Results));
+        while (_frames.size() > _capturedFrameCount)
+        {
+            _frames.pop_front();
+        }
+
+        pending.Results = {};
+        pending.ScopeQueries.clear();
+        pending.IsRecorded = false;
+    }
+}
@@ -0,0 +1,130 @@
+#pragma once
+#include "OpenGLStateCache.h"
+#include <Tbx/Math/Int.h>
+#include <array>
+#include <cstdint>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Records named, nested CPU and GPU scopes per frame.
+    // GPU times come from timestamp queries that are read back a couple frames later, and only once the driver
+    // reports them available, so profiling never stalls the pipeline. Frames whose queries weren't ready in time
+    // keep their CPU times but have no GPU times.
+    class OpenGLProfiler final
+    {
+    public:
+        static constexpr uint32 DefaultCapturedFrameCount = 300;
+
+        struct Scope
+        {
+            std::string Name = {};
+            uint32 Depth = 0;
+            // Nanoseconds since the profiler was created, GPU times are converted to the same clock
+            int64_t CpuBegin = 0;
+            int64_t CpuEnd = 0;
+            int64_t GpuBegin = 0;
+            int64_t GpuEnd = 0;
+            bool HasGpuTime = false;
+
+            double GetCpuTimeMs() const { return (double)(CpuEnd - CpuBegin) / 1000000.0; }
+            double GetGpuTimeMs() const { return (double)(GpuEnd - GpuBegin) / 1000000.0; }
+        };
+
+        struct Frame
+        {
+            uint64_t Number = 0;
+            // Outermost scope first, scopes are stored in the order they began
+            std::vector<Scope> Scopes = {};
+            OpenGLStateCache::FrameStats Stats = {};
+        };
+
+        OpenGLProfiler();
+        ~OpenGLProfiler();
+
+        OpenGLProfiler(const OpenGLProfiler&) = delete;
+        OpenGLProfiler& operator=(const OpenGLProfiler&) = delete;
+
+        // Takes effect on the next frame.
+        void SetEnabled(bool enabled) { _isEnabled = enabled; }
+        bool IsEnabled() const { return _isEnabled; }
+
+        // How many of the most recent frames are kept around for inspection and export.
+        void SetCapturedFrameCount(uint32 frameCount);
+
+        // Frames are themselves a scope, everything in between nests inside it.
+        void BeginFrame(uint64_t frameNumber);
+        void EndFrame(const OpenGLStateCache::FrameStats& stats);
+
+        void BeginScope(std::string_view name);
+        void EndScope();
+
+        // Frames whose results were read back, oldest first.
+        const std::deque<Frame>& GetFrames() const { return _frames; }
+        const Frame* GetLastFrame() const { return _frames.empty() ? nullptr : &_frames.back(); }
+        void Clear() { _frames.clear(); }
+
+        // Captured frames in the Chrome trace event format, viewable in chrome://tracing or Perfetto.
+        std::string ToChromeTrace() const;
+        bool ExportChromeTrace(const std::filesystem::path& path) const;
+
+    private:
+        static constexpr uint32 FrameLatency = 2;
+
+        struct PendingFrame
+        {
+            Frame Results = {};
+            // Begin and end timestamp query of each scope
+            std::vector<std::array<uint32, 2>> ScopeQueries = {};
+            bool IsRecorded = false;
+        };
+
+        int64_t GetCpuTime() const;
+        uint32 AcquireQuery();
+        void Resolve(PendingFrame& pending);
+
+    private:
+        int64_t _epoch = 0;
+        int64_t _gpuToCpuOffset = 0;
+        bool _isGpuClockSynced = false;
+        bool _isEnabled = false;
+        bool _isRecording = false;
+        uint32 _capturedFrameCount = DefaultCapturedFrameCount;
+
+        std::array<PendingFrame, FrameLatency> _pendingFrames = {};
+        uint32 _pendingFrame = 0;
+        std::vector<uint32> _openScopes = {};
+
+        // Query pool shared by every pending frame, _freeQueries holds those not in use
+        std::vector<uint32> _queries = {};
+        std::vector<uint32> _freeQueries = {};
+
+        std::deque<Frame> _frames = {};
+    };
+
+    // Profiles the enclosing block.
+    class OpenGLProfileScope final
+    {
+    public:
+        OpenGLProfileScope(OpenGLProfiler& profiler, std::string_view name)
+            : _profiler(profiler)
+        {
+            _profiler.BeginScope(name);
+        }
+
+        ~OpenGLProfileScope()
+        {
+            _profiler.EndScope();
+        }
+
+        OpenGLProfileScope(const OpenGLProfileScope&) = delete;
+        OpenGLProfileScope& operator=(const OpenGLProfileScope&) = delete;
+
+    private:
+        OpenGLProfiler& _profiler;
+    };
+}
@@ -0,0 +1,197 @@
+#include "OpenGLProgramCache.h"
+#include "OpenGLHash.h"
+#include "OpenGLShader.h"
+#include <Tbx/Debug/Tracers.h>
+#include <glad/glad.h>
+#include <cstdio>
+#include <fstream>
+#include <string_view>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    /////// Helpers ///////////////////////////////////
+
+    struct ProgramBinaryHeader
+    {
+        static constexpr uint32 CurrentMagic = 0x50584254; // "TBXP"
+        static constexpr uint32 CurrentVersion = 1;
+
+        uint32 Magic = CurrentMagic;
+        uint32 Version = CurrentVersion;
+        uint64_t Key = 0;
+        uint32 BinaryFormat = 0;
+        uint32 BinarySize = 0;
+        uint64_t Checksum = 0;
+    };
+
+    static uint64_t HashString(std::string_view value, uint64_t hash)
+    {
+        // Hash the length too so concatenated strings can't collide
+        const auto length = (uint64_t)value.size();
+        hash = HashBytes(&length, sizeof(length), hash);
+        return HashBytes(value.data(), value.size(), hash);
+    }
+
+    /////// OpenGLProgramCache ///////////////////////////////////
+
+    void OpenGLProgramCache::SetDirectory(const std::filesystem::path& directory)
+    {
+        _directory = directory;
+        if (_directory.empty())
+        {
+            return;
+        }
+
+        std::error_code error;
+        std::filesystem::create_directories(_directory, error);
+        if (error)
+        {
+            TBX_TRACE_WARNING("GL Rendering: Failed to create program cache directory {}, disabling the cache: {}", _directory.string(), error.message());
+            _directory.clear();
+        }
+    }
+
+    void OpenGLProgramCache::SetDriver(const std::string& vendor, const std::string& renderer, const std::string& version)
+    {
+        auto hash = HashString(vendor, HashSeed);
+        hash = HashString(renderer, hash);
+        _driverHash = HashString(version, hash);
+
+        // Some drivers expose the feature but no formats to store programs in
+        GLint formatCount = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+        _isSupported = formatCount > 0;
+    }
+
+    uint64_t OpenGLProgramCache::GetKey(const std::vector<Ref<ShaderResource>>& shaders) const
+    {
+        auto key = _driverHash;
+        for (const auto& shader : shaders)
+        {
+            const auto* glShader = dynamic_cast<const OpenGLShader*>(shader.get());
+            if (!glShader)
+            {
+                return 0;
+            }
+
+            const auto type = (uint32)glShader->GetType();
+            key = HashBytes(&type, sizeof(type), key);
+            key = HashString(glShader->GetSource(), key);
+        }
+        return key;
+    }
+
+    bool OpenGLProgramCache::Load(uint32 program, uint64_t key)
+    {
+        if (!IsEnabled() || key == 0)
+        {
+            return false;
+        }
+
+        const auto path = GetEntryPath(key);
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            _stats.Misses++;
+            return false;
+        }
+
+        const auto reject = [this, &file, &path]()
+        {
+            file.close();
+            std::error_code error;
+            std::filesystem::remove(path, error);
+            _stats.Rejected++;
+            _stats.Misses++;
+            return false;
+        };
+
+        ProgramBinaryHeader header = {};
+        file.read(reinterpret_cast<char*>(&header), sizeof(header));
+        if (!file ||
+            header.Magic != ProgramBinaryHeader::CurrentMagic ||
+            header.Version != ProgramBinaryHeader::CurrentVersion ||
+            header.Key != key ||
+            header.BinarySize == 0)
+        {
+            return reject();
+        }
+
+        std::vector<char> binary(header.BinarySize);
+        file.read(binary.data(), binary.size());
+        if (!file || HashBytes(binary.data(), binary.size()) != header.Checksum)
+        {
+            return reject();
+        }
+
+        // The driver may still refuse binaries, e.g. after an update that kept its version string
+        glProgramBinary(program, header.BinaryFormat, binary.data(), (GLsizei)binary.size());
+        GLint isLinked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &isLinked);
+        if (isLinked == GL_FALSE)
+        {
+            return reject();
+        }
+
+        _stats.Hits++;
+        return true;
+    }
+
+    void OpenGLProgramCache::Store(uint32 program, uint64_t key)
+    {
+        if (!IsEnabled() || key == 0)
+        {
+            return;
+        }
+
+        GLint binarySize = 0;
+        glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+        if (binarySize <= 0)
+        {
+            return;
+        }
+
+        std::vector<char> binary(binarySize);
+        GLenum binaryFormat = GL_NONE;
+        GLsizei writtenSize = 0;
+        glGetProgramBinary(program, binarySize, &writtenSize, &binaryFormat, binary.data());
+        binary.resize(writtenSize);
+
+        ProgramBinaryHeader header = {};
+        header.Key = key;
+        header.BinaryFormat = binaryFormat;
+        header.BinarySize = (uint32)binary.size();
+        header.Checksum = HashBytes(binary.data(), binary.size());
+
+        // Write to a temp file first so a crash mid write can't leave a half written entry behind
+        const auto path = GetEntryPath(key);
+        auto tempPath = path;
+        tempPath += ".tmp";
+        {
+            std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(binary.data(), binary.size());
+            if (!file)
+            {
+                TBX_TRACE_WARNING("GL Rendering: Failed to write program cache entry {}", tempPath.string());
+                return;
+            }
+        }
+
+        std::error_code error;
+        std::filesystem::rename(tempPath, path, error);
+        if (error)
+        {
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+        _stats.Stores++;
+    }
+
+    std::filesystem::path OpenGLProgramCache::GetEntryPath(uint64_t key) const
+    {
+        char fileName[32] = {};
+        std::snprintf(fileName, sizeof(fileName), "%016llx.glprogram", (unsigned long long)key);
+        return _directory / fileName;
+    }
+}
@@ -0,0 +1,51 @@
+#pragma once
+#include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Math/Int.h>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Persists linked program binaries on disk so programs seen before skip compiling and linking.
+    // Entries are keyed by the sources of every attached shader plus the driver that produced them,
+    // anything corrupt or rejected by the driver is dropped and the program is built from source.
+    class OpenGLProgramCache final
+    {
+    public:
+        struct Stats
+        {
+            uint32 Hits = 0;
+            uint32 Misses = 0;
+            // Entries that existed but were corrupt or that the driver refused to load
+            uint32 Rejected = 0;
+            uint32 Stores = 0;
+        };
+
+        // An empty directory disables the cache.
+        void SetDirectory(const std::filesystem::path& directory);
+        const std::filesystem::path& GetDirectory() const { return _directory; }
+        bool IsEnabled() const { return !_directory.empty() && _isSupported; }
+
+        // Identifies the driver, binaries from other drivers or driver versions are never loaded.
+        void SetDriver(const std::string& vendor, const std::string& renderer, const std::string& version);
+
+        uint64_t GetKey(const std::vector<Ref<ShaderResource>>& shaders) const;
+
+        // Tries to load the program from the cache, returns false if it has to be built from source.
+        bool Load(uint32 program, uint64_t key);
+        // Stores a successfully linked program, it must have been linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT.
+        void Store(uint32 program, uint64_t key);
+
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        std::filesystem::path GetEntryPath(uint64_t key) const;
+
+    private:
+        std::filesystem::path _directory = {};
+        uint64_t _driverHash = 0;
+        bool _isSupported = false;
+        Stats _stats = {};
+    };
+}
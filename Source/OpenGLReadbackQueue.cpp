@@ -0,0 +1,129 @@
+#include "OpenGLReadbackQueue.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLReadbackQueue::OpenGLReadbackQueue(OpenGLStateCache& state)
+        : _state(state)
+    {
+    }
+
+    OpenGLReadbackQueue::~OpenGLReadbackQueue()
+    {
+        // Nobody is left to hand the images to
+        for (auto& readback : _pending)
+        {
+            glDeleteSync(static_cast<GLsync>(readback.Fence));
+            _freeBuffers.push_back(readback.Buffer);
+        }
+        _pending.clear();
+
+        for (const auto& buffer : _freeBuffers)
+        {
+            _state.GetMemoryTracker().Untrack(GpuMemoryType::ReadbackBuffer, buffer.GLId);
+            _state.OnBufferDeleted(buffer.GLId);
+            _state.GetNamePool().ReleaseBuffer(buffer.GLId);
+        }
+    }
+
+    void OpenGLReadbackQueue::Request(const OpenGLRenderTarget& target, ReadbackCallback callback)
+    {
+        Readback readback = {};
+        readback.Width = target.GetWidth();
+        readback.Height = target.GetHeight();
+        readback.Callback = std::move(callback);
+        const auto sizeInBytes = readback.Width * readback.Height * 4;
+        readback.Buffer = AcquireBuffer(sizeInBytes);
+
+        // With a pack buffer bound the pointer is an offset into it, so this only queues the copy
+        _state.BindBuffer(GL_PIXEL_PACK_BUFFER, readback.Buffer.GLId);
+        glGetTextureSubImage((uint32)target.RenderId, 0, 0, 0, 0, readback.Width, readback.Height, 1, GL_RGBA, GL_UNSIGNED_BYTE, sizeInBytes, nullptr);
+        _state.BindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        readback.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        _pending.push_back(std::move(readback));
+    }
+
+    void OpenGLReadbackQueue::Poll()
+    {
+        // Fences signal in order, so stop at the first one that hasn't
+        while (!_pending.empty())
+        {
+            auto& readback = _pending.front();
+            const auto result = glClientWaitSync(static_cast<GLsync>(readback.Fence), GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+            if (result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED)
+            {
+                break;
+            }
+            Finish(readback);
+        }
+    }
+
+    void OpenGLReadbackQueue::Flush()
+    {
+        while (!_pending.empty())
+        {
+            auto& readback = _pending.front();
+            const auto result = glClientWaitSync(static_cast<GLsync>(readback.Fence), GL_SYNC_FLUSH_COMMANDS_BIT, ~0ull);
+            TBX_ASSERT(result != GL_WAIT_FAILED, "GL Rendering: Failed waiting on readback fence!");
+            Finish(readback);
+        }
+    }
+
+    OpenGLReadbackQueue::PackBuffer OpenGLReadbackQueue::AcquireBuffer(uint32 sizeInBytes)
+    {
+        // Smallest free buffer that fits
+        auto best = _freeBuffers.end();
+        for (auto it = _freeBuffers.begin(); it != _freeBuffers.end(); ++it)
+        {
+            if (it->Size >= sizeInBytes && (best == _freeBuffers.end() || it->Size < best->Size))
+            {
+                best = it;
+            }
+        }
+
+        if (best != _freeBuffers.end())
+        {
+            const auto buffer = *best;
+            _freeBuffers.erase(best);
+            return buffer;
+        }
+
+        PackBuffer buffer = {};
+        buffer.GLId = _state.GetNamePool().AcquireBuffer();
+        buffer.Size = sizeInBytes;
+        glNamedBufferData(buffer.GLId, sizeInBytes, nullptr, GL_STREAM_READ);
+        _state.GetMemoryTracker().Track(GpuMemoryType::ReadbackBuffer, buffer.GLId, sizeInBytes);
+        return buffer;
+    }
+
+    void OpenGLReadbackQueue::Finish(Readback& readback)
+    {
+        ReadbackImage image = {};
+        image.Width = readback.Width;
+        image.Height = readback.Height;
+        image.Pixels.resize((size_t)readback.Width * readback.Height * 4);
+
+        const auto* data = glMapNamedBufferRange(readback.Buffer.GLId, 0, (GLsizeiptr)image.Pixels.size(), GL_MAP_READ_BIT);
+        TBX_ASSERT(data, "GL Rendering: Failed to map readback buffer!");
+        if (data)
+        {
+            std::memcpy(image.Pixels.data(), data, image.Pixels.size());
+            glUnmapNamedBuffer(readback.Buffer.GLId);
+        }
+
+        glDeleteSync(static_cast<GLsync>(readback.Fence));
+        _freeBuffers.push_back(readback.Buffer);
+        auto callback = std::move(readback.Callback);
+        _pending.pop_front();
+
+        // Last, the callback may well request another readback
+        if (callback)
+        {
+            callback(image);
+        }
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+#include "OpenGLRenderTarget.h"
+#include "OpenGLStateCache.h"
+#include <Tbx/Math/Int.h>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Tightly packed RGBA8 pixels, rows bottom to top as GL stores them.
+    struct ReadbackImage
+    {
+        uint32 Width = 0;
+        uint32 Height = 0;
+        std::vector<uint8_t> Pixels = {};
+    };
+
+    using ReadbackCallback = std::function<void(const ReadbackImage& image)>;
+
+    // Reads render targets back without stalling: pixels are copied into a pixel pack buffer on the GPU,
+    // and only mapped once the fence placed after the copy has signalled, some frames later.
+    class OpenGLReadbackQueue final
+    {
+    public:
+        OpenGLReadbackQueue(OpenGLStateCache& state);
+        ~OpenGLReadbackQueue();
+
+        OpenGLReadbackQueue(const OpenGLReadbackQueue&) = delete;
+        OpenGLReadbackQueue& operator=(const OpenGLReadbackQueue&) = delete;
+
+        // Queues a copy of the target's colour as it is once everything submitted so far has run.
+        void Request(const OpenGLRenderTarget& target, ReadbackCallback callback);
+
+        // Hands every finished readback to its callback, in request order, without waiting.
+        void Poll();
+        // Waits for every queued readback and hands them to their callbacks.
+        void Flush();
+
+        uint32 GetPendingCount() const { return (uint32)_pending.size(); }
+
+    private:
+        struct PackBuffer
+        {
+            uint32 GLId = 0;
+            uint32 Size = 0;
+        };
+
+        struct Readback
+        {
+            PackBuffer Buffer = {};
+            // GLsync, kept opaque so this header doesn't need glad
+            void* Fence = nullptr;
+            uint32 Width = 0;
+            uint32 Height = 0;
+            ReadbackCallback Callback = nullptr;
+        };
+
+        PackBuffer AcquireBuffer(uint32 sizeInBytes);
+        void Finish(Readback& readback);
+
+    private:
+        OpenGLStateCache& _state;
+        std::deque<Readback> _pending = {};
+        // Buffers of finished readbacks, reused by later ones that fit
+        std::vector<PackBuffer> _freeBuffers = {};
+    };
+}
@@ -0,0 +1,373 @@
+#include "OpenGLRenderQueue.h"
+#include "OpenGLHash.h"
+#include <Tbx/Debug/Asserts.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static uint64_t ClampBits(uint32 value, uint32 bits)
+    {
+        const auto max = (1u << bits) - 1;
+        return std::min(value, max);
+    }
+
+    static bool HasSameState(const RenderSubmission& a, const RenderSubmission& b)
+    {
+        return a.Program == b.Program && a.Mesh == b.Mesh && a.Textures == b.Textures && a.IsTranslucent == b.IsTranslucent;
+    }
+
+    uint64_t RenderSortKey::Make(uint32 layer, bool isTranslucent, uint32 program, uint32 textureSet, uint32 mesh, float depth)
+    {
+        const auto quantizedDepth = (uint64_t)QuantizeDepth(depth);
+        const auto state = (ClampBits(program, ProgramBits) << (TextureSetBits + MeshBits))
+            | (ClampBits(textureSet, TextureSetBits) << MeshBits)
+            | ClampBits(mesh, MeshBits);
+
+        uint64_t key = ClampBits(layer, LayerBits) << 60;
+        if (isTranslucent)
+        {
+            // Back to front matters more than state changes for blending to come out right
+            const auto invertedDepth = ((1ull << DepthBits) - 1) - quantizedDepth;
+            key |= 1ull << 59;
+            key |= invertedDepth << 39;
+            key |= state << 1;
+        }
+        else
+        {
+            // Front to back only helps early depth rejection, so it comes last
+            key |= state << 21;
+            key |= quantizedDepth << 1;
+        }
+        return key;
+    }
+
+    uint32 RenderSortKey::QuantizeDepth(float depth)
+    {
+        // Behind the camera or NaN
+        if (!(depth > 0.0f))
+        {
+            return 0;
+        }
+
+        uint32 bits = 0;
+        std::memcpy(&bits, &depth, sizeof(bits));
+        return bits >> (31 - DepthBits);
+    }
+
+    void RadixSort(std::vector<RenderSortItem>& items, std::vector<RenderSortItem>& scratch)
+    {
+        constexpr uint32 passCount = sizeof(uint64_t);
+        if (items.size() < 2)
+        {
+            return;
+        }
+
+        // Every pass's histogram in one read of the keys
+        uint32 histograms[passCount][256] = {};
+        for (const auto& item : items)
+        {
+            for (uint32 pass = 0; pass < passCount; pass++)
+            {
+                histograms[pass][(item.Key >> (pass * 8)) & 0xFF]++;
+            }
+        }
+
+        scratch.resize(items.size());
+        auto* source = &items;
+        auto* destination = &scratch;
+        for (uint32 pass = 0; pass < passCount; pass++)
+        {
+            auto& histogram = histograms[pass];
+            const auto firstByte = (source->front().Key >> (pass * 8)) & 0xFF;
+            if (histogram[firstByte] == (uint32)items.size())
+            {
+                continue;
+            }
+
+            uint32 offsets[256] = {};
+            uint32 offset = 0;
+            for (uint32 bucket = 0; bucket < 256; bucket++)
+            {
+                offsets[bucket] = offset;
+                offset += histogram[bucket];
+            }
+            for (const auto& item : *source)
+            {
+                (*destination)[offsets[(item.Key >> (pass * 8)) & 0xFF]++] = item;
+            }
+            std::swap(source, destination);
+        }
+
+        if (source != &items)
+        {
+            items.swap(scratch);
+        }
+    }
+
+    OpenGLRenderQueue::OpenGLRenderQueue(OpenGLStateCache& state, OpenGLUniformRing& uniforms)
+        : _state(state)
+        , _uniforms(uniforms)
+    {
+    }
+
+    void OpenGLRenderQueue::Submit(const RenderSubmission& submission)
+    {
+        TBX_ASSERT(submission.Program, "GL Rendering: Submissions need a program!");
+        TBX_ASSERT(submission.Mesh, "GL Rendering: Submissions need a mesh!");
+        TBX_ASSERT(submission.Layer <= RenderSortKey::MaxLayer, "GL Rendering: Submission layer {} is past the last one!", submission.Layer);
+        _submissions.push_back(submission);
+    }
+
+    void OpenGLRenderQueue::Flush()
+    {
+        // Stats add up over a frame's flushes
+        const auto frame = _state.GetFrameNumber();
+        if (frame != _statsFrame)
+        {
+            _stats = {};
+            _statsFrame = frame;
+        }
+        _stats.Submissions += (uint32)_submissions.size();
+        if (_submissions.empty())
+        {
+            return;
+        }
+
+        _items.clear();
+        for (uint32 i = 0; i < (uint32)_submissions.size(); i++)
+        {
+            const auto& submission = _submissions[i];
+            // Still building in the background, it can't be drawn yet
+            if (!submission.Program->IsReady())
+            {
+                continue;
+            }
+
+            auto [entry, isNew] = _meshes.try_emplace(submission.Mesh);
+            if (isNew)
+            {
+                entry->second = { (uint32)_meshes.size() - 1, GetMeshBounds(*submission.Mesh) };
+            }
+            const auto program = _programIds.try_emplace(submission.Program, (uint32)_programIds.size()).first->second;
+            const auto textureSet = GetTextureSetId(submission.Textures);
+            _items.push_back({ RenderSortKey::Make(submission.Layer, submission.IsTranslucent, program, textureSet, entry->second.Id, submission.Depth), i });
+        }
+        if (_isCulling)
+        {
+            Cull();
+        }
+        RadixSort(_items, _scratch);
+
+        PrepareRuns();
+        DrawRuns();
+
+        _submissions.clear();
+        _programIds.clear();
+        _meshes.clear();
+        _textureSetIds.clear();
+        _bound = nullptr;
+    }
+
+    void OpenGLRenderQueue::SetCullingFrustum(const OpenGLFrustum& frustum)
+    {
+        _frustum = frustum;
+        _isCulling = true;
+    }
+
+    void OpenGLRenderQueue::Cull()
+    {
+        // Every submission's sphere first, so the frustum test runs over them a register at a time
+        _spheres.Clear();
+        for (const auto& item : _items)
+        {
+            const auto& submission = _submissions[item.Index];
+            const auto* bounds = _meshes.at(submission.Mesh).Bounds;
+            if (bounds)
+            {
+                _spheres.Add(*bounds, submission.Instance.Transform);
+            }
+            else
+            {
+                _spheres.AddUnbounded();
+            }
+        }
+
+        _visible.resize(_items.size());
+        CullSpheres(_frustum, _spheres, _visible.data());
+
+        uint32 visibleCount = 0;
+        for (uint32 i = 0; i < (uint32)_items.size(); i++)
+        {
+            if (_visible[i])
+            {
+                _items[visibleCount++] = _items[i];
+            }
+        }
+        _stats.Culled += (uint32)_items.size() - visibleCount;
+        _items.resize(visibleCount);
+    }
+
+    uint32 OpenGLRenderQueue::GetTextureSetId(const std::array<TextureResource*, MaxSubmissionTextures>& textures)
+    {
+        auto hash = HashSeed;
+        for (const auto* texture : textures)
+        {
+            hash = HashCombine(hash, (uint64_t)(uintptr_t)texture);
+        }
+        return _textureSetIds.try_emplace(hash, (uint32)_textureSetIds.size()).first->second;
+    }
+
+    void OpenGLRenderQueue::PrepareRuns()
+    {
+        _runs.clear();
+        _instances.clear();
+        for (uint32 i = 0; i < (uint32)_items.size(); i++)
+        {
+            const auto& submission = _submissions[_items[i].Index];
+            if (!_runs.empty() && HasSameState(_submissions[_items[_runs.back().First].Index], submission))
+            {
+                _runs.back().Count++;
+            }
+            else
+            {
+                _runs.push_back({ i, 1, 0 });
+            }
+        }
+
+        // Every instance in sorted order, so each run's are contiguous, in one upload for the whole flush
+        for (auto& run : _runs)
+        {
+            run.BaseInstance = (uint32)_instances.size();
+            for (uint32 i = run.First; i < run.First + run.Count; i++)
+            {
+                _instances.push_back(_submissions[_items[i].Index].Instance);
+            }
+        }
+
+        // Matches a std430 struct of a mat4 and a vec4
+        static_assert(sizeof(MeshInstance) == 80, "MeshInstance must match its storage block layout!");
+        if (_instances.empty())
+        {
+            return;
+        }
+        _uniforms.BindStorageBlock(OpenGLUniformRing::DrawStorageBinding, _instances.data(), (uint32)(_instances.size() * sizeof(MeshInstance)));
+    }
+
+    void OpenGLRenderQueue::DrawRuns()
+    {
+        bool isTranslucent = false;
+        for (uint32 runIndex = 0; runIndex < (uint32)_runs.size();)
+        {
+            const auto& run = _runs[runIndex];
+            const auto& submission = _submissions[_items[run.First].Index];
+            if (submission.IsTranslucent != isTranslucent)
+            {
+                isTranslucent = submission.IsTranslucent;
+                _state.SetDepthMask(!isTranslucent);
+            }
+
+            if (dynamic_cast<OpenGLArenaMesh*>(submission.Mesh))
+            {
+                // Following runs in the same arena block with the same program and textures join the multi draw
+                const auto& arenaMesh = static_cast<const OpenGLArenaMesh&>(*submission.Mesh);
+                uint32 runCount = 1;
+                while (runIndex + runCount < (uint32)_runs.size())
+                {
+                    const auto& next = _submissions[_items[_runs[runIndex + runCount].First].Index];
+                    const auto* nextMesh = dynamic_cast<const OpenGLArenaMesh*>(next.Mesh);
+                    if (!nextMesh || &nextMesh->GetArena() != &arenaMesh.GetArena() || nextMesh->GetAllocation().Block != arenaMesh.GetAllocation().Block
+                        || next.Program != submission.Program || next.Textures != submission.Textures || next.IsTranslucent != submission.IsTranslucent)
+                    {
+                        break;
+                    }
+                    runCount++;
+                }
+                DrawArenaRuns(runIndex, runCount);
+                runIndex += runCount;
+                continue;
+            }
+
+            if (!BindState(submission))
+            {
+                runIndex++;
+                continue;
+            }
+            if (DrawMeshInstances(*submission.Mesh, run.Count, run.BaseInstance))
+            {
+                _stats.Draws++;
+            }
+            else
+            {
+                TBX_ASSERT(false, "GL Rendering: Submitted a mesh the plugin didn't create!");
+            }
+            runIndex++;
+        }
+
+        if (_bound)
+        {
+            _bound->Mesh->Release();
+        }
+        if (isTranslucent)
+        {
+            _state.SetDepthMask(true);
+        }
+    }
+
+    void OpenGLRenderQueue::DrawArenaRuns(uint32 firstRun, uint32 runCount)
+    {
+        const auto& first = _submissions[_items[_runs[firstRun].First].Index];
+        if (!BindState(first))
+        {
+            return;
+        }
+
+        _arenaCommands.clear();
+        for (uint32 runIndex = firstRun; runIndex < firstRun + runCount; runIndex++)
+        {
+            const auto& run = _runs[runIndex];
+            const auto& mesh = static_cast<const OpenGLArenaMesh&>(*_submissions[_items[run.First].Index].Mesh);
+            auto command = mesh.GetDrawCommand(run.BaseInstance);
+            command.InstanceCount = run.Count;
+            _arenaCommands.push_back(command);
+        }
+
+        const auto& arenaMesh = static_cast<OpenGLArenaMesh&>(*first.Mesh);
+        arenaMesh.GetArena().DrawBlock(arenaMesh.GetAllocation().Block, _arenaCommands);
+        _stats.Draws++;
+    }
+
+    bool OpenGLRenderQueue::BindState(const RenderSubmission& submission)
+    {
+        if (!_bound || _bound->Program != submission.Program)
+        {
+            _isProgramReady = submission.Program->TryActivate();
+            _stats.ProgramChanges++;
+        }
+
+        if (!_bound || _bound->Textures != submission.Textures)
+        {
+            for (uint32 slot = 0; slot < MaxSubmissionTextures && submission.Textures[slot]; slot++)
+            {
+                if (!_bound || _bound->Textures[slot] != submission.Textures[slot])
+                {
+                    submission.Textures[slot]->SetSlot(slot);
+                    submission.Textures[slot]->Activate();
+                }
+            }
+            _stats.TextureSetChanges++;
+        }
+
+        if (!_bound || _bound->Mesh != submission.Mesh)
+        {
+            if (_bound)
+            {
+                _bound->Mesh->Release();
+            }
+            submission.Mesh->Activate();
+            _stats.MeshChanges++;
+        }
+        _bound = &submission;
+        return _isProgramReady;
+    }
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include "OpenGLCulling.h"
+#include "OpenGLMesh.h"
+#include "OpenGLShader.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLUniformRing.h"
+#include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Math/Int.h>
+#include <array>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Up to this many textures per submission, bound to the slots matching their index
+    static constexpr uint32 MaxSubmissionTextures = 4;
+
+    struct RenderSubmission
+    {
+        OpenGLShaderProgram* Program = nullptr;
+        // Unused slots are null, a set ends at the first one
+        std::array<TextureResource*, MaxSubmissionTextures> Textures = {};
+        MeshResource* Mesh = nullptr;
+        // Read from the draw storage block, see OpenGLRenderQueue
+        MeshInstance Instance = {};
+        // View space distance from the camera, opaque submissions draw front to back, translucent ones back to front
+        float Depth = 0.0f;
+        // Layers draw in ascending order, 0 to MaxLayer
+        uint8_t Layer = 0;
+        // Translucent submissions draw after the opaque ones of their layer, without writing depth
+        bool IsTranslucent = false;
+    };
+
+    // Bits of the 64 bit sort key, from the most significant down.
+    // Opaque:      layer | 0 | program | texture set | mesh | depth
+    // Translucent: layer | 1 | inverted depth | program | texture set | mesh
+    struct RenderSortKey
+    {
+        static constexpr uint32 LayerBits = 4;
+        static constexpr uint32 ProgramBits = 12;
+        static constexpr uint32 TextureSetBits = 12;
+        static constexpr uint32 MeshBits = 14;
+        static constexpr uint32 DepthBits = 20;
+
+        static constexpr uint32 MaxLayer = (1u << LayerBits) - 1;
+
+        // Ids past what their bits hold share the last value, which only costs sorting precision, never correctness
+        static uint64_t Make(uint32 layer, bool isTranslucent, uint32 program, uint32 textureSet, uint32 mesh, float depth);
+        // Keeps the order of non negative floats in the top bits of their representation
+        static uint32 QuantizeDepth(float depth);
+    };
+
+    // Stable LSD radix sort of keys with the index of what they sort, a byte per pass.
+    // Passes where every key has the same byte are skipped, scratch is resized to match.
+    struct RenderSortItem
+    {
+        uint64_t Key = 0;
+        uint32 Index = 0;
+    };
+    void RadixSort(std::vector<RenderSortItem>& items, std::vector<RenderSortItem>& scratch);
+
+    // Collects the frame's submissions and draws them sorted to minimise program, texture and mesh switches.
+    // With a culling frustum set, submissions whose mesh bounds are outside it are dropped before sorting, all at once.
+    // Consecutive submissions sharing program, textures and mesh become one instanced draw, and arena meshes of a block one multi draw.
+    // Every draw finds its instances in the draw storage block at gl_BaseInstance + gl_InstanceID, see OpenGLUniformRing::DrawStorageBinding.
+    // Submissions are made and flushed on the render thread, and must stay alive until the flush.
+    class OpenGLRenderQueue final
+    {
+    public:
+        struct Stats
+        {
+            uint32 Submissions = 0;
+            // Outside the culling frustum
+            uint32 Culled = 0;
+            // Draw calls issued, a multi draw counts once
+            uint32 Draws = 0;
+            uint32 ProgramChanges = 0;
+            uint32 TextureSetChanges = 0;
+            uint32 MeshChanges = 0;
+        };
+
+        OpenGLRenderQueue(OpenGLStateCache& state, OpenGLUniformRing& uniforms);
+
+        OpenGLRenderQueue(const OpenGLRenderQueue&) = delete;
+        OpenGLRenderQueue& operator=(const OpenGLRenderQueue&) = delete;
+
+        void Submit(const RenderSubmission& submission);
+        uint32 GetSubmissionCount() const { return (uint32)_submissions.size(); }
+
+        // Stays set until changed or disabled
+        void SetCullingFrustum(const OpenGLFrustum& frustum);
+        void DisableCulling() { _isCulling = false; }
+        bool IsCulling() const { return _isCulling; }
+
+        // Sorts and draws everything submitted, then empties the queue
+        void Flush();
+        // Of every flush in the current frame, the plugin flushes at the end of each one
+        const Stats& GetStats() const { return _stats; }
+
+    private:
+        struct Run
+        {
+            // Into the sorted items
+            uint32 First = 0;
+            uint32 Count = 0;
+            // Where the run's instances start in the draw storage block
+            uint32 BaseInstance = 0;
+        };
+
+        struct MeshEntry
+        {
+            uint32 Id = 0;
+            // Null for meshes we can't bound, which are never culled
+            const MeshBounds* Bounds = nullptr;
+        };
+
+        void Cull();
+        uint32 GetTextureSetId(const std::array<TextureResource*, MaxSubmissionTextures>& textures);
+        void PrepareRuns();
+        void DrawRuns();
+        void DrawArenaRuns(uint32 firstRun, uint32 runCount);
+        // Returns false while the submission's program is still building or failed to, its draws are skipped
+        bool BindState(const RenderSubmission& submission);
+
+    private:
+        OpenGLStateCache& _state;
+        OpenGLUniformRing& _uniforms;
+        Stats _stats = {};
+        uint64_t _statsFrame = ~0ull;
+
+        std::vector<RenderSubmission> _submissions = {};
+        std::vector<RenderSortItem> _items = {};
+        std::vector<RenderSortItem> _scratch = {};
+        std::vector<Run> _runs = {};
+
+        // Dense per frame ids in order of first submission, so the key's few bits go far
+        std::unordered_map<const void*, uint32> _programIds = {};
+        std::unordered_map<const void*, MeshEntry> _meshes = {};
+        std::unordered_map<uint64_t, uint32> _textureSetIds = {};
+
+        // Kept between frames so their capacity is reused
+        std::vector<MeshInstance> _instances = {};
+        std::vector<DrawElementsIndirectCommand> _arenaCommands = {};
+
+        OpenGLFrustum _frustum = {};
+        bool _isCulling = false;
+        BoundingSpheres _spheres = {};
+        std::vector<uint8_t> _visible = {};
+
+        const RenderSubmission* _bound = nullptr;
+        bool _isProgramReady = false;
+    };
+}
@@ -0,0 +1,99 @@
+#include "OpenGLRenderTarget.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static constexpr GLenum DepthFormat = GL_DEPTH24_STENCIL8;
+
+    OpenGLRenderTarget::OpenGLRenderTarget(uint32 width, uint32 height, OpenGLStateCache& state, bool hasDepth, uint32 colorFormat, bool isDepthSampled)
+        : _state(state)
+        , _width(width)
+        , _height(height)
+        , _colorFormat(colorFormat)
+        , _isDepthSampled(hasDepth && isDepthSampled)
+    {
+        TBX_ASSERT(width > 0 && height > 0, "GL Rendering: Render targets can't be empty!");
+
+        const auto colorGLId = _state.GetNamePool().AcquireTexture(GL_TEXTURE_2D);
+        RenderId = colorGLId;
+        glTextureParameteri(colorGLId, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(colorGLId, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(colorGLId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(colorGLId, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureStorage2D(colorGLId, 1, colorFormat, width, height);
+
+        glCreateFramebuffers(1, &_framebufferGLId);
+        glNamedFramebufferTexture(_framebufferGLId, GL_COLOR_ATTACHMENT0, colorGLId, 0);
+        auto sizeInBytes = OpenGLMemoryTracker::GetTextureSize(colorFormat, width, height, 1);
+
+        // Unless depth is sampled, a renderbuffer lets the driver pick whatever layout suits it
+        if (_isDepthSampled)
+        {
+            glCreateTextures(GL_TEXTURE_2D, 1, &_depthGLId);
+            glTextureParameteri(_depthGLId, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTextureParameteri(_depthGLId, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTextureParameteri(_depthGLId, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTextureParameteri(_depthGLId, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glTextureStorage2D(_depthGLId, 1, DepthFormat, width, height);
+            glNamedFramebufferTexture(_framebufferGLId, GL_DEPTH_STENCIL_ATTACHMENT, _depthGLId, 0);
+            sizeInBytes += OpenGLMemoryTracker::GetTextureSize(DepthFormat, width, height, 1);
+        }
+        else if (hasDepth)
+        {
+            glCreateRenderbuffers(1, &_depthGLId);
+            glNamedRenderbufferStorage(_depthGLId, DepthFormat, width, height);
+            glNamedFramebufferRenderbuffer(_framebufferGLId, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, _depthGLId);
+            sizeInBytes += OpenGLMemoryTracker::GetTextureSize(DepthFormat, width, height, 1);
+        }
+
+        const auto status = glCheckNamedFramebufferStatus(_framebufferGLId, GL_FRAMEBUFFER);
+        TBX_ASSERT(status == GL_FRAMEBUFFER_COMPLETE, "GL Rendering: Render target framebuffer is incomplete!");
+
+        // Tracked as one allocation under the framebuffer, renderbuffer and texture names may overlap
+        _state.GetMemoryTracker().Track(GpuMemoryType::RenderTarget, _framebufferGLId, sizeInBytes);
+    }
+
+    OpenGLRenderTarget::~OpenGLRenderTarget()
+    {
+        _state.GetMemoryTracker().Untrack(GpuMemoryType::RenderTarget, _framebufferGLId);
+        _state.OnFramebufferDeleted(_framebufferGLId);
+        glDeleteFramebuffers(1, &_framebufferGLId);
+        if (_isDepthSampled)
+        {
+            _state.OnTextureDeleted(_depthGLId);
+            glDeleteTextures(1, &_depthGLId);
+        }
+        else if (_depthGLId != 0)
+        {
+            glDeleteRenderbuffers(1, &_depthGLId);
+        }
+
+        const auto colorGLId = (uint32)RenderId;
+        _state.OnTextureDeleted(colorGLId);
+        _state.GetNamePool().ReleaseTexture(colorGLId);
+    }
+
+    void OpenGLRenderTarget::SetSlot(uint32 slot)
+    {
+        _slot = slot;
+    }
+
+    void OpenGLRenderTarget::Activate()
+    {
+        _state.BindTextureUnit(_slot, (uint32)RenderId);
+    }
+
+    void OpenGLRenderTarget::Release()
+    {
+        if (_state.IsStrictMode())
+        {
+            _state.BindTextureUnit(_slot, 0);
+        }
+    }
+
+    void OpenGLRenderTarget::Bind()
+    {
+        _state.BindFramebuffer(_framebufferGLId);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include "OpenGLStateCache.h"
+#include <Tbx/Graphics/GraphicsResources.h>
+#include <Tbx/Math/Int.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Offscreen framebuffer with a colour texture and an optional depth-stencil attachment.
+    // Draw into it by making it the plugin's render target, sample it like any other texture afterwards:
+    // RenderId is the colour texture, Activate binds it to its slot.
+    // Depth is a renderbuffer unless it's sampled, e.g. to build a Hi-Z pyramid from.
+    class OpenGLRenderTarget final : public TextureResource
+    {
+    public:
+        static constexpr uint32 DefaultColorFormat = 0x8058; // GL_RGBA8
+
+        OpenGLRenderTarget(uint32 width, uint32 height, OpenGLStateCache& state, bool hasDepth = true, uint32 colorFormat = DefaultColorFormat, bool isDepthSampled = false);
+        ~OpenGLRenderTarget() override;
+
+        void SetSlot(uint32 slot) override;
+
+        void Activate() override;
+        void Release() override;
+
+        // Binds the framebuffer for drawing and reading.
+        void Bind();
+
+        uint32 GetWidth() const { return _width; }
+        uint32 GetHeight() const { return _height; }
+        uint32 GetColorFormat() const { return _colorFormat; }
+        bool HasDepth() const { return _depthGLId != 0; }
+        // Zero unless the depth is sampled
+        uint32 GetDepthTextureGLId() const { return _isDepthSampled ? _depthGLId : 0; }
+        uint32 GetFramebufferGLId() const { return _framebufferGLId; }
+
+    private:
+        OpenGLStateCache& _state;
+        uint32 _width = 0;
+        uint32 _height = 0;
+        uint32 _colorFormat = 0;
+        uint32 _framebufferGLId = 0;
+        uint32 _depthGLId = 0;
+        uint32 _slot = 0;
+        bool _isDepthSampled = false;
+    };
+}
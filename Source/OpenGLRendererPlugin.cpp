@@ -1,9 +1,11 @@
 #include "OpenGLRenderingPlugin.h"
+#include "OpenGLCallTracer.h"
 #include "OpenGLShader.h"
 #include "OpenGLMesh.h"
 #include "OpenGLTexture.h"
 #include <Tbx/Debug/Tracers.h>
 #include <glad/glad.h>
+#include <algorithm>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
@@ -36,8 +38,7 @@ namespace Tbx::Plugins::OpenGLRendering
 
     void OpenGLRenderingPlugin::EnableDepthTesting(bool enabled)
     {
-        if (enabled) glDepthMask(GL_TRUE);
-        else glDepthMask(GL_FALSE);
+        _state.SetDepthMask(enabled);
     }
 
     void OpenGLRenderingPlugin::SetContext(Ref<IGraphicsContext> context)
@@ -50,8 +51,29 @@ namespace Tbx::Plugins::OpenGLRendering
 
     void OpenGLRenderingPlugin::BeginDraw(const RgbaColor& clearColor, const Viewport& viewport)
     {
-        glEnable(GL_DEPTH_TEST);
-        glDepthMask(GL_TRUE);
+        // Before the profiler opens its frame, so its CPU time doesn't include waiting on the GPU
+        _state.GetFramePacer().BeginFrame(_state.GetFrameNumber());
+        _profiler.BeginFrame(_state.GetFrameNumber());
+
+        PollPendingPrograms();
+        _readbacks.Poll();
+        _uniforms.BeginFrame();
+        {
+            OpenGLProfileScope scope(_profiler, "Texture Uploads");
+            _textureUploader.Update();
+        }
+
+        if (_renderTarget)
+        {
+            _renderTarget->Bind();
+        }
+        else
+        {
+            _state.BindFramebuffer(0);
+        }
+
+        _state.SetEnabled(GL_DEPTH_TEST, true);
+        _state.SetDepthMask(true);
         glClearDepth(1.0);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glClearColor(clearColor.R, clearColor.G, clearColor.B, clearColor.A);
@@ -60,27 +82,232 @@ namespace Tbx::Plugins::OpenGLRendering
 
     void OpenGLRenderingPlugin::EndDraw()
     {
-        glFlush();
+        FlushRenderQueue();
+        ExecuteCommandBuffers();
+        _profiler.EndFrame(_state.GetCurrentFrameStats());
+        _state.GetFramePacer().EndFrame();
+        _state.EndFrame();
+        _deletionQueue.EndFrame(_state.GetFrameNumber(), _state.GetFramePacer().GetCompletedFrameCount());
+
+        // Last, so the frame's GL call counts include everything above
+        auto& tracer = OpenGLCallTracer::Get();
+        if (tracer.IsInstalled())
+        {
+            tracer.EndFrame();
+        }
     }
 
     Ref<TextureResource> OpenGLRenderingPlugin::UploadTexture(const Texture& texture)
     {
-        return Ref<TextureResource>(new OpenGLTexture(texture), [this](TextureResource* resource) { DeleteResource(resource); });
+        if (_useTextureArrays)
+        {
+            auto& pool = GetOrCreateTextureArrayPool(OpenGLArrayTexture::GetArrayFormat(texture));
+            return Ref<TextureResource>(new OpenGLArrayTexture(texture, pool, _state, _textureUploader), [this](TextureResource* resource) { DeleteResource(resource); });
+        }
+        return Ref<TextureResource>(new OpenGLTexture(texture, _state, _textureUploader), [this](TextureResource* resource) { DeleteResource(resource); });
+    }
+
+    Ref<TextureResource> OpenGLRenderingPlugin::UploadCompressedTexture(const CompressedTexture& texture, TextureFilter filter, TextureWrap wrap)
+    {
+        return Ref<TextureResource>(new OpenGLTexture(texture, filter, wrap, _state, _textureUploader), [this](TextureResource* resource) { DeleteResource(resource); });
     }
 
     Ref<MeshResource> OpenGLRenderingPlugin::UploadMesh(const Mesh& mesh)
     {
-        return Ref<MeshResource>(new OpenGLMesh(mesh), [this](MeshResource* resource) { DeleteResource(resource); });
+        if (_optimizeMeshes)
+        {
+            auto optimized = mesh;
+            _meshOptimizationStats.Add(OptimizeMesh(optimized, _reduceOverdraw));
+            return CreateMeshResource(optimized);
+        }
+        return CreateMeshResource(mesh);
+    }
+
+    Ref<MeshResource> OpenGLRenderingPlugin::CreateMeshResource(const Mesh& mesh)
+    {
+        // Arenas place meshes by vertex count, which a layout without a stride doesn't give
+        if (_useMeshArenas && mesh.Vertices.Layout.Stride > 0)
+        {
+            auto& arena = GetOrCreateMeshArena(mesh.Vertices.Layout);
+            return Ref<MeshResource>(new OpenGLArenaMesh(mesh, arena), [this](MeshResource* resource) { DeleteResource(resource); });
+        }
+        return Ref<MeshResource>(new OpenGLMesh(mesh, _state, _vertexArrays, _vertexPacking), [this](MeshResource* resource) { DeleteResource(resource); });
+    }
+
+    Ref<MeshResource> OpenGLRenderingPlugin::UploadDynamicMesh(const Mesh& mesh)
+    {
+        // The vertex ring is addressed in whole vertices, so without a stride it's uploaded like any other mesh
+        if (mesh.Vertices.Layout.Stride == 0)
+        {
+            return CreateMeshResource(mesh);
+        }
+        return Ref<MeshResource>(new OpenGLDynamicMesh(mesh, _state, _vertexArrays), [this](MeshResource* resource) { DeleteResource(resource); });
+    }
+
+    void OpenGLRenderingPlugin::DrawMeshBatch(const std::vector<Ref<MeshResource>>& meshes)
+    {
+        OpenGLProfileScope scope(_profiler, "Draw Mesh Batch");
+
+        // Bucket commands by arena block, keeping the buckets around to avoid reallocating them each batch
+        for (auto& [arena, blocks] : _batchCommands)
+        {
+            for (auto& commands : blocks) commands.clear();
+        }
+
+        for (uint32 i = 0; i < (uint32)meshes.size(); i++)
+        {
+            const auto& mesh = meshes[i];
+            if (auto* arenaMesh = dynamic_cast<OpenGLArenaMesh*>(mesh.get()))
+            {
+                auto& blocks = _batchCommands[&arenaMesh->GetArena()];
+                const auto block = arenaMesh->GetAllocation().Block;
+                if (blocks.size() <= block) blocks.resize(block + 1);
+                blocks[block].push_back(arenaMesh->GetDrawCommand(i));
+            }
+            else
+            {
+                // Still drawn with its index as base instance, so it reads its own draw storage like the rest
+                mesh->Activate();
+                if (!DrawMeshInstances(*mesh, 1, i))
+                {
+                    TBX_ASSERT(false, "GL Rendering: Batched a mesh the plugin didn't create!");
+                }
+                mesh->Release();
+            }
+        }
+
+        for (auto& [arena, blocks] : _batchCommands)
+        {
+            for (uint32 block = 0; block < (uint32)blocks.size(); block++)
+            {
+                arena->DrawBlock(block, blocks[block]);
+            }
+        }
+    }
+
+    void OpenGLRenderingPlugin::FlushRenderQueue()
+    {
+        // Still flushed when empty so its stats start over, just without a profile scope
+        if (_renderQueue.GetSubmissionCount() == 0)
+        {
+            _renderQueue.Flush();
+            return;
+        }
+
+        OpenGLProfileScope scope(_profiler, "Render Queue");
+        _renderQueue.Flush();
+    }
+
+#ifdef TBX_GL_HEADLESS_EGL
+    bool OpenGLRenderingPlugin::InitializeHeadless()
+    {
+        TBX_ASSERT(!_isGlInitialized, "GL Rendering: Already initialized on another context!");
+        _headlessContext = OpenGLHeadlessContext::Create();
+        if (!_headlessContext)
+        {
+            return false;
+        }
+
+        InitializeOpenGl();
+        return true;
+    }
+#endif
+
+    Ref<OpenGLRenderTarget> OpenGLRenderingPlugin::CreateRenderTarget(uint32 width, uint32 height, bool hasDepth, bool isDepthSampled)
+    {
+        return Ref<OpenGLRenderTarget>(new OpenGLRenderTarget(width, height, _state, hasDepth, OpenGLRenderTarget::DefaultColorFormat, isDepthSampled), [this](OpenGLRenderTarget* resource) { DeleteResource(resource); });
+    }
+
+    void OpenGLRenderingPlugin::SetRenderTarget(Ref<OpenGLRenderTarget> target)
+    {
+        _renderTarget = std::move(target);
+    }
+
+    void OpenGLRenderingPlugin::ReadRenderTargetAsync(const Ref<OpenGLRenderTarget>& target, ReadbackCallback callback)
+    {
+        TBX_ASSERT(target, "GL Rendering: Can't read back a null render target!");
+        _readbacks.Request(*target, std::move(callback));
+    }
+
+    std::unique_ptr<OpenGLCommandBuffer> OpenGLRenderingPlugin::AcquireCommandBuffer(uint32 order)
+    {
+        std::unique_ptr<OpenGLCommandBuffer> commandBuffer = nullptr;
+        {
+            std::lock_guard lock(_commandBufferMutex);
+            if (!_freeCommandBuffers.empty())
+            {
+                commandBuffer = std::move(_freeCommandBuffers.back());
+                _freeCommandBuffers.pop_back();
+            }
+        }
+
+        if (!commandBuffer)
+        {
+            commandBuffer = std::make_unique<OpenGLCommandBuffer>();
+        }
+        commandBuffer->SetOrder(order);
+        return commandBuffer;
+    }
+
+    void OpenGLRenderingPlugin::SubmitCommandBuffer(std::unique_ptr<OpenGLCommandBuffer> commandBuffer)
+    {
+        std::lock_guard lock(_commandBufferMutex);
+        _submittedCommandBuffers.push_back(std::move(commandBuffer));
+    }
+
+    void OpenGLRenderingPlugin::ExecuteCommandBuffers()
+    {
+        std::vector<std::unique_ptr<OpenGLCommandBuffer>> commandBuffers = {};
+        {
+            std::lock_guard lock(_commandBufferMutex);
+            commandBuffers.swap(_submittedCommandBuffers);
+        }
+        if (commandBuffers.empty())
+        {
+            return;
+        }
+
+        OpenGLProfileScope scope(_profiler, "Command Buffers");
+
+        // Workers submit in whatever order they finish, the order they were given keeps replay deterministic
+        std::stable_sort(commandBuffers.begin(), commandBuffers.end(), [](const auto& a, const auto& b) { return a->GetOrder() < b->GetOrder(); });
+        for (const auto& commandBuffer : commandBuffers)
+        {
+            commandBuffer->Execute(_state);
+            commandBuffer->Reset();
+        }
+
+        std::lock_guard lock(_commandBufferMutex);
+        for (auto& commandBuffer : commandBuffers)
+        {
+            _freeCommandBuffers.push_back(std::move(commandBuffer));
+        }
     }
 
     Ref<ShaderProgramResource> OpenGLRenderingPlugin::CreateShaderProgram(const std::vector<Ref<ShaderResource>>& shadersToLink)
     {
-        return Ref<ShaderProgramResource>(new OpenGLShaderProgram(shadersToLink), [this](ShaderProgramResource* resource) { DeleteResource(resource); });
+        auto* program = new OpenGLShaderProgram(shadersToLink, _state, &_programCache, _compileShadersAsync);
+        if (!program->Poll())
+        {
+            _pendingPrograms.push_back(program);
+        }
+        return Ref<ShaderProgramResource>(program, [this](ShaderProgramResource* resource) { DeleteResource(resource); });
     }
 
     Ref<ShaderResource> OpenGLRenderingPlugin::CompileShader(const Shader& shader)
     {
-        return Ref<OpenGLShader>(new OpenGLShader(shader), [this](OpenGLShader* resource) { DeleteResource(resource); });
+        // With the program cache on, compiling waits until a program misses the cache and actually needs the shader
+        auto mode = _compileShadersAsync ? ShaderCompileMode::Async : ShaderCompileMode::Immediate;
+        if (_programCache.IsEnabled())
+        {
+            mode = ShaderCompileMode::Deferred;
+        }
+        return Ref<OpenGLShader>(new OpenGLShader(shader, mode), [this](OpenGLShader* resource) { DeleteResource(resource); });
+    }
+
+    void OpenGLRenderingPlugin::SetProgramCacheDirectory(const std::filesystem::path& directory)
+    {
+        _programCache.SetDirectory(directory);
     }
 
     void OpenGLRenderingPlugin::InitializeOpenGl()
@@ -98,8 +325,13 @@ namespace Tbx::Plugins::OpenGLRendering
         const std::string& openGLVersion = (const char*)glGetString(GL_VERSION);
         TBX_TRACE_INFO("  Version: {0}\n", openGLVersion);
 
+        _programCache.SetDriver(vendorVersion, rendererVersion, openGLVersion);
+
         // Check OpenGL version
         TBX_ASSERT((GLVersion.major == 4 && GLVersion.minor >= 5), "GL Rendering: requires at least OpenGL version 4.5!");
+        TBX_TRACE_INFO("GL Rendering: GPU culling {}", OpenGLGpuCuller::IsDrawCountSupported()
+            ? "draws only visible instances with glMultiDrawElementsIndirectCount"
+            : "keeps culled draws with zero instances, glMultiDrawElementsIndirectCount isn't supported");
 
 #ifdef TBX_DEBUG
         // Enable debug output
@@ -115,17 +347,60 @@ namespace Tbx::Plugins::OpenGLRendering
         glDebugMessageCallback(GlMessageCallback, 0);
 #endif
 
+        // Let the driver build shaders on as many threads as it likes
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        }
+
         // Congifure global gl stuff
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_BLEND);
-        glDepthFunc(GL_LEQUAL);
-        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        _state.Invalidate();
+        _state.SetEnabled(GL_DEPTH_TEST, true);
+        _state.SetEnabled(GL_BLEND, true);
+        _state.SetDepthFunc(GL_LEQUAL);
+        _state.SetBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        // Texture rows are uploaded and read back tightly packed
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
 
         _isGlInitialized = true;
     }
 
     void OpenGLRenderingPlugin::DeleteResource(GraphicsResource* resourceToDelete)
     {
-        delete resourceToDelete;
+        // May be called from any thread and mid frame, the GL objects are destroyed once the GPU is done with them
+        _deletionQueue.Push(resourceToDelete);
+    }
+
+    void OpenGLRenderingPlugin::DestroyResource(GraphicsResource* resourceToDestroy)
+    {
+        std::erase(_pendingPrograms, resourceToDestroy);
+        delete resourceToDestroy;
+    }
+
+    void OpenGLRenderingPlugin::PollPendingPrograms()
+    {
+        std::erase_if(_pendingPrograms, [](OpenGLShaderProgram* program) { return program->Poll(); });
+    }
+
+    OpenGLMeshArena& OpenGLRenderingPlugin::GetOrCreateMeshArena(const VertexLayout& layout)
+    {
+        auto& arena = _meshArenas[OpenGLMeshArena::HashLayout(layout)];
+        if (!arena)
+        {
+            arena = std::make_unique<OpenGLMeshArena>(layout, _state, _vertexArrays);
+        }
+        return *arena;
+    }
+
+    OpenGLTextureArrayPool& OpenGLRenderingPlugin::GetOrCreateTextureArrayPool(const TextureArrayFormat& format)
+    {
+        auto& pool = _textureArrayPools[OpenGLTextureArrayPool::HashFormat(format)];
+        if (!pool)
+        {
+            pool = std::make_unique<OpenGLTextureArrayPool>(format, _state);
+        }
+        return *pool;
     }
 }
\ No newline at end of file
@@ -1,7 +1,29 @@
 #pragma once
+#include "OpenGLCommandBuffer.h"
+#include "OpenGLDeletionQueue.h"
+#include "OpenGLGpuCulling.h"
+#include "OpenGLHeadlessContext.h"
+#include "OpenGLMeshArena.h"
+#include "OpenGLMeshOptimizer.h"
+#include "OpenGLProfiler.h"
+#include "OpenGLProgramCache.h"
+#include "OpenGLReadbackQueue.h"
+#include "OpenGLRenderQueue.h"
+#include "OpenGLRenderTarget.h"
+#include "OpenGLShader.h"
+#include "OpenGLStateCache.h"
+#include "OpenGLTextureArrayPool.h"
+#include "OpenGLTextureContainer.h"
+#include "OpenGLTextureUploader.h"
+#include "OpenGLUniformRing.h"
+#include "OpenGLVertexArrayCache.h"
 #include <Tbx/Plugins/Plugin.h>
 #include <Tbx/Graphics/GraphicsBackend.h>
 #include <Tbx/Graphics/GraphicsResources.h>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
@@ -25,12 +47,168 @@ namespace Tbx::Plugins::OpenGLRendering
         Ref<ShaderProgramResource> CreateShaderProgram(const std::vector<Ref<ShaderResource>>& shadersToLink) override;
         Ref<ShaderResource> CompileShader(const Shader& shader) override;
 
+        // Shadow GL state of our context, exposes strict mode and per frame call stats
+        OpenGLStateCache& GetStateCache() { return _state; }
+        const OpenGLStateCache& GetStateCache() const { return _state; }
+
+        // Frame profiler, every BeginDraw/EndDraw pair is profiled as a frame once it's enabled.
+        // Wrap work in OpenGLProfileScope to see it nested inside.
+        OpenGLProfiler& GetProfiler() { return _profiler; }
+        const OpenGLProfiler& GetProfiler() const { return _profiler; }
+
+        // The CPU runs at most this many frames ahead of the GPU, BeginDraw waits when it gets further
+        void SetFramesInFlight(uint32 frameCount) { _state.GetFramePacer().SetFramesInFlight(frameCount); }
+        uint32 GetFramesInFlight() const { return _state.GetFramePacer().GetFramesInFlight(); }
+        // CPU wait and GPU latency of the last frame
+        const OpenGLFramePacer::Stats& GetFramePacingStats() const { return _state.GetFramePacer().GetStats(); }
+
+        // Bytes backing every buffer and texture we created, with high-water marks and an optional budget
+        OpenGLMemoryTracker& GetMemoryTracker() { return _state.GetMemoryTracker(); }
+        const OpenGLMemoryTracker& GetMemoryTracker() const { return _state.GetMemoryTracker(); }
+
+        // Dropping the last reference to a resource is safe from any thread, it's destroyed on the render thread
+        // at the end of the first frame after the GPU finished every frame that could still be using it.
+        uint32 GetPendingDeleteCount() const { return _deletionQueue.GetPendingCount(); }
+        // Waits for the GPU and destroys every released resource right away
+        void FlushPendingDeletes() { _deletionQueue.Flush(); }
+
+#ifdef TBX_GL_HEADLESS_EGL
+        // Creates a surfaceless EGL context owned by the plugin and initializes GL on it, in place of SetContext.
+        // Nothing is drawn on screen, render into a render target and read it back instead.
+        bool InitializeHeadless();
+#endif
+
+        // Offscreen framebuffer that can be drawn into and sampled afterwards, its depth too when sampled
+        Ref<OpenGLRenderTarget> CreateRenderTarget(uint32 width, uint32 height, bool hasDepth = true, bool isDepthSampled = false);
+        // BeginDraw clears and draws into this target, null draws to the context's default framebuffer
+        void SetRenderTarget(Ref<OpenGLRenderTarget> target);
+        const Ref<OpenGLRenderTarget>& GetRenderTarget() const { return _renderTarget; }
+
+        // Reads the target's colour back once the GPU has drawn everything submitted so far.
+        // The callback runs on the render thread at the start of a later frame, or during FlushReadbacks.
+        void ReadRenderTargetAsync(const Ref<OpenGLRenderTarget>& target, ReadbackCallback callback);
+        uint32 GetPendingReadbackCount() const { return _readbacks.GetPendingCount(); }
+        void FlushReadbacks() { _readbacks.Flush(); }
+
+        // Command buffers let worker threads prepare draws, see OpenGLCommandBuffer. Acquire and submit from any thread,
+        // submitted buffers replay on the render thread by order at the end of the frame, or earlier with ExecuteCommandBuffers.
+        std::unique_ptr<OpenGLCommandBuffer> AcquireCommandBuffer(uint32 order = 0);
+        void SubmitCommandBuffer(std::unique_ptr<OpenGLCommandBuffer> commandBuffer);
+        void ExecuteCommandBuffers();
+
+        // Uniform block data is packed into a per frame ring and bound by range, see OpenGLUniformRing for the bindings.
+        // Frame uniforms, e.g. the camera, are seen by every program and stay bound until set again.
+        void SetFrameUniforms(const std::vector<UniformValue>& values) { _uniforms.SetFrameUniforms(values); }
+        // Read by this frame's draws that follow, in place of uploading each uniform to the program
+        void SetDrawUniforms(const std::vector<UniformValue>& values) { _uniforms.SetDrawUniforms(values); }
+        // One struct per draw in a storage block, draw i of a DrawMeshBatch reads draws[i] through gl_BaseInstance, also for this frame only
+        void SetDrawStorage(const std::vector<std::vector<UniformValue>>& draws) { _uniforms.SetDrawStorage(draws); }
+        OpenGLUniformRing& GetUniformRing() { return _uniforms; }
+
+        // Queues a draw to be sorted by layer, translucency, state and depth, and merged with others sharing its state,
+        // see OpenGLRenderQueue. The queue is drawn at the end of the frame before command buffers, or earlier with FlushRenderQueue.
+        void Submit(const RenderSubmission& submission) { _renderQueue.Submit(submission); }
+        void FlushRenderQueue();
+        const OpenGLRenderQueue::Stats& GetRenderQueueStats() const { return _renderQueue.GetStats(); }
+        // Submissions whose mesh bounds, transformed by their instance, are outside this view projection's frustum aren't drawn.
+        // Bounds are computed at upload from each mesh's first three component Vector3 element, see MeshBounds.
+        void SetCullingViewProjection(const Mat4x4& viewProjection) { _renderQueue.SetCullingFrustum(OpenGLFrustum::FromViewProjection(viewProjection)); }
+        void DisableCulling() { _renderQueue.DisableCulling(); }
+        // Instances of arena meshes culled and drawn on the GPU, for scenes with more objects than are worth submitting each frame
+        OpenGLGpuCuller& GetGpuCuller() { return _gpuCuller; }
+
+        // Uploads a mesh meant to be updated every frame, see OpenGLDynamicMesh. One without a vertex stride is uploaded like any other.
+        Ref<MeshResource> UploadDynamicMesh(const Mesh& mesh);
+
+        // Uploads a block compressed texture, read with LoadCompressedTexture from a DDS or KTX2 file
+        Ref<TextureResource> UploadCompressedTexture(const CompressedTexture& texture, TextureFilter filter = TextureFilter::Linear, TextureWrap wrap = TextureWrap::Repeat);
+
+        // When enabled, uploaded textures are packed into layers of shared per format and size class arrays, see OpenGLArrayTexture
+        void SetTextureArraysEnabled(bool enabled) { _useTextureArrays = enabled; }
+        bool AreTextureArraysEnabled() const { return _useTextureArrays; }
+
+        // Texture pixels are streamed to the GPU over several frames, at most this many bytes a frame
+        void SetTextureUploadBudget(uint32 sizeInBytes) { _textureUploader.SetFrameBudget(sizeInBytes); }
+        // When deferred, texture mips are generated on the frames after their pixels finished uploading
+        void SetMipGenerationDeferred(bool deferred) { _textureUploader.SetMipGenerationDeferred(deferred); }
+        uint32 GetPendingTextureUploadCount() const { return _textureUploader.GetPendingCount(); }
+        // Finishes every queued texture upload right away
+        void FlushTextureUploads() { _textureUploader.Flush(); }
+
+        // When enabled, shaders and programs build in the background and report their status instead of asserting.
+        // Pending programs are polled every frame and can't be activated until they are ready.
+        void SetAsyncShaderCompilationEnabled(bool enabled) { _compileShadersAsync = enabled; }
+        bool IsAsyncShaderCompilationEnabled() const { return _compileShadersAsync; }
+        uint32 GetPendingProgramCount() const { return (uint32)_pendingPrograms.size(); }
+
+        // Linked programs are cached in this directory across runs, an empty path disables the cache
+        void SetProgramCacheDirectory(const std::filesystem::path& directory);
+        const OpenGLProgramCache::Stats& GetProgramCacheStats() const { return _programCache.GetStats(); }
+
+        // When enabled, uploaded meshes store colours and UVs in compact formats, and normals too for the layout elements
+        // set in normalElements, bit i for element i. See VertexPacking.
+        void SetVertexPackingEnabled(bool enabled, uint32 normalElements = 0) { _vertexPacking = { enabled, normalElements }; }
+        bool IsVertexPackingEnabled() const { return _vertexPacking.IsEnabled; }
+
+        // When enabled, uploaded meshes are sub-allocated into shared per vertex layout arenas, those without a vertex stride aren't
+        void SetMeshArenasEnabled(bool enabled) { _useMeshArenas = enabled; }
+        bool AreMeshArenasEnabled() const { return _useMeshArenas; }
+
+        // When enabled, uploaded meshes have their triangles and vertices reordered for the vertex cache and vertex fetches,
+        // a one time cost at load, see OptimizeMesh. Reducing overdraw also draws outward facing triangle clusters first.
+        void SetMeshOptimizationEnabled(bool enabled, bool reduceOverdraw = false) { _optimizeMeshes = enabled; _reduceOverdraw = reduceOverdraw; }
+        bool IsMeshOptimizationEnabled() const { return _optimizeMeshes; }
+        // Of every mesh optimized so far
+        const MeshOptimizationStats& GetMeshOptimizationStats() const { return _meshOptimizationStats; }
+
+        // Draws the given meshes with one multi draw indirect per arena block.
+        // Each mesh gets its index in the batch as base instance, so shaders can fetch per draw data through gl_BaseInstance.
+        // Meshes not living in an arena are drawn one by one, still with their index as base instance.
+        void DrawMeshBatch(const std::vector<Ref<MeshResource>>& meshes);
+
     private:
         void InitializeOpenGl();
         void DeleteResource(GraphicsResource* resourceToDelete);
+        void DestroyResource(GraphicsResource* resourceToDestroy);
+        void PollPendingPrograms();
+        Ref<MeshResource> CreateMeshResource(const Mesh& mesh);
+        OpenGLMeshArena& GetOrCreateMeshArena(const VertexLayout& layout);
+        OpenGLTextureArrayPool& GetOrCreateTextureArrayPool(const TextureArrayFormat& format);
 
     private:
+#ifdef TBX_GL_HEADLESS_EGL
+        // First so it's destroyed last, after every GL object
+        std::unique_ptr<OpenGLHeadlessContext> _headlessContext = nullptr;
+#endif
+        OpenGLStateCache _state = {};
+        OpenGLVertexArrayCache _vertexArrays = { _state };
+        OpenGLTextureUploader _textureUploader = { _state };
+        OpenGLReadbackQueue _readbacks = { _state };
+        OpenGLUniformRing _uniforms = { _state };
+        OpenGLRenderQueue _renderQueue = { _state, _uniforms };
+        OpenGLProfiler _profiler = {};
+        OpenGLProgramCache _programCache = {};
+        std::vector<OpenGLShaderProgram*> _pendingPrograms = {};
+        std::unordered_map<uint64_t, std::unique_ptr<OpenGLMeshArena>> _meshArenas = {};
+        std::unordered_map<uint64_t, std::unique_ptr<OpenGLTextureArrayPool>> _textureArrayPools = {};
+        std::unordered_map<OpenGLMeshArena*, std::vector<std::vector<DrawElementsIndirectCommand>>> _batchCommands = {};
+        std::mutex _commandBufferMutex = {};
+        std::vector<std::unique_ptr<OpenGLCommandBuffer>> _submittedCommandBuffers = {};
+        std::vector<std::unique_ptr<OpenGLCommandBuffer>> _freeCommandBuffers = {};
+        bool _useMeshArenas = false;
+        bool _useTextureArrays = false;
+        VertexPacking _vertexPacking = {};
+        bool _optimizeMeshes = false;
+        bool _reduceOverdraw = false;
+        MeshOptimizationStats _meshOptimizationStats = {};
+        bool _compileShadersAsync = false;
         bool _isGlInitialized = false;
+        // After everything the resources it still holds reference, so it flushes them while that's alive
+        OpenGLDeletionQueue _deletionQueue = { [this](GraphicsResource* resource) { DestroyResource(resource); } };
+        // After the deletion queue, so it's released onto the queue before the queue flushes
+        Ref<OpenGLRenderTarget> _renderTarget = nullptr;
+        // Holds its instances' meshes, so it's after the deletion queue too
+        OpenGLGpuCuller _gpuCuller = { _state, _uniforms };
     };
 
     TBX_REGISTER_PLUGIN(OpenGLRenderingPlugin);
@@ -0,0 +1,103 @@
+#include "OpenGLRingBuffer.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static constexpr GLbitfield RingBufferFlags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    // Regions start on this, so offsets aligned within a region stay aligned in a bigger buffer
+    static constexpr uint32 RegionAlignment = 256;
+
+    OpenGLRingBuffer::OpenGLRingBuffer(OpenGLStateCache& state, uint32 regionSizeInBytes)
+        : _state(state)
+        , _regionCount(state.GetFramePacer().GetFramesInFlight())
+    {
+        Create(regionSizeInBytes);
+    }
+
+    OpenGLRingBuffer::~OpenGLRingBuffer()
+    {
+        Destroy();
+    }
+
+    uint32 OpenGLRingBuffer::Write(const void* data, uint32 sizeInBytes, uint32 alignment)
+    {
+        const auto allocation = Allocate(sizeInBytes, alignment);
+        std::memcpy(allocation.Data, data, sizeInBytes);
+        return allocation.Offset;
+    }
+
+    OpenGLRingBuffer::Allocation OpenGLRingBuffer::Allocate(uint32 sizeInBytes, uint32 alignment)
+    {
+        // First write of a new frame, move to its slot's region
+        const auto frame = _state.GetFrameNumber();
+        if (frame != _lastWriteFrame)
+        {
+            const auto& pacer = _state.GetFramePacer();
+            if (pacer.GetFramesInFlight() != _regionCount)
+            {
+                const auto regionSize = _regionSize;
+                Destroy();
+                _regionCount = pacer.GetFramesInFlight();
+                Create(regionSize);
+            }
+            _region = pacer.GetSlotIndex() % _regionCount;
+            _regionHead = 0;
+            _lastWriteFrame = frame;
+        }
+
+        alignment = std::max(alignment, 1u);
+        auto offset = (GetRegionOffset() + _regionHead + alignment - 1) / alignment * alignment;
+        if (offset + sizeInBytes > GetRegionOffset() + _regionSize)
+        {
+            // Doesn't fit in what's left of the region, move to bigger regions and take this frame's writes along
+            const auto head = offset - GetRegionOffset();
+            const auto oldBufferGLId = _bufferGLId;
+            const auto* oldRegion = _mappedData + GetRegionOffset();
+            _bufferGLId = 0;
+            Create(std::max(_regionSize * 2, head + sizeInBytes));
+            std::memcpy(_mappedData + GetRegionOffset(), oldRegion, head);
+            Destroy(oldBufferGLId);
+            offset = GetRegionOffset() + head;
+        }
+
+        _state.CountUpload(sizeInBytes);
+        _regionHead = offset + sizeInBytes - GetRegionOffset();
+        return { offset, _mappedData + offset };
+    }
+
+    void OpenGLRingBuffer::Create(uint32 regionSizeInBytes)
+    {
+        _regionSize = (regionSizeInBytes + RegionAlignment - 1) / RegionAlignment * RegionAlignment;
+        _region = std::min(_region, _regionCount - 1);
+
+        const auto sizeInBytes = (GLsizeiptr)_regionSize * _regionCount;
+        glCreateBuffers(1, &_bufferGLId);
+        glNamedBufferStorage(_bufferGLId, sizeInBytes, nullptr, RingBufferFlags);
+        _state.GetMemoryTracker().Track(GpuMemoryType::StreamingBuffer, _bufferGLId, sizeInBytes);
+        _mappedData = static_cast<uint8_t*>(glMapNamedBufferRange(_bufferGLId, 0, sizeInBytes, RingBufferFlags));
+        TBX_ASSERT(_mappedData, "GL Rendering: Failed to persistently map ring buffer!");
+    }
+
+    void OpenGLRingBuffer::Destroy()
+    {
+        Destroy(_bufferGLId);
+        _bufferGLId = 0;
+        _mappedData = nullptr;
+        _regionHead = 0;
+    }
+
+    void OpenGLRingBuffer::Destroy(uint32 bufferGLId)
+    {
+        // GL keeps the storage alive until the GPU is done with it, so there's nothing to wait for
+        if (bufferGLId != 0)
+        {
+            glUnmapNamedBuffer(bufferGLId);
+            _state.GetMemoryTracker().Untrack(GpuMemoryType::StreamingBuffer, bufferGLId);
+            _state.OnBufferDeleted(bufferGLId);
+            glDeleteBuffers(1, &bufferGLId);
+        }
+    }
+}
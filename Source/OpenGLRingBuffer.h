@@ -0,0 +1,54 @@
+#pragma once
+#include "OpenGLStateCache.h"
+#include <Tbx/Math/Int.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Persistently mapped buffer split into one region per frame in flight.
+    // Writes are plain memcpys into the region of the frame pacer's current slot, which the pacer
+    // guarantees the GPU is done with by the time the frame begins.
+    class OpenGLRingBuffer final
+    {
+    public:
+        struct Allocation
+        {
+            // From the start of the buffer
+            uint32 Offset = 0;
+            uint8_t* Data = nullptr;
+        };
+
+        OpenGLRingBuffer(OpenGLStateCache& state, uint32 regionSizeInBytes);
+        ~OpenGLRingBuffer();
+
+        OpenGLRingBuffer(const OpenGLRingBuffer&) = delete;
+        OpenGLRingBuffer& operator=(const OpenGLRingBuffer&) = delete;
+
+        // Copies data into this frame's region and returns its offset from the start of the buffer.
+        // The offset is a multiple of alignment. If the region runs out of space the buffer is recreated bigger,
+        // which gives it a new GL id, as does changing the number of frames in flight.
+        uint32 Write(const void* data, uint32 sizeInBytes, uint32 alignment = 4);
+        // Like Write, but hands out the mapped memory to be filled in place.
+        // What was written to the region this frame is carried over when the buffer grows, at the same offset from the region's start.
+        Allocation Allocate(uint32 sizeInBytes, uint32 alignment = 4);
+
+        uint32 GetGLId() const { return _bufferGLId; }
+        uint32 GetRegionSize() const { return _regionSize; }
+        // Start of the region this frame writes to
+        uint32 GetRegionOffset() const { return _region * _regionSize; }
+
+    private:
+        void Create(uint32 regionSizeInBytes);
+        void Destroy();
+        void Destroy(uint32 bufferGLId);
+
+    private:
+        OpenGLStateCache& _state;
+        uint32 _bufferGLId = 0;
+        uint8_t* _mappedData = nullptr;
+        uint32 _regionSize = 0;
+        uint32 _regionCount = 0;
+        uint32 _region = 0;
+        uint32 _regionHead = 0;
+        uint64_t _lastWriteFrame = ~0ull;
+    };
+}
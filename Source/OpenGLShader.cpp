@@ -3,71 +3,86 @@
 #include <Tbx/Math/Mat4x4.h>
 #include <Tbx/Graphics/Color.h>
 #include <Tbx/Debug/Asserts.h>
+#include <Tbx/Debug/Tracers.h>
 #include <glad/glad.h>
 #include <vector>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
     ///// Helpers //////////////////////////////////////////////////////////////////
-    static uint GetUniformLocation(const std::string name, uint programId)
+    static void UploadUniformInt(GLint location, int value)
     {
-        GLint location = glGetUniformLocation(programId, name.c_str());
-        //TBX_ASSERT(location != -1, "Invalid uniform location: {}", name);
-        return location;
-    }
-
-    static void UploadUniformInt(const std::string& name, int value, uint programId)
-    {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniform1i(location, value);
     }
 
-    static void UploadUniformIntArray(const std::string& name, std::vector<int> values, uint programId)
+    static void UploadUniformIntArray(GLint location, const std::vector<int>& values)
     {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniform1iv(location, (uint32)values.size(), values.data());
     }
 
-    static void UploadUniformFloat(const std::string& name, float value, uint programId)
+    static void UploadUniformFloat(GLint location, float value)
     {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniform1f(location, value);
     }
 
-    static void UploadUniformFloat2(const std::string& name, const Vector2& value, uint programId)
+    static void UploadUniformFloat2(GLint location, const Vector2& value)
     {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniform2f(location, value.X, value.Y);
     }
 
-    static void UploadUniformFloat3(const std::string& name, const Vector3& value, uint programId)
+    static void UploadUniformFloat3(GLint location, const Vector3& value)
     {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniform3f(location, value.X, value.Y, value.Z);
     }
 
-    static void UploadUniformFloat4(const std::string& name, const RgbaColor& value, uint programId)
+    static void UploadUniformFloat4(GLint location, const RgbaColor& value)
     {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniform4f(location, value.R, value.G, value.B, value.A);
     }
 
     // TODO: Implement when needed... Toybox doesn't have a mat3 yet...
-    ////static void UploadUniformMat3(const std::string& name, const Matrix& matrix, uint rendererId)
+    ////static void UploadUniformMat3(GLint location, const Matrix& matrix)
     ////{
-    ////	GLint location = glGetUniformLocation(rendererId, name.c_str());
     ////	glUniformMatrix3fv(location, 1, GL_FALSE, matrix.Values.data());
     ////}
 
-    static void UploadUniformMat4(const std::string& name, const Mat4x4& matrix, uint programId)
+    static void UploadUniformMat4(GLint location, const Mat4x4& matrix)
     {
-        GLint location = GetUniformLocation(name.c_str(), programId);
         glUniformMatrix4fv(location, 1, GL_FALSE, matrix.Values.data());
     }
 
-    OpenGLShader::OpenGLShader(const Shader& shader)
+    static std::string GetShaderInfoLog(uint32 shaderId)
+    {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
+        if (maxLength <= 0)
+        {
+            return {};
+        }
+        std::vector<GLchar> infoLog(maxLength);
+        glGetShaderInfoLog(shaderId, maxLength, &maxLength, &infoLog[0]);
+        return std::string(infoLog.data());
+    }
+
+    static std::string GetProgramInfoLog(uint32 programId)
+    {
+        GLint maxLength = 0;
+        glGetProgramiv(programId, GL_INFO_LOG_LENGTH, &maxLength);
+        if (maxLength <= 0)
+        {
+            return {};
+        }
+        std::vector<GLchar> infoLog(maxLength);
+        glGetProgramInfoLog(programId, maxLength, &maxLength, &infoLog[0]);
+        return std::string(infoLog.data());
+    }
+
+    ///// Shader //////////////////////////////////////////////////////////////////
+
+    OpenGLShader::OpenGLShader(const Shader& shader, ShaderCompileMode mode)
     {
         _type = shader.Type;
+        _source = shader.Source;
 
         // Create a shader handle
         if (shader.Type == ShaderType::Vertex)
@@ -88,120 +103,302 @@ namespace Tbx::Plugins::OpenGLRendering
         const auto* source = shader.Source.c_str();
         glShaderSource(RenderId, 1, &source, nullptr);
 
-        // Compile the vertex shader
-        glCompileShader(RenderId);
+        if (mode == ShaderCompileMode::Immediate)
+        {
+            Compile(true);
+        }
+        else if (mode == ShaderCompileMode::Async)
+        {
+            Compile(false);
+        }
+    }
+
+    OpenGLShader::~OpenGLShader()
+    {
+        glDeleteShader(RenderId);
+    }
+
+    void OpenGLShader::Compile(bool waitForResult)
+    {
+        if (!_isCompileSubmitted)
+        {
+            // Compile the shader
+            glCompileShader(RenderId);
+            _isCompileSubmitted = true;
+        }
+
+        if (!waitForResult || _status != ShaderBuildStatus::Pending)
+        {
+            return;
+        }
 
         GLint isCompiled = 0;
         glGetShaderiv(RenderId, GL_COMPILE_STATUS, &isCompiled);
         if (isCompiled == GL_FALSE) // Check if we failed compilation
         {
-            // Get the error
-            GLint maxLength = 0;
-            glGetShaderiv(RenderId, GL_INFO_LOG_LENGTH, &maxLength);
-            std::vector<GLchar> infoLog(maxLength);
-            glGetShaderInfoLog(RenderId, maxLength, &maxLength, &infoLog[0]);
-
-            // Cleanup
-            glDeleteShader(RenderId);
-
-            // Assert
-            const auto& error = std::string(infoLog.data());
-            TBX_ASSERT(false, "GL Rendering: Shader compilation failure: {}", error);
+            _status = ShaderBuildStatus::Failed;
+            TBX_ASSERT(false, "GL Rendering: Shader compilation failure: {}", GetCompileLog());
             return;
         }
+        _status = ShaderBuildStatus::Ready;
     }
 
-    ///// Shader //////////////////////////////////////////////////////////////////
-    OpenGLShader::~OpenGLShader()
+    std::string OpenGLShader::GetCompileLog() const
     {
-        glDeleteShader(RenderId);
+        return GetShaderInfoLog((uint32)RenderId);
     }
 
     ///// ShaderProgram //////////////////////////////////////////////////////////////////
 
-    OpenGLShaderProgram::OpenGLShaderProgram(const std::vector<Ref<ShaderResource>>& shaders)
+    OpenGLShaderProgram::OpenGLShaderProgram(const std::vector<Ref<ShaderResource>>& shaders, OpenGLStateCache& state, OpenGLProgramCache* cache, bool async)
+        : _state(state)
+        , _cache(cache)
     {
         // Create program
         RenderId = glCreateProgram();
 
-        // Attach shaders
+        // Try to skip compiling and linking altogether
+        _cacheKey = cache ? cache->GetKey(shaders) : 0;
+        if (cache && cache->Load(RenderId, _cacheKey))
+        {
+            CacheActiveUniforms();
+            _status = ShaderBuildStatus::Ready;
+            return;
+        }
+
+        // Attach shaders, submitting any compiles that were deferred
         for (const auto& shader : shaders)
         {
+            if (auto* glShader = dynamic_cast<OpenGLShader*>(shader.get()))
+            {
+                glShader->Compile(false);
+            }
             glAttachShader(RenderId, shader->RenderId);
         }
 
-        // Link our program
+        // Link our program, the driver waits for the compiles itself
+        if (cache && cache->IsEnabled())
+        {
+            glProgramParameteri(RenderId, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         glLinkProgram(RenderId);
+
+        // Keep the shaders alive until we know how linking went
+        _linkingShaders = shaders;
+        _isAsync = async;
+        if (!async)
+        {
+            FinishLinking();
+        }
+    }
+
+    bool OpenGLShaderProgram::Poll()
+    {
+        if (_status != ShaderBuildStatus::Pending)
+        {
+            return true;
+        }
+
+        // Without parallel compile support asking for completion isn't possible, so just finish up
+        if (GLAD_GL_KHR_parallel_shader_compile)
+        {
+            GLint isComplete = GL_FALSE;
+            glGetProgramiv(RenderId, GL_COMPLETION_STATUS_KHR, &isComplete);
+            if (isComplete == GL_FALSE)
+            {
+                return false;
+            }
+        }
+
+        FinishLinking();
+        return true;
+    }
+
+    void OpenGLShaderProgram::FinishLinking()
+    {
         GLint isLinked = 0;
         glGetProgramiv(RenderId, GL_LINK_STATUS, &isLinked);
         if (isLinked == GL_FALSE) // Check if we failed linking
         {
-            // Get the error
-            GLint maxLength = 0;
-            glGetProgramiv(RenderId, GL_INFO_LOG_LENGTH, &maxLength);
-            std::vector<GLchar> infoLog(maxLength);
-            glGetProgramInfoLog(RenderId, maxLength, &maxLength, &infoLog[0]);
-
-            // Cleanup
-            glDeleteProgram(RenderId);
+            // Compile errors only show up as a link failure when compiling wasn't waited on, so gather them too
+            auto error = GetProgramInfoLog((uint32)RenderId);
+            for (const auto& shader : _linkingShaders)
+            {
+                GLint isCompiled = GL_TRUE;
+                glGetShaderiv(shader->RenderId, GL_COMPILE_STATUS, &isCompiled);
+                if (isCompiled == GL_FALSE)
+                {
+                    error += GetShaderInfoLog((uint32)shader->RenderId);
+                }
+            }
+            _linkingShaders.clear();
+            _status = ShaderBuildStatus::Failed;
 
-            // Assert
-            const auto& error = std::string(infoLog.data());
-            TBX_ASSERT(false, "GL Rendering: Shader link failure: {0}", error);
+            // Async builds report failure through their status instead of bringing everything down
+            if (_isAsync)
+            {
+                TBX_TRACE_ERROR("GL Rendering: Shader link failure: {0}", error);
+            }
+            else
+            {
+                TBX_ASSERT(false, "GL Rendering: Shader link failure: {0}", error);
+            }
             return;
         }
 
         // Detach after successful link
-        for (const auto& shader : shaders)
+        for (const auto& shader : _linkingShaders)
         {
             glDetachShader(RenderId, shader->RenderId);
         }
+        _linkingShaders.clear();
+
+        if (_cache)
+        {
+            _cache->Store(RenderId, _cacheKey);
+        }
+        CacheActiveUniforms();
+        _status = ShaderBuildStatus::Ready;
     }
 
     OpenGLShaderProgram::~OpenGLShaderProgram()
     {
+        _state.OnProgramDeleted((uint32)RenderId);
         glDeleteProgram(RenderId);
     }
 
     void OpenGLRendering::OpenGLShaderProgram::Activate()
     {
-        glUseProgram(RenderId);
+        TryActivate();
+    }
+
+    bool OpenGLShaderProgram::TryActivate()
+    {
+        // Using a program the driver is still building would stall on it, and failed ones can't draw
+        if (_status != ShaderBuildStatus::Ready)
+        {
+            _state.UseProgram(0);
+            return false;
+        }
+        _state.UseProgram((uint32)RenderId);
+        return true;
     }
 
     void OpenGLRendering::OpenGLShaderProgram::Release()
     {
-        glUseProgram(0);
+        if (_state.IsStrictMode())
+        {
+            _state.UseProgram(0);
+        }
     }
 
     void OpenGLRendering::OpenGLShaderProgram::Upload(const ShaderUniform& uniform)
     {
-        if (std::holds_alternative<Mat4x4>(uniform.Data))
+        Upload(GetUniformHandle(uniform.Name), uniform.Data);
+    }
+
+    uint32 OpenGLShaderProgram::GetUniformHandle(std::string_view name) const
+    {
+        const auto it = _uniformHandles.find(name);
+        if (it == _uniformHandles.end())
+        {
+            return InvalidUniformHandle;
+        }
+        return it->second;
+    }
+
+    void OpenGLShaderProgram::Upload(uint32 handle, const UniformValue& value)
+    {
+        if (handle >= _uniformLocations.size())
         {
-            UploadUniformMat4(uniform.Name, std::get<Mat4x4>(uniform.Data), RenderId);
+            return;
+        }
+
+        const GLint location = _uniformLocations[handle];
+        if (std::holds_alternative<Mat4x4>(value))
+        {
+            UploadUniformMat4(location, std::get<Mat4x4>(value));
         }
-        else if (std::holds_alternative<Vector2>(uniform.Data))
+        else if (std::holds_alternative<Vector2>(value))
         {
-            UploadUniformFloat2(uniform.Name, std::get<Vector2>(uniform.Data), RenderId);
+            UploadUniformFloat2(location, std::get<Vector2>(value));
         }
-        else if (std::holds_alternative<Vector3>(uniform.Data))
+        else if (std::holds_alternative<Vector3>(value))
         {
-            UploadUniformFloat3(uniform.Name, std::get<Vector3>(uniform.Data), RenderId);
+            UploadUniformFloat3(location, std::get<Vector3>(value));
         }
-        else if (std::holds_alternative<RgbaColor>(uniform.Data))
+        else if (std::holds_alternative<RgbaColor>(value))
         {
-            UploadUniformFloat4(uniform.Name, std::get<RgbaColor>(uniform.Data), RenderId);
+            UploadUniformFloat4(location, std::get<RgbaColor>(value));
         }
-        else if (std::holds_alternative<float>(uniform.Data))
+        else if (std::holds_alternative<float>(value))
         {
-            UploadUniformFloat(uniform.Name, std::get<float>(uniform.Data), RenderId);
+            UploadUniformFloat(location, std::get<float>(value));
         }
-        else if (std::holds_alternative<int>(uniform.Data))
+        else if (std::holds_alternative<int>(value))
         {
-            UploadUniformInt(uniform.Name, std::get<int>(uniform.Data), RenderId);
+            UploadUniformInt(location, std::get<int>(value));
         }
         else
         {
             TBX_ASSERT(false, "GL Rendering: Unsupported shader data type.");
         }
     }
+
+    void OpenGLShaderProgram::CacheActiveUniforms()
+    {
+        _uniformHandles.clear();
+        _uniformLocations.clear();
+
+        GLint uniformCount = 0;
+        glGetProgramiv(RenderId, GL_ACTIVE_UNIFORMS, &uniformCount);
+        GLint maxNameLength = 0;
+        glGetProgramiv(RenderId, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+        if (uniformCount <= 0 || maxNameLength <= 0)
+        {
+            return;
+        }
+
+        const auto addUniform = [this](std::string name, GLint location)
+        {
+            if (_uniformHandles.contains(name))
+            {
+                return;
+            }
+            _uniformHandles.emplace(std::move(name), (uint32)_uniformLocations.size());
+            _uniformLocations.push_back(location);
+        };
+
+        std::vector<GLchar> nameBuffer(maxNameLength);
+        _uniformLocations.reserve(uniformCount);
+        for (GLint i = 0; i < uniformCount; i++)
+        {
+            GLsizei nameLength = 0;
+            GLint arraySize = 0;
+            GLenum type = GL_NONE;
+            glGetActiveUniform(RenderId, (GLuint)i, maxNameLength, &nameLength, &arraySize, &type, nameBuffer.data());
+
+            // Uniforms living in blocks have no location and can't be uploaded individually
+            std::string name(nameBuffer.data(), nameLength);
+            const GLint location = glGetUniformLocation(RenderId, name.c_str());
+            if (location == -1)
+            {
+                continue;
+            }
+
+            // Arrays are reported as "name[0]", make them reachable as "name" and "name[i]" too
+            constexpr std::string_view arraySuffix = "[0]";
+            if (name.ends_with(arraySuffix))
+            {
+                const auto baseName = name.substr(0, name.size() - arraySuffix.size());
+                addUniform(baseName, location);
+                for (GLint element = 1; element < arraySize; element++)
+                {
+                    auto elementName = baseName + "[" + std::to_string(element) + "]";
+                    addUniform(elementName, glGetUniformLocation(RenderId, elementName.c_str()));
+                }
+            }
+            addUniform(std::move(name), location);
+        }
+    }
 }
@@ -1,32 +1,107 @@
 #pragma once
+#include "OpenGLProgramCache.h"
+#include "OpenGLStateCache.h"
 #include <Tbx/Graphics/Shader.h>
 #include <Tbx/Graphics/GraphicsResources.h>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
+    using UniformValue = decltype(ShaderUniform::Data);
+
+    enum class ShaderBuildStatus
+    {
+        Pending,
+        Ready,
+        Failed
+    };
+
+    enum class ShaderCompileMode
+    {
+        // Compile and check the result right away
+        Immediate,
+        // Submit the compile, the result is checked when a program using the shader is linked
+        Async,
+        // Only compile once a program needs the shader, which a program cache hit avoids entirely
+        Deferred
+    };
+
     class OpenGLShader : public ShaderResource
     {
     public:
-        OpenGLShader(const Shader& shader);
+        OpenGLShader(const Shader& shader, ShaderCompileMode mode = ShaderCompileMode::Immediate);
         ~OpenGLShader();
 
+        // Submits the compile if it hasn't been yet, optionally waiting for and checking its result.
+        void Compile(bool waitForResult);
+        std::string GetCompileLog() const;
+
         void Activate() override {}
         void Release() override {}
 
+        ShaderType GetType() const { return _type; }
+        ShaderBuildStatus GetStatus() const { return _status; }
+        const std::string& GetSource() const { return _source; }
+
     private:
         ShaderType _type = ShaderType::None;
+        std::string _source = {};
+        ShaderBuildStatus _status = ShaderBuildStatus::Pending;
+        bool _isCompileSubmitted = false;
     };
 
     class OpenGLShaderProgram final : public ShaderProgramResource
     {
     public:
-        OpenGLShaderProgram(const std::vector<Ref<ShaderResource>>& shaders);
+        static constexpr uint32 InvalidUniformHandle = ~0u;
+
+        // When given a cache, the program is loaded from it if possible and stored in it after linking otherwise.
+        // Async programs don't wait for linking to finish, they stay pending until a Poll sees the driver is done.
+        OpenGLShaderProgram(const std::vector<Ref<ShaderResource>>& shaders, OpenGLStateCache& state, OpenGLProgramCache* cache = nullptr, bool async = false);
         ~OpenGLShaderProgram();
 
+        // Returns true once the program is no longer pending.
+        bool Poll();
+        ShaderBuildStatus GetStatus() const { return _status; }
+        bool IsReady() const { return _status == ShaderBuildStatus::Ready; }
+
+        // Unbinds any program while this one isn't ready, so nothing draws with whatever was bound before.
         void Activate() override;
+        // Activates the program, returning whether it's ready. Callers should skip their draws when it isn't.
+        bool TryActivate();
         void Release() override;
 
         void Upload(const ShaderUniform& uniform) override;
+
+        // Resolves a uniform name to a handle that stays valid for the lifetime of the program.
+        // Returns InvalidUniformHandle if the program has no active uniform with that name.
+        uint32 GetUniformHandle(std::string_view name) const;
+
+        // Uploads a value to a uniform previously resolved with GetUniformHandle.
+        // Uploads to InvalidUniformHandle are ignored.
+        void Upload(uint32 handle, const UniformValue& value);
+
+    private:
+        void FinishLinking();
+        void CacheActiveUniforms();
+
+    private:
+        struct UniformNameHash
+        {
+            using is_transparent = void;
+            size_t operator()(std::string_view name) const { return std::hash<std::string_view>{}(name); }
+        };
+
+        OpenGLStateCache& _state;
+        OpenGLProgramCache* _cache = nullptr;
+        uint64_t _cacheKey = 0;
+        std::vector<Ref<ShaderResource>> _linkingShaders = {};
+        ShaderBuildStatus _status = ShaderBuildStatus::Pending;
+        bool _isAsync = false;
+        std::unordered_map<std::string, uint32, UniformNameHash, std::equal_to<>> _uniformHandles = {};
+        std::vector<int> _uniformLocations = {};
     };
 }
-
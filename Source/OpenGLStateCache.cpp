@@ -0,0 +1,274 @@
+#include "OpenGLStateCache.h"
+#include <glad/glad.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLStateCache::OpenGLStateCache()
+    {
+        Invalidate();
+    }
+
+    void OpenGLStateCache::Invalidate()
+    {
+        _program = Unknown;
+        _vertexArray = Unknown;
+        _framebuffer = Unknown;
+        _arrayBuffer = Unknown;
+        _drawIndirectBuffer = Unknown;
+        _pixelUnpackBuffer = Unknown;
+        _pixelPackBuffer = Unknown;
+        _textureUnits.fill(Unknown);
+        _uniformBlocks.fill({});
+        _storageBlocks.fill({});
+        _vertexArrayBindings.clear();
+        _capabilities.clear();
+        _depthMask = Tristate::Unknown;
+        _depthFunc = Unknown;
+        _blendSrcFactor = Unknown;
+        _blendDstFactor = Unknown;
+    }
+
+    void OpenGLStateCache::EndFrame()
+    {
+        _lastFrameStats = _frameStats;
+        _frameStats = {};
+        _frameNumber++;
+    }
+
+    void OpenGLStateCache::UseProgram(uint32 program)
+    {
+        if (_program == program)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glUseProgram(program);
+        _program = program;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindVertexArray(uint32 vertexArray)
+    {
+        if (_vertexArray == vertexArray)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBindVertexArray(vertexArray);
+        _vertexArray = vertexArray;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindFramebuffer(uint32 framebuffer)
+    {
+        if (_framebuffer == framebuffer)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+        _framebuffer = framebuffer;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindBuffer(uint32 target, uint32 buffer)
+    {
+        uint32* cached = nullptr;
+        if (target == GL_ARRAY_BUFFER) cached = &_arrayBuffer;
+        else if (target == GL_DRAW_INDIRECT_BUFFER) cached = &_drawIndirectBuffer;
+        else if (target == GL_PIXEL_UNPACK_BUFFER) cached = &_pixelUnpackBuffer;
+        else if (target == GL_PIXEL_PACK_BUFFER) cached = &_pixelPackBuffer;
+
+        if (cached && *cached == buffer)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBindBuffer(target, buffer);
+        if (cached) *cached = buffer;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindBufferRange(uint32 target, uint32 index, uint32 buffer, uint32 offset, uint32 size)
+    {
+        BufferRange* cached = nullptr;
+        if (index < MaxBlockBindings)
+        {
+            if (target == GL_UNIFORM_BUFFER) cached = &_uniformBlocks[index];
+            else if (target == GL_SHADER_STORAGE_BUFFER) cached = &_storageBlocks[index];
+        }
+
+        if (cached && cached->Buffer == buffer && cached->Offset == offset && cached->Size == size)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBindBufferRange(target, index, buffer, offset, size);
+        if (cached) *cached = { buffer, offset, size };
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindVertexBuffer(uint32 vertexArray, uint32 bindingIndex, uint32 buffer, uint32 offset, uint32 stride)
+    {
+        auto* cached = bindingIndex < MaxVertexBufferBindings ? &_vertexArrayBindings[vertexArray].VertexBuffers[bindingIndex] : nullptr;
+        if (cached && cached->Buffer == buffer && cached->Offset == offset && cached->Stride == stride)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glVertexArrayVertexBuffer(vertexArray, bindingIndex, buffer, offset, stride);
+        if (cached) *cached = { buffer, offset, stride };
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindElementBuffer(uint32 vertexArray, uint32 buffer)
+    {
+        auto& cached = _vertexArrayBindings[vertexArray].ElementBuffer;
+        if (cached == buffer)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glVertexArrayElementBuffer(vertexArray, buffer);
+        cached = buffer;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindTextureUnit(uint32 unit, uint32 texture)
+    {
+        uint32* cached = unit < MaxTextureUnits ? &_textureUnits[unit] : nullptr;
+        if (cached && *cached == texture)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBindTextureUnit(unit, texture);
+        if (cached) *cached = texture;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::BindTexture(uint32 target, uint32 texture)
+    {
+        if (_textureUnits[0] == texture)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBindTexture(target, texture);
+        _textureUnits[0] = texture;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::SetEnabled(uint32 capability, bool enabled)
+    {
+        const auto it = _capabilities.find(capability);
+        if (it != _capabilities.end() && it->second == enabled)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        if (enabled) glEnable(capability);
+        else glDisable(capability);
+        _capabilities[capability] = enabled;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::SetDepthMask(bool enabled)
+    {
+        const auto mask = enabled ? Tristate::On : Tristate::Off;
+        if (_depthMask == mask)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glDepthMask(enabled ? GL_TRUE : GL_FALSE);
+        _depthMask = mask;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::SetDepthFunc(uint32 func)
+    {
+        if (_depthFunc == func)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glDepthFunc(func);
+        _depthFunc = func;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::SetBlendFunc(uint32 srcFactor, uint32 dstFactor)
+    {
+        if (_blendSrcFactor == srcFactor && _blendDstFactor == dstFactor)
+        {
+            _frameStats.SkippedCalls++;
+            return;
+        }
+
+        glBlendFunc(srcFactor, dstFactor);
+        _blendSrcFactor = srcFactor;
+        _blendDstFactor = dstFactor;
+        _frameStats.IssuedCalls++;
+    }
+
+    void OpenGLStateCache::OnProgramDeleted(uint32 program)
+    {
+        if (_program == program) _program = Unknown;
+    }
+
+    void OpenGLStateCache::OnVertexArrayDeleted(uint32 vertexArray)
+    {
+        if (_vertexArray == vertexArray) _vertexArray = Unknown;
+        _vertexArrayBindings.erase(vertexArray);
+    }
+
+    void OpenGLStateCache::OnFramebufferDeleted(uint32 framebuffer)
+    {
+        if (_framebuffer == framebuffer) _framebuffer = Unknown;
+    }
+
+    void OpenGLStateCache::OnBufferDeleted(uint32 buffer)
+    {
+        if (_arrayBuffer == buffer) _arrayBuffer = Unknown;
+        if (_drawIndirectBuffer == buffer) _drawIndirectBuffer = Unknown;
+        if (_pixelUnpackBuffer == buffer) _pixelUnpackBuffer = Unknown;
+        if (_pixelPackBuffer == buffer) _pixelPackBuffer = Unknown;
+        for (auto& range : _uniformBlocks)
+        {
+            if (range.Buffer == buffer) range = {};
+        }
+        for (auto& range : _storageBlocks)
+        {
+            if (range.Buffer == buffer) range = {};
+        }
+        for (auto& [vertexArray, bindings] : _vertexArrayBindings)
+        {
+            for (auto& binding : bindings.VertexBuffers)
+            {
+                if (binding.Buffer == buffer) binding = {};
+            }
+            if (bindings.ElementBuffer == buffer) bindings.ElementBuffer = Unknown;
+        }
+    }
+
+    void OpenGLStateCache::OnTextureDeleted(uint32 texture)
+    {
+        for (auto& unit : _textureUnits)
+        {
+            if (unit == texture) unit = Unknown;
+        }
+    }
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include "OpenGLFramePacer.h"
+#include "OpenGLMemoryTracker.h"
+#include "OpenGLNamePool.h"
+#include <Tbx/Math/Int.h>
+#include <array>
+#include <unordered_map>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Shadow copy of the GL state this plugin touches.
+    // Every bind/enable/mask/blend call goes through here and is skipped when it would not change anything.
+    class OpenGLStateCache final
+    {
+    public:
+        struct FrameStats
+        {
+            uint32 IssuedCalls = 0;
+            uint32 SkippedCalls = 0;
+            uint32 DrawCalls = 0;
+            uint64_t UploadedBytes = 0;
+        };
+
+        static constexpr uint32 MaxTextureUnits = 32;
+
+        OpenGLStateCache();
+
+        // Forgets everything we know, the next call of each kind will always reach the driver.
+        void Invalidate();
+
+        // Closes the current frame, its stats become available through GetLastFrameStats.
+        void EndFrame();
+        uint64_t GetFrameNumber() const { return _frameNumber; }
+        const FrameStats& GetLastFrameStats() const { return _lastFrameStats; }
+        const FrameStats& GetCurrentFrameStats() const { return _frameStats; }
+
+        // Draws and uploads don't go through the cache, whoever issues them reports them here for the frame stats.
+        void CountDraws(uint32 drawCalls = 1) { _frameStats.DrawCalls += drawCalls; }
+        void CountUpload(uint64_t sizeInBytes) { _frameStats.UploadedBytes += sizeInBytes; }
+
+        // Resources report their storage here, reached through the state cache since every resource already holds it.
+        OpenGLMemoryTracker& GetMemoryTracker() { return _memory; }
+        const OpenGLMemoryTracker& GetMemoryTracker() const { return _memory; }
+        // Buffer and texture names come from here so they can be recycled
+        OpenGLNamePool& GetNamePool() { return _names; }
+        // Per frame streaming data keys off the pacer's slot index
+        OpenGLFramePacer& GetFramePacer() { return _pacer; }
+        const OpenGLFramePacer& GetFramePacer() const { return _pacer; }
+
+        // When strict, resources unbind themselves on Release, otherwise Release leaves state as is.
+        void SetStrictMode(bool strict) { _isStrict = strict; }
+        bool IsStrictMode() const { return _isStrict; }
+
+        void UseProgram(uint32 program);
+        void BindVertexArray(uint32 vertexArray);
+        // Binds for both drawing and reading, 0 is the context's default framebuffer
+        void BindFramebuffer(uint32 framebuffer);
+        void BindBuffer(uint32 target, uint32 buffer);
+        // Binds a range of a buffer to a uniform or shader storage block binding point
+        void BindBufferRange(uint32 target, uint32 index, uint32 buffer, uint32 offset, uint32 size);
+        // Buffer attachments of a vertex array, tracked per vertex array so shared ones only rebind what changed
+        void BindVertexBuffer(uint32 vertexArray, uint32 bindingIndex, uint32 buffer, uint32 offset, uint32 stride);
+        void BindElementBuffer(uint32 vertexArray, uint32 buffer);
+        void BindTextureUnit(uint32 unit, uint32 texture);
+        // Binds to the active texture unit, which this plugin always leaves at unit 0.
+        void BindTexture(uint32 target, uint32 texture);
+
+        void SetEnabled(uint32 capability, bool enabled);
+        void SetDepthMask(bool enabled);
+        void SetDepthFunc(uint32 func);
+        void SetBlendFunc(uint32 srcFactor, uint32 dstFactor);
+
+        // GL unbinds objects when they are deleted and may hand out their names again, so the cache must forget them too.
+        void OnProgramDeleted(uint32 program);
+        void OnVertexArrayDeleted(uint32 vertexArray);
+        void OnFramebufferDeleted(uint32 framebuffer);
+        void OnBufferDeleted(uint32 buffer);
+        void OnTextureDeleted(uint32 texture);
+
+    private:
+        static constexpr uint32 Unknown = ~0u;
+        static constexpr uint32 MaxVertexBufferBindings = 2;
+        static constexpr uint32 MaxBlockBindings = 16;
+
+        struct BufferRange
+        {
+            uint32 Buffer = Unknown;
+            uint32 Offset = Unknown;
+            uint32 Size = Unknown;
+        };
+
+        struct VertexBufferBinding
+        {
+            uint32 Buffer = Unknown;
+            uint32 Offset = Unknown;
+            uint32 Stride = Unknown;
+        };
+
+        struct VertexArrayBindings
+        {
+            std::array<VertexBufferBinding, MaxVertexBufferBindings> VertexBuffers = {};
+            uint32 ElementBuffer = Unknown;
+        };
+
+        enum class Tristate : uint8_t { Unknown, Off, On };
+
+        uint32 _program = Unknown;
+        uint32 _vertexArray = Unknown;
+        uint32 _framebuffer = Unknown;
+        uint32 _arrayBuffer = Unknown;
+        uint32 _drawIndirectBuffer = Unknown;
+        uint32 _pixelUnpackBuffer = Unknown;
+        uint32 _pixelPackBuffer = Unknown;
+        std::array<uint32, MaxTextureUnits> _textureUnits = {};
+        std::array<BufferRange, MaxBlockBindings> _uniformBlocks = {};
+        std::array<BufferRange, MaxBlockBindings> _storageBlocks = {};
+        std::unordered_map<uint32, VertexArrayBindings> _vertexArrayBindings = {};
+
+        std::unordered_map<uint32, bool> _capabilities = {};
+        Tristate _depthMask = Tristate::Unknown;
+        uint32 _depthFunc = Unknown;
+        uint32 _blendSrcFactor = Unknown;
+        uint32 _blendDstFactor = Unknown;
+
+        bool _isStrict = false;
+        uint64_t _frameNumber = 0;
+        FrameStats _frameStats = {};
+        FrameStats _lastFrameStats = {};
+        OpenGLMemoryTracker _memory = {};
+        OpenGLNamePool _names = {};
+        OpenGLFramePacer _pacer = {};
+    };
+}
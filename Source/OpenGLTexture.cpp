@@ -1,6 +1,10 @@
 #include "OpenGLTexture.h"
 #include <Tbx/Debug/Asserts.h>
 #include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+#include <span>
+#include <vector>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
@@ -12,13 +16,13 @@ namespace Tbx::Plugins::OpenGLRendering
         GLenum DataFormat = 0;
     };
 
-    int TbxTexFilterToGLTexFilter(const Texture& tex)
+    int TbxTexFilterToGLTexFilter(TextureFilter filter)
     {
-        if (tex.Filter == TextureFilter::Nearest)
+        if (filter == TextureFilter::Nearest)
         {
             return GL_NEAREST;
         }
-        else if (tex.Filter == TextureFilter::Linear)
+        else if (filter == TextureFilter::Linear)
         {
             return GL_LINEAR;
         }
@@ -29,17 +33,17 @@ namespace Tbx::Plugins::OpenGLRendering
         }
     }
 
-    int TbxTexWrapToGLTexWrap(const Texture& tex)
+    int TbxTexWrapToGLTexWrap(TextureWrap wrap)
     {
-        if (tex.Wrap == TextureWrap::Repeat)
+        if (wrap == TextureWrap::Repeat)
         {
             return GL_REPEAT;
         }
-        else if (tex.Wrap == TextureWrap::MirroredRepeat)
+        else if (wrap == TextureWrap::MirroredRepeat)
         {
             return GL_MIRRORED_REPEAT;
         }
-        else if (tex.Wrap == TextureWrap::ClampToEdge)
+        else if (wrap == TextureWrap::ClampToEdge)
         {
             return GL_CLAMP_TO_EDGE;
         }
@@ -63,40 +67,143 @@ namespace Tbx::Plugins::OpenGLRendering
         }
         else
         {
+            TBX_ASSERT(false, "GL Rendering: Unsupported texture format, compressed textures go through UploadCompressedTexture.");
             return { GL_RGB8, GL_RGB };
-            TBX_ASSERT(false, "Unsupported texture format.");
         }
     }
 
+    static uint32 GetMipLevelCount(uint32 width, uint32 height)
+    {
+        uint32 levels = 1;
+        while ((std::max(width, height) >> levels) > 0)
+        {
+            levels++;
+        }
+        return levels;
+    }
+
+    // Fills the rest of a layer by repeating the texture's last column and row, so filtering and mips
+    // near its edges blend with the texture itself instead of whatever the layer held before.
+    static std::vector<uint8_t> PadToLayer(std::span<const uint8_t> pixels, uint32 width, uint32 height, uint32 bytesPerPixel, uint32 layerWidth, uint32 layerHeight)
+    {
+        std::vector<uint8_t> padded((size_t)layerWidth * layerHeight * bytesPerPixel);
+        const auto rowSize = (size_t)width * bytesPerPixel;
+        const auto layerRowSize = (size_t)layerWidth * bytesPerPixel;
+        if (width == 0 || height == 0 || pixels.size() < rowSize * height)
+        {
+            return padded;
+        }
+        for (uint32 y = 0; y < layerHeight; y++)
+        {
+            const auto* source = pixels.data() + std::min(y, height - 1) * rowSize;
+            auto* destination = padded.data() + y * layerRowSize;
+            std::memcpy(destination, source, rowSize);
+            for (uint32 x = width; x < layerWidth; x++)
+            {
+                std::memcpy(destination + (size_t)x * bytesPerPixel, source + rowSize - bytesPerPixel, bytesPerPixel);
+            }
+        }
+        return padded;
+    }
+
     /////// OpenGLTexture ///////////////////////////////////
 
-    OpenGLTexture::OpenGLTexture(const Texture& tex)
+    OpenGLTexture::OpenGLTexture(const Texture& tex, OpenGLStateCache& state, OpenGLTextureUploader& uploader)
+        : _state(state)
+        , _uploader(uploader)
     {
         // Generate texture
-        auto id = static_cast<uint32>(RenderId);
-        glCreateTextures(GL_TEXTURE_2D, 1, &id);
-        glGenTextures(1, &id);
-        glBindTexture(GL_TEXTURE_2D, id);
+        auto id = _state.GetNamePool().AcquireTexture(GL_TEXTURE_2D);
         RenderId = id;
 
         // Convert tbx texture to OpenGL texture
         GlTextureFormat format = TbxTexFormatToGLTexFormat(tex);
-        auto filtering = TbxTexFilterToGLTexFilter(tex);
-        auto wrapping = TbxTexWrapToGLTexWrap(tex);
+        auto filtering = TbxTexFilterToGLTexFilter(tex.Filter);
+        auto wrapping = TbxTexWrapToGLTexWrap(tex.Wrap);
         glTextureParameteri(RenderId, GL_TEXTURE_MIN_FILTER, filtering);
         glTextureParameteri(RenderId, GL_TEXTURE_MAG_FILTER, filtering);
         glTextureParameteri(RenderId, GL_TEXTURE_WRAP_S, wrapping);
         glTextureParameteri(RenderId, GL_TEXTURE_WRAP_T, wrapping);
 
-        // Upload texture data to GPU
-        glTexImage2D(GL_TEXTURE_2D, 0, format.InternalFormat, tex.Resolution.Width, tex.Resolution.Height, 0, format.DataFormat, GL_UNSIGNED_BYTE, tex.Pixels.data());
-        glGenerateMipmap(GL_TEXTURE_2D);
+        // Immutable storage for the whole mip chain, the driver never has to revalidate its completeness
+        const auto width = tex.Resolution.Width;
+        const auto height = tex.Resolution.Height;
+        const auto levelCount = GetMipLevelCount(width, height);
+        glTextureStorage2D(RenderId, levelCount, format.InternalFormat, width, height);
+        _state.GetMemoryTracker().Track(GpuMemoryType::Texture, id, OpenGLMemoryTracker::GetTextureSize(format.InternalFormat, width, height, levelCount));
+
+        // Queue texture data for upload to GPU
+        const auto bytesPerPixel = format.DataFormat == GL_RGBA ? 4u : 3u;
+        _uploader.Queue(id, 0, width, height, format.DataFormat, bytesPerPixel, tex.Pixels, true);
+    }
+
+    OpenGLTexture::OpenGLTexture(const CompressedTexture& tex, TextureFilter filter, TextureWrap wrap, OpenGLStateCache& state, OpenGLTextureUploader& uploader)
+        : _state(state)
+        , _uploader(uploader)
+    {
+        TBX_ASSERT(!tex.Levels.empty(), "GL Rendering: Compressed texture has no levels!");
+
+        // Generate texture
+        auto id = _state.GetNamePool().AcquireTexture(GL_TEXTURE_2D);
+        RenderId = id;
+
+        // The mip chain comes with the data, so sample it rather than generating our own
+        const auto levelCount = (uint32)tex.Levels.size();
+        auto filtering = TbxTexFilterToGLTexFilter(filter);
+        auto minFiltering = filtering;
+        if (levelCount > 1)
+        {
+            minFiltering = filtering == GL_NEAREST ? GL_NEAREST_MIPMAP_NEAREST : GL_LINEAR_MIPMAP_LINEAR;
+        }
+        auto wrapping = TbxTexWrapToGLTexWrap(wrap);
+        glTextureParameteri(RenderId, GL_TEXTURE_MIN_FILTER, minFiltering);
+        glTextureParameteri(RenderId, GL_TEXTURE_MAG_FILTER, filtering);
+        glTextureParameteri(RenderId, GL_TEXTURE_WRAP_S, wrapping);
+        glTextureParameteri(RenderId, GL_TEXTURE_WRAP_T, wrapping);
+        glTextureParameteri(RenderId, GL_TEXTURE_MAX_LEVEL, (GLint)levelCount - 1);
+
+        // Formats the driver can't sample are decoded on the CPU instead
+        if (!IsCompressedFormatSupported(tex.InternalFormat))
+        {
+            const auto decoded = DecodeCompressedTexture(tex);
+            TBX_ASSERT(decoded, "GL Rendering: Compressed texture format is not supported by the driver!");
+            if (decoded)
+            {
+                glTextureStorage2D(RenderId, levelCount, decoded->InternalFormat, decoded->Width, decoded->Height);
+                _state.GetMemoryTracker().Track(GpuMemoryType::Texture, id, OpenGLMemoryTracker::GetTextureSize(decoded->InternalFormat, decoded->Width, decoded->Height, levelCount));
+                for (uint32 level = 0; level < levelCount; level++)
+                {
+                    const auto& mip = decoded->Levels[level];
+                    const auto pixels = std::span(decoded->Data).subspan(mip.Offset, mip.Size);
+                    _uploader.Queue(id, level, mip.Width, mip.Height, GL_RGBA, 4, pixels, false);
+                }
+            }
+            return;
+        }
+
+        const auto blockSize = GetCompressedBlockSize(tex.InternalFormat);
+        glTextureStorage2D(RenderId, levelCount, tex.InternalFormat, tex.Width, tex.Height);
+        _state.GetMemoryTracker().Track(GpuMemoryType::Texture, id, OpenGLMemoryTracker::GetTextureSize(tex.InternalFormat, tex.Width, tex.Height, levelCount));
+        for (uint32 level = 0; level < levelCount; level++)
+        {
+            const auto& mip = tex.Levels[level];
+            const auto blocks = std::span(tex.Data).subspan(mip.Offset, mip.Size);
+            _uploader.QueueCompressed(id, level, mip.Width, mip.Height, tex.InternalFormat, blockSize, blocks);
+        }
     }
 
     OpenGLTexture::~OpenGLTexture()
     {
         auto id = static_cast<uint32>(RenderId);
-        glDeleteTextures(1, &id);
+        _uploader.Cancel(id);
+        _state.GetMemoryTracker().Untrack(GpuMemoryType::Texture, id);
+        _state.OnTextureDeleted(id);
+        _state.GetNamePool().ReleaseTexture(id);
+    }
+
+    bool OpenGLTexture::IsUploaded() const
+    {
+        return !_uploader.IsPending((uint32)RenderId);
     }
 
     void OpenGLTexture::SetSlot(uint32 slot)
@@ -106,11 +213,90 @@ namespace Tbx::Plugins::OpenGLRendering
 
     void OpenGLTexture::Activate()
     {
-        glBindTextureUnit(_slot, RenderId);
+        _state.BindTextureUnit(_slot, (uint32)RenderId);
     }
 
     void OpenGLTexture::Release()
     {
-        glBindTextureUnit(_slot, 0);
+        if (_state.IsStrictMode())
+        {
+            _state.BindTextureUnit(_slot, 0);
+        }
+    }
+
+    /////// OpenGLArrayTexture ///////////////////////////////////
+
+    OpenGLArrayTexture::OpenGLArrayTexture(const Texture& tex, OpenGLTextureArrayPool& pool, OpenGLStateCache& state, OpenGLTextureUploader& uploader)
+        : _pool(pool)
+        , _state(state)
+        , _uploader(uploader)
+    {
+        const auto& format = _pool.GetFormat();
+        const auto width = tex.Resolution.Width;
+        const auto height = tex.Resolution.Height;
+        TBX_ASSERT(width <= format.Width && height <= format.Height, "GL Rendering: Texture doesn't fit the layers of its array pool!");
+
+        _layer = _pool.Allocate();
+        RenderId = _pool.GetArrayGLId(_layer.Array);
+        _uvScale = { (float)width / (float)format.Width, (float)height / (float)format.Height };
+
+        // Queue texture data for upload to our layer, covering all of it so no texels of a previous owner remain
+        if (width == format.Width && height == format.Height)
+        {
+            _uploader.Queue((uint32)RenderId, 0, width, height, format.DataFormat, format.BytesPerPixel, tex.Pixels, true, _layer.Layer);
+        }
+        else
+        {
+            const auto padded = PadToLayer(tex.Pixels, width, height, format.BytesPerPixel, format.Width, format.Height);
+            _uploader.Queue((uint32)RenderId, 0, format.Width, format.Height, format.DataFormat, format.BytesPerPixel, padded, true, _layer.Layer);
+        }
+    }
+
+    OpenGLArrayTexture::~OpenGLArrayTexture()
+    {
+        // The array is shared, only our layer goes away
+        _uploader.Cancel((uint32)RenderId, _layer.Layer);
+        _pool.Free(_layer);
+    }
+
+    TextureArrayFormat OpenGLArrayTexture::GetArrayFormat(const Texture& tex)
+    {
+        const auto glFormat = TbxTexFormatToGLTexFormat(tex);
+        const auto filtering = (uint32)TbxTexFilterToGLTexFilter(tex.Filter);
+
+        TextureArrayFormat format = {};
+        format.InternalFormat = glFormat.InternalFormat;
+        format.DataFormat = glFormat.DataFormat;
+        format.BytesPerPixel = glFormat.DataFormat == GL_RGBA ? 4u : 3u;
+        format.Width = OpenGLTextureArrayPool::GetSizeClass(tex.Resolution.Width);
+        format.Height = OpenGLTextureArrayPool::GetSizeClass(tex.Resolution.Height);
+        format.Levels = GetMipLevelCount(format.Width, format.Height);
+        format.MinFilter = filtering;
+        format.MagFilter = filtering;
+        format.Wrap = (uint32)TbxTexWrapToGLTexWrap(tex.Wrap);
+        return format;
+    }
+
+    bool OpenGLArrayTexture::IsUploaded() const
+    {
+        return !_uploader.IsPending((uint32)RenderId, _layer.Layer);
+    }
+
+    void OpenGLArrayTexture::SetSlot(uint32 slot)
+    {
+        _slot = slot;
+    }
+
+    void OpenGLArrayTexture::Activate()
+    {
+        _state.BindTextureUnit(_slot, (uint32)RenderId);
+    }
+
+    void OpenGLArrayTexture::Release()
+    {
+        if (_state.IsStrictMode())
+        {
+            _state.BindTextureUnit(_slot, 0);
+        }
     }
-}
\ No newline at end of file
+}
@@ -1,13 +1,21 @@
 #pragma once
+#include "OpenGLStateCache.h"
+#include "OpenGLTextureArrayPool.h"
+#include "OpenGLTextureContainer.h"
+#include "OpenGLTextureUploader.h"
 #include <Tbx/Graphics/GraphicsResources.h>
 #include <Tbx/Graphics/Texture.h>
+#include <Tbx/Math/Vectors.h>
 
 namespace Tbx::Plugins::OpenGLRendering
 {
     class OpenGLTexture final : public TextureResource
     {
     public:
-        OpenGLTexture(const Texture& tex);
+        // Storage is allocated immutably right away, the pixels are streamed in by the uploader over the coming frames.
+        OpenGLTexture(const Texture& tex, OpenGLStateCache& state, OpenGLTextureUploader& uploader);
+        // Keeps the data compressed in VRAM and uploads every level it comes with.
+        OpenGLTexture(const CompressedTexture& tex, TextureFilter filter, TextureWrap wrap, OpenGLStateCache& state, OpenGLTextureUploader& uploader);
         ~OpenGLTexture() override;
 
         void SetSlot(uint32 slot) override;
@@ -15,8 +23,45 @@ namespace Tbx::Plugins::OpenGLRendering
         void Activate() override;
         void Release() override;
 
+        // False while pixels or mips are still waiting to be uploaded, sampling it until then reads undefined texels.
+        bool IsUploaded() const;
+
     private:
+        OpenGLStateCache& _state;
+        OpenGLTextureUploader& _uploader;
         uint _slot = 0;
     };
-}
 
+    // Texture living in a layer of a shared OpenGLTextureArrayPool array instead of owning its own texture.
+    // RenderId is the array, shaders sample it as a sampler2DArray at GetLayer() and scale their UVs by GetUvScale(),
+    // since the layer may be bigger than the texture. Repeat wrapping only works for textures that fill their layer.
+    class OpenGLArrayTexture final : public TextureResource
+    {
+    public:
+        OpenGLArrayTexture(const Texture& tex, OpenGLTextureArrayPool& pool, OpenGLStateCache& state, OpenGLTextureUploader& uploader);
+        ~OpenGLArrayTexture() override;
+
+        // Format of the pool the texture belongs in.
+        static TextureArrayFormat GetArrayFormat(const Texture& tex);
+
+        void SetSlot(uint32 slot) override;
+
+        void Activate() override;
+        void Release() override;
+
+        bool IsUploaded() const;
+
+        OpenGLTextureArrayPool& GetPool() const { return _pool; }
+        uint32 GetArrayGLId() const { return (uint32)RenderId; }
+        uint32 GetLayer() const { return _layer.Layer; }
+        const Vector2& GetUvScale() const { return _uvScale; }
+
+    private:
+        OpenGLTextureArrayPool& _pool;
+        OpenGLStateCache& _state;
+        OpenGLTextureUploader& _uploader;
+        OpenGLTextureLayer _layer = {};
+        Vector2 _uvScale = {};
+        uint _slot = 0;
+    };
+}
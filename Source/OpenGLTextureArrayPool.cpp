@@ -0,0 +1,104 @@
+#include "OpenGLTextureArrayPool.h"
+#include "OpenGLHash.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <bit>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    OpenGLTextureArrayPool::OpenGLTextureArrayPool(const TextureArrayFormat& format, OpenGLStateCache& state)
+        : _state(state)
+        , _format(format)
+    {
+        // Big layers get fewer of them so a single array doesn't grab an unreasonable amount of memory
+        GLint maxLayers = 0;
+        glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+        const auto layerBytes = std::max(format.Width * format.Height * format.BytesPerPixel, 1u);
+        _layersPerArray = std::clamp(DefaultArrayBytes / layerBytes, 1u, std::min(DefaultMaxLayers, (uint32)std::max(maxLayers, 1)));
+    }
+
+    OpenGLTextureArrayPool::~OpenGLTextureArrayPool()
+    {
+        for (auto& array : _arrays)
+        {
+            _state.GetMemoryTracker().Untrack(GpuMemoryType::TextureArray, array.TextureGLId);
+            _state.OnTextureDeleted(array.TextureGLId);
+            glDeleteTextures(1, &array.TextureGLId);
+        }
+    }
+
+    uint64_t OpenGLTextureArrayPool::HashFormat(const TextureArrayFormat& format)
+    {
+        // FNV-1a over everything textures have to agree on to share an array
+        auto hash = HashSeed;
+        const auto mix = [&hash](uint64_t value) { hash = HashCombine(hash, value); };
+
+        mix(format.InternalFormat);
+        mix(format.DataFormat);
+        mix(format.Width);
+        mix(format.Height);
+        mix(format.Levels);
+        mix(format.MinFilter);
+        mix(format.MagFilter);
+        mix(format.Wrap);
+        return hash;
+    }
+
+    uint32 OpenGLTextureArrayPool::GetSizeClass(uint32 size)
+    {
+        return std::bit_ceil(std::max(size, 1u));
+    }
+
+    OpenGLTextureLayer OpenGLTextureArrayPool::Allocate()
+    {
+        for (uint32 arrayIndex = 0; arrayIndex <= (uint32)_arrays.size(); arrayIndex++)
+        {
+            if (arrayIndex == _arrays.size())
+            {
+                AddArray();
+            }
+
+            if (const auto layer = _arrays[arrayIndex].Layers.Allocate(1))
+            {
+                return { arrayIndex, *layer };
+            }
+        }
+
+        TBX_ASSERT(false, "GL Rendering: Failed to allocate texture array layer!");
+        return {};
+    }
+
+    void OpenGLTextureArrayPool::Free(const OpenGLTextureLayer& layer)
+    {
+        if (layer.Array >= _arrays.size())
+        {
+            return;
+        }
+
+        // Zero every level so nothing of the old texture is sampled from the layer before it's overwritten
+        for (uint32 level = 0; level < _format.Levels; level++)
+        {
+            const auto width = std::max(_format.Width >> level, 1u);
+            const auto height = std::max(_format.Height >> level, 1u);
+            glClearTexSubImage(_arrays[layer.Array].TextureGLId, level, 0, 0, (int)layer.Layer, width, height, 1, _format.DataFormat, GL_UNSIGNED_BYTE, nullptr);
+        }
+        _arrays[layer.Array].Layers.Free(layer.Layer, 1);
+    }
+
+    void OpenGLTextureArrayPool::AddArray()
+    {
+        Array array = {};
+        glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &array.TextureGLId);
+        glTextureParameteri(array.TextureGLId, GL_TEXTURE_MIN_FILTER, _format.MinFilter);
+        glTextureParameteri(array.TextureGLId, GL_TEXTURE_MAG_FILTER, _format.MagFilter);
+        glTextureParameteri(array.TextureGLId, GL_TEXTURE_WRAP_S, _format.Wrap);
+        glTextureParameteri(array.TextureGLId, GL_TEXTURE_WRAP_T, _format.Wrap);
+        glTextureStorage3D(array.TextureGLId, _format.Levels, _format.InternalFormat, _format.Width, _format.Height, _layersPerArray);
+        const auto sizeInBytes = OpenGLMemoryTracker::GetTextureSize(_format.InternalFormat, _format.Width, _format.Height, _format.Levels, _layersPerArray);
+        _state.GetMemoryTracker().Track(GpuMemoryType::TextureArray, array.TextureGLId, sizeInBytes);
+
+        array.Layers = OpenGLFreeListAllocator(_layersPerArray);
+        _arrays.push_back(std::move(array));
+    }
+}
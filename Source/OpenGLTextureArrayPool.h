@@ -0,0 +1,69 @@
+#pragma once
+#include "OpenGLFreeListAllocator.h"
+#include "OpenGLStateCache.h"
+#include <Tbx/Math/Int.h>
+#include <cstdint>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Everything textures must share to live in the same array.
+    struct TextureArrayFormat
+    {
+        uint32 InternalFormat = 0;
+        uint32 DataFormat = 0;
+        uint32 BytesPerPixel = 0;
+        uint32 Width = 0;
+        uint32 Height = 0;
+        uint32 Levels = 1;
+        uint32 MinFilter = 0;
+        uint32 MagFilter = 0;
+        uint32 Wrap = 0;
+    };
+
+    struct OpenGLTextureLayer
+    {
+        uint32 Array = 0;
+        uint32 Layer = 0;
+    };
+
+    // Packs textures of one format and size class into the layers of shared 2D array textures,
+    // so draws that only differ by texture can share one binding and pick their layer in the shader.
+    class OpenGLTextureArrayPool final
+    {
+    public:
+        static constexpr uint32 DefaultArrayBytes = 32 * 1024 * 1024;
+        static constexpr uint32 DefaultMaxLayers = 256;
+
+        OpenGLTextureArrayPool(const TextureArrayFormat& format, OpenGLStateCache& state);
+        ~OpenGLTextureArrayPool();
+
+        static uint64_t HashFormat(const TextureArrayFormat& format);
+        // Textures are rounded up to the next power of two in each dimension to find their layer size.
+        static uint32 GetSizeClass(uint32 size);
+
+        const TextureArrayFormat& GetFormat() const { return _format; }
+        uint32 GetArrayCount() const { return (uint32)_arrays.size(); }
+        uint32 GetLayersPerArray() const { return _layersPerArray; }
+        uint32 GetArrayGLId(uint32 array) const { return _arrays[array].TextureGLId; }
+
+        // Finds a free layer, adding a new array if all existing ones are full.
+        OpenGLTextureLayer Allocate();
+        void Free(const OpenGLTextureLayer& layer);
+
+    private:
+        struct Array
+        {
+            uint32 TextureGLId = 0;
+            OpenGLFreeListAllocator Layers = {};
+        };
+
+        void AddArray();
+
+    private:
+        OpenGLStateCache& _state;
+        TextureArrayFormat _format = {};
+        uint32 _layersPerArray = 1;
+        std::vector<Array> _arrays = {};
+    };
+}
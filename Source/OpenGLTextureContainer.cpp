@@ -0,0 +1,393 @@
+#include "OpenGLTextureContainer.h"
+#include <Tbx/Debug/Tracers.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    /// Formats ///////////////////////////////////////////////////////////
+
+    // Spelled out rather than taken from glad, which only defines the extension ones when generated with them
+    static constexpr uint32 GlRgbBc1 = 0x83F0;
+    static constexpr uint32 GlRgbaBc1 = 0x83F1;
+    static constexpr uint32 GlRgbaBc3 = 0x83F3;
+    static constexpr uint32 GlSrgbBc1 = 0x8C4C;
+    static constexpr uint32 GlSrgbAlphaBc1 = 0x8C4D;
+    static constexpr uint32 GlSrgbAlphaBc3 = 0x8C4F;
+    static constexpr uint32 GlRgBc5 = 0x8DBD;
+    static constexpr uint32 GlSignedRgBc5 = 0x8DBE;
+    static constexpr uint32 GlRgbaBc7 = 0x8E8C;
+    static constexpr uint32 GlSrgbAlphaBc7 = 0x8E8D;
+    static constexpr uint32 GlRgbEtc2 = 0x9274;
+    static constexpr uint32 GlSrgbEtc2 = 0x9275;
+    static constexpr uint32 GlRgbA1Etc2 = 0x9276;
+    static constexpr uint32 GlSrgbA1Etc2 = 0x9277;
+    static constexpr uint32 GlRgbaEtc2 = 0x9278;
+    static constexpr uint32 GlSrgbAlphaEtc2 = 0x9279;
+
+    struct CompressedFormatInfo
+    {
+        uint32 GlFormat = 0;
+        uint32 VkFormat = 0;
+        uint32 DxgiFormat = 0;
+        uint32 BlockSize = 0;
+    };
+
+    // Vulkan formats are what KTX2 stores, DXGI formats what DX10 DDS headers store (0 when it has none)
+    static constexpr std::array<CompressedFormatInfo, 16> CompressedFormats =
+    { {
+        { GlRgbBc1, 131, 0, 8 },
+        { GlSrgbBc1, 132, 0, 8 },
+        { GlRgbaBc1, 133, 71, 8 },
+        { GlSrgbAlphaBc1, 134, 72, 8 },
+        { GlRgbaBc3, 137, 77, 16 },
+        { GlSrgbAlphaBc3, 138, 78, 16 },
+        { GlRgBc5, 141, 83, 16 },
+        { GlSignedRgBc5, 142, 84, 16 },
+        { GlRgbaBc7, 145, 98, 16 },
+        { GlSrgbAlphaBc7, 146, 99, 16 },
+        { GlRgbEtc2, 147, 0, 8 },
+        { GlSrgbEtc2, 148, 0, 8 },
+        { GlRgbA1Etc2, 149, 0, 8 },
+        { GlSrgbA1Etc2, 150, 0, 8 },
+        { GlRgbaEtc2, 151, 0, 16 },
+        { GlSrgbAlphaEtc2, 152, 0, 16 },
+    } };
+
+    static const CompressedFormatInfo* FindFormat(uint32 CompressedFormatInfo::* key, uint32 value)
+    {
+        const auto it = std::find_if(CompressedFormats.begin(), CompressedFormats.end(), [&](const CompressedFormatInfo& info) { return info.*key == value; });
+        return it != CompressedFormats.end() ? &*it : nullptr;
+    }
+
+    uint32 GetCompressedBlockSize(uint32 internalFormat)
+    {
+        const auto* info = FindFormat(&CompressedFormatInfo::GlFormat, internalFormat);
+        return info ? info->BlockSize : 0;
+    }
+
+    bool IsCompressedFormatSupported(uint32 internalFormat)
+    {
+        switch (internalFormat)
+        {
+            case GlRgbBc1:
+            case GlRgbaBc1:
+            case GlRgbaBc3:
+            case GlSrgbBc1:
+            case GlSrgbAlphaBc1:
+            case GlSrgbAlphaBc3:
+                return GLAD_GL_EXT_texture_compression_s3tc;
+            default:
+                // RGTC, BPTC and ETC2 are core by 4.5
+                return GetCompressedBlockSize(internalFormat) != 0;
+        }
+    }
+
+    static uint32 GetLevelSize(uint32 width, uint32 height, uint32 blockSize)
+    {
+        return ((width + 3) / 4) * ((height + 3) / 4) * blockSize;
+    }
+
+    // Lays out the chain of tightly packed levels starting at offset, fails if the data doesn't cover it
+    static bool BuildLevels(CompressedTexture& texture, uint32 levelCount, uint32 blockSize, size_t offset)
+    {
+        auto width = texture.Width;
+        auto height = texture.Height;
+        for (uint32 level = 0; level < levelCount; level++)
+        {
+            const auto size = GetLevelSize(width, height, blockSize);
+            if (offset + size > texture.Data.size())
+            {
+                return false;
+            }
+            texture.Levels.push_back({ width, height, (uint32)offset, size });
+            offset += size;
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        return true;
+    }
+
+    template <typename T>
+    static T ReadValue(std::span<const uint8_t> bytes, size_t offset)
+    {
+        T value = {};
+        std::memcpy(&value, bytes.data() + offset, sizeof(T));
+        return value;
+    }
+
+    /// DDS ///////////////////////////////////////////////////////////////
+
+    static constexpr uint32 MakeFourCC(char a, char b, char c, char d)
+    {
+        return (uint32)a | ((uint32)b << 8) | ((uint32)c << 16) | ((uint32)d << 24);
+    }
+
+    std::optional<CompressedTexture> ReadDdsTexture(std::span<const uint8_t> bytes)
+    {
+        // Magic, then a 124 byte header with the pixel format at 76
+        constexpr size_t headerOffset = 4;
+        constexpr size_t headerSize = 124;
+        constexpr size_t dx10HeaderSize = 20;
+        constexpr uint32 pixelFormatFourCCFlag = 0x4;
+        if (bytes.size() < headerOffset + headerSize || ReadValue<uint32>(bytes, 0) != MakeFourCC('D', 'D', 'S', ' '))
+        {
+            return std::nullopt;
+        }
+
+        CompressedTexture texture = {};
+        texture.Height = ReadValue<uint32>(bytes, headerOffset + 8);
+        texture.Width = ReadValue<uint32>(bytes, headerOffset + 12);
+        const auto levelCount = std::max(ReadValue<uint32>(bytes, headerOffset + 24), 1u);
+        const auto pixelFormatFlags = ReadValue<uint32>(bytes, headerOffset + 76);
+        const auto fourCC = ReadValue<uint32>(bytes, headerOffset + 80);
+        if (!(pixelFormatFlags & pixelFormatFourCCFlag))
+        {
+            TBX_TRACE_ERROR("GL Rendering: Only block compressed DDS textures are supported!");
+            return std::nullopt;
+        }
+
+        auto dataOffset = headerOffset + headerSize;
+        const CompressedFormatInfo* format = nullptr;
+        if (fourCC == MakeFourCC('D', 'X', '1', '0'))
+        {
+            // Extended header: dxgi format, resource dimension, misc flags, array size
+            if (bytes.size() < dataOffset + dx10HeaderSize || ReadValue<uint32>(bytes, dataOffset + 12) > 1)
+            {
+                TBX_TRACE_ERROR("GL Rendering: DDS texture arrays are not supported!");
+                return std::nullopt;
+            }
+            format = FindFormat(&CompressedFormatInfo::DxgiFormat, ReadValue<uint32>(bytes, dataOffset));
+            dataOffset += dx10HeaderSize;
+        }
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '1'))
+        {
+            format = FindFormat(&CompressedFormatInfo::GlFormat, GlRgbaBc1);
+        }
+        else if (fourCC == MakeFourCC('D', 'X', 'T', '5'))
+        {
+            format = FindFormat(&CompressedFormatInfo::GlFormat, GlRgbaBc3);
+        }
+        else if (fourCC == MakeFourCC('A', 'T', 'I', '2') || fourCC == MakeFourCC('B', 'C', '5', 'U'))
+        {
+            format = FindFormat(&CompressedFormatInfo::GlFormat, GlRgBc5);
+        }
+
+        if (!format)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Unsupported DDS texture format!");
+            return std::nullopt;
+        }
+
+        texture.InternalFormat = format->GlFormat;
+        texture.Data.assign(bytes.begin() + dataOffset, bytes.end());
+        if (!BuildLevels(texture, levelCount, format->BlockSize, 0))
+        {
+            TBX_TRACE_ERROR("GL Rendering: DDS texture is truncated!");
+            return std::nullopt;
+        }
+        return texture;
+    }
+
+    /// KTX2 //////////////////////////////////////////////////////////////
+
+    std::optional<CompressedTexture> ReadKtx2Texture(std::span<const uint8_t> bytes)
+    {
+        // Identifier, 9 header fields, the data format/key value/supercompression index, then one entry per level
+        constexpr std::array<uint8_t, 12> identifier = { 0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n' };
+        constexpr size_t headerOffset = 12;
+        constexpr size_t levelIndexOffset = 80;
+        constexpr size_t levelIndexEntrySize = 24;
+        if (bytes.size() < levelIndexOffset || !std::equal(identifier.begin(), identifier.end(), bytes.begin()))
+        {
+            return std::nullopt;
+        }
+
+        const auto vkFormat = ReadValue<uint32>(bytes, headerOffset);
+        const auto pixelDepth = ReadValue<uint32>(bytes, headerOffset + 16);
+        const auto layerCount = ReadValue<uint32>(bytes, headerOffset + 20);
+        const auto faceCount = ReadValue<uint32>(bytes, headerOffset + 24);
+        const auto levelCount = std::max(ReadValue<uint32>(bytes, headerOffset + 28), 1u);
+        const auto supercompression = ReadValue<uint32>(bytes, headerOffset + 32);
+        if (pixelDepth > 1 || layerCount > 1 || faceCount != 1)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Only 2D KTX2 textures are supported!");
+            return std::nullopt;
+        }
+        if (supercompression != 0)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Supercompressed KTX2 textures are not supported!");
+            return std::nullopt;
+        }
+
+        const auto* format = FindFormat(&CompressedFormatInfo::VkFormat, vkFormat);
+        if (!format)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Unsupported KTX2 texture format!");
+            return std::nullopt;
+        }
+        if (bytes.size() < levelIndexOffset + levelCount * levelIndexEntrySize)
+        {
+            TBX_TRACE_ERROR("GL Rendering: KTX2 texture is truncated!");
+            return std::nullopt;
+        }
+
+        CompressedTexture texture = {};
+        texture.InternalFormat = format->GlFormat;
+        texture.Width = ReadValue<uint32>(bytes, headerOffset + 8);
+        texture.Height = std::max(ReadValue<uint32>(bytes, headerOffset + 12), 1u);
+
+        // Levels are stored smallest first in the file but indexed largest first, repack them in index order
+        auto width = texture.Width;
+        auto height = texture.Height;
+        for (uint32 level = 0; level < levelCount; level++)
+        {
+            const auto entry = levelIndexOffset + level * levelIndexEntrySize;
+            const auto offset = ReadValue<uint64_t>(bytes, entry);
+            const auto size = ReadValue<uint64_t>(bytes, entry + 8);
+            if (size != GetLevelSize(width, height, format->BlockSize) || offset + size > bytes.size())
+            {
+                TBX_TRACE_ERROR("GL Rendering: KTX2 texture is truncated!");
+                return std::nullopt;
+            }
+
+            texture.Levels.push_back({ width, height, (uint32)texture.Data.size(), (uint32)size });
+            texture.Data.insert(texture.Data.end(), bytes.begin() + offset, bytes.begin() + offset + size);
+            width = std::max(width / 2, 1u);
+            height = std::max(height / 2, 1u);
+        }
+        return texture;
+    }
+
+    std::optional<CompressedTexture> LoadCompressedTexture(const std::filesystem::path& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            TBX_TRACE_ERROR("GL Rendering: Failed to open texture {0}!", path.string());
+            return std::nullopt;
+        }
+        const std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+        if (bytes.size() >= 4 && ReadValue<uint32>(bytes, 0) == MakeFourCC('D', 'D', 'S', ' '))
+        {
+            return ReadDdsTexture(bytes);
+        }
+        return ReadKtx2Texture(bytes);
+    }
+
+    /// Decoding //////////////////////////////////////////////////////////
+
+    static std::array<uint8_t, 4> ExpandRgb565(uint16_t color)
+    {
+        const auto r = (uint8_t)((color >> 11) & 0x1F);
+        const auto g = (uint8_t)((color >> 5) & 0x3F);
+        const auto b = (uint8_t)(color & 0x1F);
+        return { (uint8_t)((r << 3) | (r >> 2)), (uint8_t)((g << 2) | (g >> 4)), (uint8_t)((b << 3) | (b >> 2)), 255 };
+    }
+
+    // Decodes a BC1 colour block into 16 RGBA texels, BC3 colour blocks never use the punch through alpha mode
+    static void DecodeColorBlock(const uint8_t* block, bool allowPunchThrough, uint8_t* texels)
+    {
+        const auto c0 = ReadValue<uint16_t>({ block, 2 }, 0);
+        const auto c1 = ReadValue<uint16_t>({ block + 2, 2 }, 0);
+        const auto indices = ReadValue<uint32>({ block + 4, 4 }, 0);
+
+        std::array<std::array<uint8_t, 4>, 4> palette = { ExpandRgb565(c0), ExpandRgb565(c1) };
+        const bool fourColors = c0 > c1 || !allowPunchThrough;
+        for (int channel = 0; channel < 3; channel++)
+        {
+            const int a = palette[0][channel];
+            const int b = palette[1][channel];
+            palette[2][channel] = (uint8_t)(fourColors ? (2 * a + b) / 3 : (a + b) / 2);
+            palette[3][channel] = (uint8_t)(fourColors ? (a + 2 * b) / 3 : 0);
+        }
+        palette[2][3] = 255;
+        palette[3][3] = fourColors ? 255 : 0;
+
+        for (int texel = 0; texel < 16; texel++)
+        {
+            std::memcpy(texels + texel * 4, palette[(indices >> (texel * 2)) & 0x3].data(), 4);
+        }
+    }
+
+    static void DecodeAlphaBlock(const uint8_t* block, uint8_t* texels)
+    {
+        const int a0 = block[0];
+        const int a1 = block[1];
+        std::array<uint8_t, 8> palette = { (uint8_t)a0, (uint8_t)a1 };
+        if (a0 > a1)
+        {
+            for (int i = 1; i < 7; i++) palette[i + 1] = (uint8_t)(((7 - i) * a0 + i * a1) / 7);
+        }
+        else
+        {
+            for (int i = 1; i < 5; i++) palette[i + 1] = (uint8_t)(((5 - i) * a0 + i * a1) / 5);
+            palette[6] = 0;
+            palette[7] = 255;
+        }
+
+        uint64_t indices = 0;
+        std::memcpy(&indices, block + 2, 6);
+        for (int texel = 0; texel < 16; texel++)
+        {
+            texels[texel * 4 + 3] = palette[(indices >> (texel * 3)) & 0x7];
+        }
+    }
+
+    std::optional<CompressedTexture> DecodeCompressedTexture(const CompressedTexture& texture)
+    {
+        const auto format = texture.InternalFormat;
+        const bool isBc1 = format == GlRgbBc1 || format == GlRgbaBc1 || format == GlSrgbBc1 || format == GlSrgbAlphaBc1;
+        const bool isBc3 = format == GlRgbaBc3 || format == GlSrgbAlphaBc3;
+        if (!isBc1 && !isBc3)
+        {
+            return std::nullopt;
+        }
+
+        const bool isSrgb = format == GlSrgbBc1 || format == GlSrgbAlphaBc1 || format == GlSrgbAlphaBc3;
+        const auto blockSize = GetCompressedBlockSize(format);
+
+        CompressedTexture decoded = {};
+        decoded.InternalFormat = isSrgb ? GL_SRGB8_ALPHA8 : GL_RGBA8;
+        decoded.Width = texture.Width;
+        decoded.Height = texture.Height;
+        for (const auto& level : texture.Levels)
+        {
+            const auto levelOffset = (uint32)decoded.Data.size();
+            const auto levelSize = level.Width * level.Height * 4;
+            decoded.Levels.push_back({ level.Width, level.Height, levelOffset, levelSize });
+            decoded.Data.resize(levelOffset + levelSize);
+
+            const auto* block = texture.Data.data() + level.Offset;
+            for (uint32 blockY = 0; blockY < level.Height; blockY += 4)
+            {
+                for (uint32 blockX = 0; blockX < level.Width; blockX += 4, block += blockSize)
+                {
+                    std::array<uint8_t, 16 * 4> texels = {};
+                    if (isBc3)
+                    {
+                        DecodeColorBlock(block + 8, false, texels.data());
+                        DecodeAlphaBlock(block, texels.data());
+                    }
+                    else
+                    {
+                        DecodeColorBlock(block, true, texels.data());
+                    }
+
+                    // Blocks overhang levels that aren't a multiple of 4 in size
+                    for (uint32 y = 0; y < 4 && blockY + y < level.Height; y++)
+                    {
+                        const auto columns = std::min(4u, level.Width - blockX);
+                        auto* row = decoded.Data.data() + levelOffset + ((blockY + y) * level.Width + blockX) * 4;
+                        std::memcpy(row, texels.data() + y * 16, columns * 4);
+                    }
+                }
+            }
+        }
+        return decoded;
+    }
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <Tbx/Math/Int.h>
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    struct CompressedMipLevel
+    {
+        uint32 Width = 0;
+        uint32 Height = 0;
+        uint32 Offset = 0;
+        uint32 Size = 0;
+    };
+
+    // Block compressed image with its mip chain, level 0 first. Data holds every level back to back.
+    struct CompressedTexture
+    {
+        uint32 InternalFormat = 0;
+        uint32 Width = 0;
+        uint32 Height = 0;
+        std::vector<CompressedMipLevel> Levels = {};
+        std::vector<uint8_t> Data = {};
+    };
+
+    // Reads BC1/BC3/BC5/BC7 from DDS, and those plus ETC2 from uncompressed (not supercompressed) KTX2.
+    // Only 2D textures are supported, returns nothing for anything else.
+    std::optional<CompressedTexture> ReadDdsTexture(std::span<const uint8_t> bytes);
+    std::optional<CompressedTexture> ReadKtx2Texture(std::span<const uint8_t> bytes);
+    // Picks the reader from the file's magic.
+    std::optional<CompressedTexture> LoadCompressedTexture(const std::filesystem::path& path);
+
+    // Bytes per 4x4 block of a compressed internal format, 0 when the format isn't one we know.
+    uint32 GetCompressedBlockSize(uint32 internalFormat);
+    // Whether the current context can sample the format without us decoding it first.
+    bool IsCompressedFormatSupported(uint32 internalFormat);
+    // Decodes BC1 and BC3 into RGBA8 (or SRGB8_ALPHA8) levels laid out like the compressed ones.
+    // Fallback for drivers without S3TC, returns nothing for other formats.
+    std::optional<CompressedTexture> DecodeCompressedTexture(const CompressedTexture& texture);
+}
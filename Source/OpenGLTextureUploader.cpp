@@ -0,0 +1,227 @@
+#include "OpenGLTextureUploader.h"
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstdint>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Chunks are written 4 byte aligned, reserve room for the padding so a frame's chunks always fit its region
+    static constexpr uint32 ChunkAlignment = 4;
+
+    OpenGLTextureUploader::OpenGLTextureUploader(OpenGLStateCache& state)
+        : _state(state)
+    {
+    }
+
+    OpenGLTextureUploader::~OpenGLTextureUploader()
+    {
+        if (_mipFramebuffers[0])
+        {
+            glDeleteFramebuffers(2, _mipFramebuffers);
+        }
+    }
+
+    void OpenGLTextureUploader::SetFrameBudget(uint32 sizeInBytes)
+    {
+        _frameBudget = std::max(sizeInBytes, ChunkAlignment * 2);
+
+        // Recreated with the new size on the next update
+        _staging.reset();
+    }
+
+    void OpenGLTextureUploader::Queue(uint32 texture, uint32 level, uint32 width, uint32 height, uint32 dataFormat, uint32 bytesPerPixel, std::span<const uint8_t> pixels, bool generateMips, uint32 layer)
+    {
+        PendingUpload upload = {};
+        upload.Texture = texture;
+        upload.Level = level;
+        upload.Layer = layer;
+        upload.Width = width;
+        upload.Height = height;
+        upload.Format = dataFormat;
+        upload.RowSize = width * bytesPerPixel;
+        upload.RowCount = height;
+        upload.GenerateMips = generateMips;
+        TBX_ASSERT(pixels.size() >= (size_t)upload.RowSize * height, "GL Rendering: Texture pixels don't cover its resolution!");
+        upload.Pixels.assign(pixels.begin(), pixels.end());
+        _uploads.push_back(std::move(upload));
+    }
+
+    void OpenGLTextureUploader::QueueCompressed(uint32 texture, uint32 level, uint32 width, uint32 height, uint32 internalFormat, uint32 blockSize, std::span<const uint8_t> blocks)
+    {
+        PendingUpload upload = {};
+        upload.Texture = texture;
+        upload.Level = level;
+        upload.Width = width;
+        upload.Height = height;
+        upload.Format = internalFormat;
+        upload.RowSize = (width + 3) / 4 * blockSize;
+        upload.RowHeight = 4;
+        upload.RowCount = (height + 3) / 4;
+        upload.IsCompressed = true;
+        TBX_ASSERT(blocks.size() >= (size_t)upload.RowSize * upload.RowCount, "GL Rendering: Compressed blocks don't cover the texture's resolution!");
+        upload.Pixels.assign(blocks.begin(), blocks.end());
+        _uploads.push_back(std::move(upload));
+    }
+
+    void OpenGLTextureUploader::Cancel(uint32 texture, uint32 layer)
+    {
+        std::erase_if(_uploads, [texture, layer](const PendingUpload& upload) { return upload.Texture == texture && (layer == NoLayer || upload.Layer == layer); });
+        std::erase_if(_pendingMips, [texture, layer](const PendingMips& mips) { return mips.Texture == texture && (layer == NoLayer || mips.Layer == layer); });
+    }
+
+    bool OpenGLTextureUploader::IsPending(uint32 texture, uint32 layer) const
+    {
+        return std::any_of(_uploads.begin(), _uploads.end(), [texture, layer](const PendingUpload& upload) { return upload.Texture == texture && (layer == NoLayer || upload.Layer == layer); })
+            || std::any_of(_pendingMips.begin(), _pendingMips.end(), [texture, layer](const PendingMips& mips) { return mips.Texture == texture && (layer == NoLayer || mips.Layer == layer); });
+    }
+
+    void OpenGLTextureUploader::Update()
+    {
+        // Mips deferred last frame, one texture a frame keeps the cost bounded
+        if (!_pendingMips.empty())
+        {
+            GenerateMips(_pendingMips.front());
+            _pendingMips.pop_front();
+        }
+
+        if (_uploads.empty())
+        {
+            return;
+        }
+
+        if (!_staging)
+        {
+            _staging = std::make_unique<OpenGLRingBuffer>(_state, _frameBudget);
+        }
+
+        auto budget = _frameBudget;
+        while (!_uploads.empty() && budget > ChunkAlignment)
+        {
+            auto& upload = _uploads.front();
+
+            // Copy as many whole rows as the budget allows, but always make progress
+            const auto remainingRows = upload.RowCount - upload.NextRow;
+            const auto affordableRows = std::max((budget - ChunkAlignment) / upload.RowSize, 1u);
+            const auto rows = std::min(remainingRows, affordableRows);
+            const auto sizeInBytes = rows * upload.RowSize;
+            const auto* pixels = upload.Pixels.data() + (size_t)upload.NextRow * upload.RowSize;
+
+            // The ring may recreate itself when a single row doesn't fit, so bind after writing
+            const auto offset = _staging->Write(pixels, sizeInBytes, ChunkAlignment);
+            _state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, _staging->GetGLId());
+            CopyRows(upload, rows, reinterpret_cast<const void*>(static_cast<uintptr_t>(offset)));
+
+            upload.NextRow += rows;
+            budget -= std::min(budget, sizeInBytes + ChunkAlignment);
+            if (upload.NextRow == upload.RowCount)
+            {
+                FinishUpload(upload);
+                _uploads.pop_front();
+            }
+        }
+
+        // Uploads from client memory elsewhere would read from the ring otherwise
+        _state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    }
+
+    void OpenGLTextureUploader::Flush()
+    {
+        _state.BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        for (const auto& upload : _uploads)
+        {
+            const auto* pixels = upload.Pixels.data() + (size_t)upload.NextRow * upload.RowSize;
+            CopyRows(upload, upload.RowCount - upload.NextRow, pixels);
+            _state.CountUpload((upload.RowCount - upload.NextRow) * upload.RowSize);
+            if (upload.GenerateMips)
+            {
+                QueueMips({ upload.Texture, upload.Layer });
+            }
+        }
+        _uploads.clear();
+
+        for (const auto& mips : _pendingMips)
+        {
+            GenerateMips(mips);
+        }
+        _pendingMips.clear();
+    }
+
+    void OpenGLTextureUploader::CopyRows(const PendingUpload& upload, uint32 rowCount, const void* data) const
+    {
+        // The last row of blocks may overhang the level, GL wants the texel height clamped to it
+        const auto y = upload.NextRow * upload.RowHeight;
+        const auto height = std::min(rowCount * upload.RowHeight, upload.Height - y);
+        if (upload.Layer != NoLayer)
+        {
+            glTextureSubImage3D(upload.Texture, upload.Level, 0, y, upload.Layer, upload.Width, height, 1, upload.Format, GL_UNSIGNED_BYTE, data);
+        }
+        else if (upload.IsCompressed)
+        {
+            glCompressedTextureSubImage2D(upload.Texture, upload.Level, 0, y, upload.Width, height, upload.Format, rowCount * upload.RowSize, data);
+        }
+        else
+        {
+            glTextureSubImage2D(upload.Texture, upload.Level, 0, y, upload.Width, height, upload.Format, GL_UNSIGNED_BYTE, data);
+        }
+    }
+
+    void OpenGLTextureUploader::FinishUpload(const PendingUpload& upload)
+    {
+        // Only generate mips after the last upload still queued for the same texture or layer.
+        // The finished upload is still at the front of the queue, hence looking for more than one.
+        const auto queuedForLayer = std::count_if(_uploads.begin(), _uploads.end(), [&upload](const PendingUpload& other) { return other.Texture == upload.Texture && other.Layer == upload.Layer && other.GenerateMips; });
+        if (!upload.GenerateMips || queuedForLayer > 1)
+        {
+            return;
+        }
+
+        if (_deferMips)
+        {
+            QueueMips({ upload.Texture, upload.Layer });
+        }
+        else
+        {
+            GenerateMips({ upload.Texture, upload.Layer });
+        }
+    }
+
+    void OpenGLTextureUploader::QueueMips(const PendingMips& mips)
+    {
+        if (std::find(_pendingMips.begin(), _pendingMips.end(), mips) == _pendingMips.end())
+        {
+            _pendingMips.push_back(mips);
+        }
+    }
+
+    void OpenGLTextureUploader::GenerateMips(const PendingMips& mips)
+    {
+        if (mips.Layer == NoLayer)
+        {
+            glGenerateTextureMipmap(mips.Texture);
+            return;
+        }
+
+        // Generating the array's mips would rebuild every layer, so halve ours one level at a time instead.
+        // Layers are power of two sized, which makes a linear blit the same box filter mip generation uses.
+        GLint width = 0;
+        GLint height = 0;
+        GLint levels = 0;
+        glGetTextureLevelParameteriv(mips.Texture, 0, GL_TEXTURE_WIDTH, &width);
+        glGetTextureLevelParameteriv(mips.Texture, 0, GL_TEXTURE_HEIGHT, &height);
+        glGetTextureParameteriv(mips.Texture, GL_TEXTURE_IMMUTABLE_LEVELS, &levels);
+        if (!_mipFramebuffers[0])
+        {
+            glCreateFramebuffers(2, _mipFramebuffers);
+        }
+
+        for (GLint level = 1; level < levels; level++)
+        {
+            const auto sourceWidth = std::max(width >> (level - 1), 1);
+            const auto sourceHeight = std::max(height >> (level - 1), 1);
+            glNamedFramebufferTextureLayer(_mipFramebuffers[0], GL_COLOR_ATTACHMENT0, mips.Texture, level - 1, (GLint)mips.Layer);
+            glNamedFramebufferTextureLayer(_mipFramebuffers[1], GL_COLOR_ATTACHMENT0, mips.Texture, level, (GLint)mips.Layer);
+            glBlitNamedFramebuffer(_mipFramebuffers[0], _mipFramebuffers[1], 0, 0, sourceWidth, sourceHeight, 0, 0, std::max(sourceWidth / 2, 1), std::max(sourceHeight / 2, 1), GL_COLOR_BUFFER_BIT, GL_LINEAR);
+        }
+    }
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "OpenGLRingBuffer.h"
+#include "OpenGLStateCache.h"
+#include <Tbx/Math/Int.h>
+#include <deque>
+#include <memory>
+#include <span>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // Streams texture pixels to the GPU through a persistently mapped pixel unpack ring.
+    // Each frame copies at most its byte budget worth of rows, so loading big textures spreads over several frames
+    // instead of stalling one. Mip generation can be deferred to later frames as well.
+    class OpenGLTextureUploader final
+    {
+    public:
+        static constexpr uint32 DefaultFrameBudget = 4 * 1024 * 1024;
+        static constexpr uint32 NoLayer = ~0u;
+
+        OpenGLTextureUploader(OpenGLStateCache& state);
+        ~OpenGLTextureUploader();
+
+        OpenGLTextureUploader(const OpenGLTextureUploader&) = delete;
+        OpenGLTextureUploader& operator=(const OpenGLTextureUploader&) = delete;
+
+        // Bytes copied to the GPU per frame, at least one row of a texture is always copied.
+        void SetFrameBudget(uint32 sizeInBytes);
+        uint32 GetFrameBudget() const { return _frameBudget; }
+
+        // When deferred, mips are generated on the frames after the base level finished uploading.
+        void SetMipGenerationDeferred(bool deferred) { _deferMips = deferred; }
+        bool IsMipGenerationDeferred() const { return _deferMips; }
+
+        // Queues tightly packed pixels for a level of an immutable texture, or of one layer when it's an array.
+        // Mips of a texture are generated once, after the last of its queued uploads. An array only gets the mips of the uploaded layer.
+        void Queue(uint32 texture, uint32 level, uint32 width, uint32 height, uint32 dataFormat, uint32 bytesPerPixel, std::span<const uint8_t> pixels, bool generateMips, uint32 layer = NoLayer);
+        // Queues a level of 4x4 compressed blocks, copied a row of blocks at a time.
+        void QueueCompressed(uint32 texture, uint32 level, uint32 width, uint32 height, uint32 internalFormat, uint32 blockSize, std::span<const uint8_t> blocks);
+        // Forgets anything still queued for the texture (or one of its layers), call before deleting or reusing it.
+        void Cancel(uint32 texture, uint32 layer = NoLayer);
+        bool IsPending(uint32 texture, uint32 layer = NoLayer) const;
+        uint32 GetPendingCount() const { return (uint32)(_uploads.size() + _pendingMips.size()); }
+
+        // Copies this frame's share of the queued uploads.
+        void Update();
+        // Finishes every queued upload right away.
+        void Flush();
+
+    private:
+        struct PendingUpload
+        {
+            uint32 Texture = 0;
+            uint32 Level = 0;
+            uint32 Layer = NoLayer;
+            uint32 Width = 0;
+            uint32 Height = 0;
+            // Data format for pixels, internal format for compressed blocks
+            uint32 Format = 0;
+            // Rows are texel rows for pixels and block rows for compressed blocks
+            uint32 RowSize = 0;
+            uint32 RowHeight = 1;
+            uint32 RowCount = 0;
+            uint32 NextRow = 0;
+            bool IsCompressed = false;
+            bool GenerateMips = false;
+            std::vector<uint8_t> Pixels = {};
+        };
+
+        struct PendingMips
+        {
+            uint32 Texture = 0;
+            uint32 Layer = NoLayer;
+
+            bool operator==(const PendingMips&) const = default;
+        };
+
+        void CopyRows(const PendingUpload& upload, uint32 rowCount, const void* data) const;
+        void FinishUpload(const PendingUpload& upload);
+        void QueueMips(const PendingMips& mips);
+        void GenerateMips(const PendingMips& mips);
+
+    private:
+        OpenGLStateCache& _state;
+        std::unique_ptr<OpenGLRingBuffer> _staging = nullptr;
+        std::deque<PendingUpload> _uploads = {};
+        std::deque<PendingMips> _pendingMips = {};
+        // Blitted between to downsample one layer of an array at a time
+        uint32 _mipFramebuffers[2] = {};
+        uint32 _frameBudget = DefaultFrameBudget;
+        bool _deferMips = false;
+    };
+}
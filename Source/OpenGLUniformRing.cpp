@@ -0,0 +1,199 @@
+#include "OpenGLUniformRing.h"
+#include <Tbx/Math/Vectors.h>
+#include <Tbx/Math/Mat4x4.h>
+#include <Tbx/Graphics/Color.h>
+#include <Tbx/Debug/Asserts.h>
+#include <glad/glad.h>
+#include <algorithm>
+#include <cstring>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    static uint32 AlignUp(uint32 value, uint32 alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    uint32 PackUniformBlock(const std::vector<UniformValue>& values, UniformBlockLayout layout, uint8_t* destination)
+    {
+        // Structs in std140 arrays are padded to a vec4, std430 only pads them to their largest member
+        uint32 structAlignment = layout == UniformBlockLayout::Std140 ? 16 : 4;
+        uint32 offset = 0;
+        for (const auto& value : values)
+        {
+            float data[16] = {};
+            uint32 size = 4;
+            uint32 alignment = 4;
+            if (std::holds_alternative<Mat4x4>(value))
+            {
+                // Column major, like glUniformMatrix4fv without transposing
+                std::memcpy(data, std::get<Mat4x4>(value).Values.data(), sizeof(data));
+                size = 64;
+                alignment = 16;
+            }
+            else if (std::holds_alternative<Vector2>(value))
+            {
+                const auto& vector = std::get<Vector2>(value);
+                data[0] = vector.X;
+                data[1] = vector.Y;
+                size = 8;
+                alignment = 8;
+            }
+            else if (std::holds_alternative<Vector3>(value))
+            {
+                // Aligned like a vec4, a following scalar fills the gap
+                const auto& vector = std::get<Vector3>(value);
+                data[0] = vector.X;
+                data[1] = vector.Y;
+                data[2] = vector.Z;
+                size = 12;
+                alignment = 16;
+            }
+            else if (std::holds_alternative<RgbaColor>(value))
+            {
+                const auto& color = std::get<RgbaColor>(value);
+                data[0] = color.R;
+                data[1] = color.G;
+                data[2] = color.B;
+                data[3] = color.A;
+                size = 16;
+                alignment = 16;
+            }
+            else if (std::holds_alternative<float>(value))
+            {
+                data[0] = std::get<float>(value);
+            }
+            else if (std::holds_alternative<int>(value))
+            {
+                const int integer = std::get<int>(value);
+                std::memcpy(data, &integer, sizeof(integer));
+            }
+            else
+            {
+                TBX_ASSERT(false, "GL Rendering: Unsupported shader data type.");
+                continue;
+            }
+
+            offset = AlignUp(offset, alignment);
+            if (destination)
+            {
+                std::memcpy(destination + offset, data, size);
+            }
+            offset += size;
+            structAlignment = std::max(structAlignment, alignment);
+        }
+        return AlignUp(offset, structAlignment);
+    }
+
+    OpenGLUniformRing::OpenGLUniformRing(OpenGLStateCache& state)
+        : _state(state)
+    {
+    }
+
+    void OpenGLUniformRing::BeginFrame()
+    {
+        if (!_frameUniforms.empty())
+        {
+            BindUniformBlock(FrameBlockBinding, _frameUniforms);
+        }
+    }
+
+    void OpenGLUniformRing::SetFrameUniforms(const std::vector<UniformValue>& values)
+    {
+        _frameUniforms = values;
+        BindUniformBlock(FrameBlockBinding, _frameUniforms);
+    }
+
+    void OpenGLUniformRing::SetDrawUniforms(const std::vector<UniformValue>& values)
+    {
+        BindUniformBlock(DrawBlockBinding, values);
+    }
+
+    void OpenGLUniformRing::SetDrawStorage(const std::vector<std::vector<UniformValue>>& draws)
+    {
+        if (draws.empty())
+        {
+            return;
+        }
+
+        // Every draw in one pass straight into the ring
+        const auto stride = PackUniformBlock(draws.front(), UniformBlockLayout::Std430);
+        const auto sizeInBytes = stride * (uint32)draws.size();
+        const auto allocation = Allocate(GL_SHADER_STORAGE_BUFFER, sizeInBytes);
+        for (uint32 i = 0; i < (uint32)draws.size(); i++)
+        {
+            TBX_ASSERT(draws[i].size() == draws.front().size(), "GL Rendering: Every draw's storage must have the same members!");
+            PackUniformBlock(draws[i], UniformBlockLayout::Std430, allocation.Data + i * stride);
+        }
+        Bind(GL_SHADER_STORAGE_BUFFER, DrawStorageBinding, allocation.Offset, sizeInBytes);
+    }
+
+    uint32 OpenGLUniformRing::BindUniformBlock(uint32 binding, const std::vector<UniformValue>& values)
+    {
+        TBX_ASSERT(!values.empty(), "GL Rendering: Can't bind an empty uniform block!");
+        const auto sizeInBytes = PackUniformBlock(values, UniformBlockLayout::Std140);
+        const auto allocation = Allocate(GL_UNIFORM_BUFFER, sizeInBytes);
+        PackUniformBlock(values, UniformBlockLayout::Std140, allocation.Data);
+        Bind(GL_UNIFORM_BUFFER, binding, allocation.Offset, sizeInBytes);
+        return allocation.Offset;
+    }
+
+    uint32 OpenGLUniformRing::BindStorageBlock(uint32 binding, const void* data, uint32 sizeInBytes)
+    {
+        const auto allocation = Allocate(GL_SHADER_STORAGE_BUFFER, sizeInBytes);
+        std::memcpy(allocation.Data, data, sizeInBytes);
+        Bind(GL_SHADER_STORAGE_BUFFER, binding, allocation.Offset, sizeInBytes);
+        return allocation.Offset;
+    }
+
+    OpenGLRingBuffer::Allocation OpenGLUniformRing::Allocate(uint32 target, uint32 sizeInBytes)
+    {
+        // Made on first use, there's no context yet when the plugin is constructed
+        if (!_ring)
+        {
+            GLint alignment = 0;
+            glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            _uniformAlignment = std::max(alignment, 4);
+            glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+            _storageAlignment = std::max(alignment, 4);
+            _ring = std::make_unique<OpenGLRingBuffer>(_state, DefaultRegionSize);
+        }
+
+        const auto frame = _state.GetFrameNumber();
+        if (frame != _boundFrame)
+        {
+            _bound.clear();
+            _boundFrame = frame;
+        }
+
+        const auto allocation = _ring->Allocate(sizeInBytes, target == GL_UNIFORM_BUFFER ? _uniformAlignment : _storageAlignment);
+
+        // Growing deletes the old buffer, which unbinds it, point what was bound at where the ring took it
+        const auto bufferGLId = _ring->GetGLId();
+        if (bufferGLId != _boundBufferGLId)
+        {
+            for (const auto& range : _bound)
+            {
+                _state.BindBufferRange(range.Target, range.Binding, bufferGLId, _ring->GetRegionOffset() + range.RegionOffset, range.Size);
+            }
+            _boundBufferGLId = bufferGLId;
+        }
+        return allocation;
+    }
+
+    void OpenGLUniformRing::Bind(uint32 target, uint32 binding, uint32 offset, uint32 sizeInBytes)
+    {
+        _state.BindBufferRange(target, binding, _ring->GetGLId(), offset, sizeInBytes);
+
+        const BoundRange range = { target, binding, offset - _ring->GetRegionOffset(), sizeInBytes };
+        const auto it = std::find_if(_bound.begin(), _bound.end(), [&](const BoundRange& bound) { return bound.Target == target && bound.Binding == binding; });
+        if (it != _bound.end())
+        {
+            *it = range;
+        }
+        else
+        {
+            _bound.push_back(range);
+        }
+    }
+}
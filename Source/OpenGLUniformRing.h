@@ -0,0 +1,82 @@
+#pragma once
+#include "OpenGLRingBuffer.h"
+#include "OpenGLShader.h"
+#include <Tbx/Math/Int.h>
+#include <memory>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    enum class UniformBlockLayout
+    {
+        // Uniform blocks, structs in arrays start on 16 bytes
+        Std140,
+        // Storage blocks, structs in arrays are only aligned to their largest member
+        Std430
+    };
+
+    // Packs values the way GLSL lays out a block declaring them in the same order.
+    // Returns the size rounded up to the alignment of a struct of the values, the stride of an array of them.
+    // Only measures when destination is null.
+    uint32 PackUniformBlock(const std::vector<UniformValue>& values, UniformBlockLayout layout, uint8_t* destination = nullptr);
+
+    // Uniform and storage block data for the frame, packed straight into a persistently mapped ring and bound by range.
+    // A draw's uniforms cost one memcpy and at most one bind instead of a driver call each, and per frame data
+    // like the camera is written once and seen by every program.
+    class OpenGLUniformRing final
+    {
+    public:
+        // layout(std140, binding = 0) uniform Frame { ... };
+        static constexpr uint32 FrameBlockBinding = 0;
+        // layout(std140, binding = 1) uniform Draw { ... };
+        static constexpr uint32 DrawBlockBinding = 1;
+        // layout(std430, binding = 0) readonly buffer Draws { DrawData draws[]; }; indexed with gl_BaseInstance or gl_DrawID
+        static constexpr uint32 DrawStorageBinding = 0;
+
+        static constexpr uint32 DefaultRegionSize = 256 * 1024;
+
+        OpenGLUniformRing(OpenGLStateCache& state);
+
+        OpenGLUniformRing(const OpenGLUniformRing&) = delete;
+        OpenGLUniformRing& operator=(const OpenGLUniformRing&) = delete;
+
+        // Rewrites the frame block into the new frame's region, the GPU may still read last frame's.
+        void BeginFrame();
+
+        // Stays bound on later frames until set again
+        void SetFrameUniforms(const std::vector<UniformValue>& values);
+        // Only for the current frame, their region of the ring is rewritten once it comes round again.
+        // Draw storage is one struct per draw, all with the same members, read by draws with gl_BaseInstance + gl_InstanceID as index.
+        void SetDrawUniforms(const std::vector<UniformValue>& values);
+        void SetDrawStorage(const std::vector<std::vector<UniformValue>>& draws);
+
+        // Packs values into this frame's region and binds them as a uniform block, returns where they went in the ring
+        uint32 BindUniformBlock(uint32 binding, const std::vector<UniformValue>& values);
+        uint32 BindStorageBlock(uint32 binding, const void* data, uint32 sizeInBytes);
+
+    private:
+        struct BoundRange
+        {
+            uint32 Target = 0;
+            uint32 Binding = 0;
+            // From the start of the frame's region, which is where it stays if the ring grows
+            uint32 RegionOffset = 0;
+            uint32 Size = 0;
+        };
+
+        OpenGLRingBuffer::Allocation Allocate(uint32 target, uint32 sizeInBytes);
+        void Bind(uint32 target, uint32 binding, uint32 offset, uint32 sizeInBytes);
+
+    private:
+        OpenGLStateCache& _state;
+        std::unique_ptr<OpenGLRingBuffer> _ring = nullptr;
+        uint32 _uniformAlignment = 0;
+        uint32 _storageAlignment = 0;
+
+        std::vector<UniformValue> _frameUniforms = {};
+        // Ranges bound this frame, rebound if the ring grows under them
+        std::vector<BoundRange> _bound = {};
+        uint32 _boundBufferGLId = 0;
+        uint64_t _boundFrame = ~0ull;
+    };
+}
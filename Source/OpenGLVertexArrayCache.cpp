@@ -0,0 +1,67 @@
+#include "OpenGLVertexArrayCache.h"
+#include "OpenGLHash.h"
+#include <glad/glad.h>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    size_t OpenGLVertexArrayCache::VertexFormatHash::operator()(const VertexFormat& format) const
+    {
+        // FNV-1a over every field of every attribute
+        auto hash = HashSeed;
+        const auto mix = [&hash](uint64_t value) { hash = HashCombine(hash, value); };
+
+        for (const auto& attribute : format)
+        {
+            mix(attribute.Type);
+            mix(attribute.Count);
+            mix(attribute.Offset);
+            mix(attribute.Normalized ? 1 : 0);
+            mix(attribute.Binding);
+        }
+        return (size_t)hash;
+    }
+
+    OpenGLVertexArrayCache::OpenGLVertexArrayCache(OpenGLStateCache& state)
+        : _state(state)
+    {
+    }
+
+    OpenGLVertexArrayCache::~OpenGLVertexArrayCache()
+    {
+        for (auto& [format, vertexArray] : _vertexArrays)
+        {
+            _state.OnVertexArrayDeleted(vertexArray);
+            glDeleteVertexArrays(1, &vertexArray);
+        }
+    }
+
+    uint32 OpenGLVertexArrayCache::Acquire(const VertexFormat& format)
+    {
+        const auto it = _vertexArrays.find(format);
+        if (it != _vertexArrays.end())
+        {
+            return it->second;
+        }
+
+        uint32 vertexArray = 0;
+        glCreateVertexArrays(1, &vertexArray);
+        for (uint32 location = 0; location < (uint32)format.size(); location++)
+        {
+            const auto& attribute = format[location];
+            glEnableVertexArrayAttrib(vertexArray, location);
+            if (attribute.Type == GL_INT && !attribute.Normalized)
+            {
+                glVertexArrayAttribIFormat(vertexArray, location, attribute.Count, attribute.Type, attribute.Offset);
+            }
+            else
+            {
+                glVertexArrayAttribFormat(vertexArray, location, attribute.Count, attribute.Type, attribute.Normalized ? GL_TRUE : GL_FALSE, attribute.Offset);
+            }
+            glVertexArrayAttribBinding(vertexArray, location, attribute.Binding);
+        }
+        glVertexArrayBindingDivisor(vertexArray, InstanceBinding, 1);
+
+        _vertexArrays.emplace(format, vertexArray);
+        return vertexArray;
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include "OpenGLStateCache.h"
+#include <Tbx/Math/Int.h>
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace Tbx::Plugins::OpenGLRendering
+{
+    // How a single attribute is stored in GPU memory, which may differ from the layout it was given in.
+    struct VertexAttributeFormat
+    {
+        uint32 Type = 0;
+        uint32 Count = 0;
+        uint32 Offset = 0;
+        bool Normalized = false;
+        uint32 Binding = 0;
+
+        bool operator==(const VertexAttributeFormat&) const = default;
+    };
+
+    // Attribute formats by location.
+    using VertexFormat = std::vector<VertexAttributeFormat>;
+
+    // Hands out one vertex array per distinct vertex format, set up with DSA attribute formats.
+    // Meshes sharing a format share the vertex array and only swap the buffers bound to it.
+    class OpenGLVertexArrayCache final
+    {
+    public:
+        // Per vertex attributes read from this buffer binding point...
+        static constexpr uint32 VertexBinding = 0;
+        // ...and per instance attributes from this one, which advances once per instance.
+        static constexpr uint32 InstanceBinding = 1;
+
+        OpenGLVertexArrayCache(OpenGLStateCache& state);
+        ~OpenGLVertexArrayCache();
+
+        OpenGLVertexArrayCache(const OpenGLVertexArrayCache&) = delete;
+        OpenGLVertexArrayCache& operator=(const OpenGLVertexArrayCache&) = delete;
+
+        uint32 Acquire(const VertexFormat& format);
+        uint32 GetCount() const { return (uint32)_vertexArrays.size(); }
+
+    private:
+        struct VertexFormatHash
+        {
+            size_t operator()(const VertexFormat& format) const;
+        };
+
+        OpenGLStateCache& _state;
+        std::unordered_map<VertexFormat, uint32, VertexFormatHash> _vertexArrays = {};
+    };
+}